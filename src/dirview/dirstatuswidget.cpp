@@ -5,7 +5,6 @@
 #include "filesystemmodel.h"
 #include "debug.h"
 #include "settingsmanager.h"
-#include "constants.h"
 
 #include <QFileInfo>
 #include <QLabel>
@@ -43,10 +42,11 @@ DirStatusWidget::DirStatusWidget (ProxyModel *model, QWidget *parent) :
 
   layout->setMargin (0);
 
+  connect (&StorageManager::instance (), &StorageManager::spaceChanged,
+           this, &DirStatusWidget::updateStorage);
+
   SettingsManager::subscribeForUpdates (this);
   updateSettings ();
-
-  startTimer (5000);
 }
 
 void DirStatusWidget::updateSettings ()
@@ -79,34 +79,21 @@ void DirStatusWidget::updateSettings ()
   }
 }
 
-void DirStatusWidget::updateSelection (const QList<QFileInfo> &selection)
+void DirStatusWidget::updateSelection (const ProxyModel::Totals &selection)
 {
   if (!selection_->isEnabled ())
   {
     return;
   }
 
-  if (selection.isEmpty ())
+  if (selection.files == 0 && selection.dirs == 0)
   {
     selection_->clear ();
     return;
   }
 
-  qint64 size = 0;
-  auto files = 0;
-  auto dirs = 0;
-  for (const auto &i: selection)
-  {
-    const auto isDir = i.isDir ();
-    files += int (!isDir);
-    dirs += int (isDir);
-    if (!isDir)
-    {
-      size += i.size ();
-    }
-  }
-  selection_->setText (tr ("*%1/%2 (%3)").arg (files).arg (dirs)
-                       .arg (utils::sizeString (size)));
+  selection_->setText (tr ("*%1/%2 (%3)").arg (selection.files).arg (selection.dirs)
+                       .arg (utils::sizeString (selection.size)));
 }
 
 void DirStatusWidget::updatePath ()
@@ -125,11 +112,11 @@ void DirStatusWidget::updateStorage ()
   }
 
   const auto storage = StorageManager::storage (path_);
-  if (storage)
+  if (storage.bytesTotal > 0)
   {
     using namespace utils;
-    const auto free = storage->bytesAvailable ();
-    const auto total = storage->bytesTotal ();
+    const auto free = storage.bytesAvailable;
+    const auto total = storage.bytesTotal;
     const auto percent = total > 0 ? free * 100. / total : 0.0;
     storage_->setText (tr ("%1/%2 (%3%)").arg (sizeString (free), sizeString (total))
                        .arg (percent, 0, 'f', 0));
@@ -147,30 +134,9 @@ void DirStatusWidget::updateEntries ()
     return;
   }
 
-  qint64 size = 0;
-  auto files = 0;
-  auto dirs = 0;
-  for (auto i = 0, end = model_->count (); i < end; ++i)
-  {
-    const auto isDir = model_->isDir (i);
-    files += int (!isDir);
-    dirs += int (isDir);
-    if (!isDir)
-    {
-      size += model_->fileSize (i);
-    }
-    else if (model_->fileName (i) == constants::dotdot)
-    {
-      --dirs;
-    }
-  }
-  entries_->setText (tr ("#%1/%2 (%3)").arg (files).arg (dirs)
-                     .arg (utils::sizeString (size)));
-}
-
-void DirStatusWidget::timerEvent (QTimerEvent */*event*/)
-{
-  updateStorage ();
+  const auto totals = model_->totals ();
+  entries_->setText (tr ("#%1/%2 (%3)").arg (totals.files).arg (totals.dirs)
+                     .arg (utils::sizeString (totals.size)));
 }
 
 #include "moc_dirstatuswidget.cpp"
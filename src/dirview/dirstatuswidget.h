@@ -1,11 +1,10 @@
 #pragma once
 
+#include "proxymodel.h"
+
 #include <QWidget>
 #include <QFileInfo>
 
-class ProxyModel;
-
-class QFileInfo;
 class QLabel;
 
 class DirStatusWidget : public QWidget
@@ -16,14 +15,11 @@ public:
   DirStatusWidget (const DirStatusWidget &) = delete;
   DirStatusWidget &operator= (const DirStatusWidget &) = delete;
 
-  void updateSelection (const QList<QFileInfo> &selection);
+  void updateSelection (const ProxyModel::Totals &selection);
 
 public slots:
   void updateSettings ();
 
-protected:
-  void timerEvent (QTimerEvent *event) override;
-
 private:
   void updatePath ();
   void updateStorage ();
@@ -14,11 +14,39 @@
 #include <QMenu>
 #include <QKeyEvent>
 #include <QGraphicsDropShadowEffect>
+#include <QStyleOptionViewItem>
+
+#include <algorithm>
 
 
 namespace
 {
 const QString qs_view = "header";
+
+const int hugeRows = 100000;
+const int hugeLayoutBatchRows = 5000;
+
+//! Number of leading rows in [0, rows) for which isBefore is true.
+template<class Predicate>
+int countBefore (int rows, Predicate isBefore)
+{
+  auto from = 0;
+  auto count = rows;
+  while (count > 0)
+  {
+    const auto step = count / 2;
+    if (isBefore (from + step))
+    {
+      from += step + 1;
+      count -= step + 1;
+    }
+    else
+    {
+      count = step;
+    }
+  }
+  return from;
+}
 }
 
 
@@ -27,17 +55,24 @@ DirView::DirView (QAbstractItemModel &model, QWidget *parent) :
   isList_ (false),
   isLocked_ (false),
   isExtensive_ (false),
+  isHuge_ (false),
   delegate_ (nullptr),
   model_ (&model),
   table_ (nullptr),
   list_ (nullptr),
-  glowColor_ ()
+  glowColor_ (),
+  firstVisibleRow_ (-1),
+  lastVisibleRow_ (-1)
 {
   setLayout (new QVBoxLayout);
   layout ()->setMargin (0);
   setIsList (isList_);
   connect (&model, &QAbstractItemModel::rowsInserted,
            this, &DirView::selectFirst);
+  connect (&model, &QAbstractItemModel::rowsInserted,
+           this, &DirView::updateHugeMode);
+  connect (&model, &QAbstractItemModel::rowsRemoved,
+           this, &DirView::updateHugeMode);
 
   connect (&StyleOptionsProxy::instance (), &StyleOptionsProxy::changed,
            this, &DirView::updateStyle);
@@ -115,22 +150,30 @@ QModelIndex DirView::rootIndex () const
 void DirView::setRootIndex (const QModelIndex &index)
 {
   view ()->setRootIndex (index);
+  updateHugeMode ();
 }
 
 QModelIndexList DirView::selectedRows () const
 {
   auto selection = view ()->selectionModel ();
-  auto items = (table_
-                ? selection->selectedRows (FileSystemModel::Column::Name)
-                : selection->selectedIndexes ());
+  const auto items = (table_
+                      ? selection->selectedRows (FileSystemModel::Column::Name)
+                      : selection->selectedIndexes ());
+  QModelIndexList result;
+  result.reserve (items.size ());
   for (const auto &i: items)
   {
-    if (i.data () == constants::dotdot)
+    if (i.data () != constants::dotdot)
     {
-      items.removeOne (i);
+      result << i;
     }
   }
-  return items;
+  return result;
+}
+
+QItemSelection DirView::selection () const
+{
+  return view ()->selectionModel ()->selection ();
 }
 
 void DirView::renameCurrent ()
@@ -212,10 +255,12 @@ void DirView::setIsList (bool isList)
   layout ()->addWidget (view);
 
   setRootIndex (root);
+  applyHugeMode ();
   setLocked (isLocked ());
   setExtensive (isExtensive ());
 
   activate ();
+  emit selectionChanged ({}, {}); // new view starts unselected
 }
 
 void DirView::initTable ()
@@ -308,7 +353,55 @@ void DirView::setExtensive (bool isExtensive)
   {
     const auto iconSize = (isExtensive ? constants::iconSize : constants::iconMinSize);
     list_->setIconSize ({iconSize, iconSize});
+    if (isHuge_)
+    {
+      applyHugeMode (); // grid depends on icon size
+    }
+  }
+}
+
+void DirView::updateHugeMode ()
+{
+  const auto isHuge = model_->rowCount (rootIndex ()) >= hugeRows;
+  if (isHuge == isHuge_)
+  {
+    return;
   }
+  isHuge_ = isHuge;
+  applyHugeMode ();
+}
+
+//! Directories with a lot of entries are laid out on a fixed grid in batches,
+//! so the first screen is shown without measuring or placing every item.
+void DirView::applyHugeMode ()
+{
+  if (table_)
+  {
+    table_->verticalHeader ()->setSectionResizeMode (isHuge_ ? QHeaderView::Fixed
+                                                             : QHeaderView::Interactive);
+    return;
+  }
+
+  if (!isHuge_)
+  {
+    list_->setMovement (QListView::Snap);
+    list_->setLayoutMode (QListView::SinglePass);
+    list_->setGridSize ({});
+    setLocked (isLocked ()); // movement changes drag mode
+    return;
+  }
+
+  QStyleOptionViewItem option;
+  option.initFrom (list_);
+  option.decorationSize = list_->iconSize ();
+  option.fontMetrics = list_->fontMetrics ();
+  const auto cell = delegate_->sizeHint (option, {}) + QSize (list_->spacing (), list_->spacing ());
+
+  list_->setMovement (QListView::Static);
+  list_->setLayoutMode (QListView::Batched);
+  list_->setBatchSize (hugeLayoutBatchRows);
+  list_->setGridSize (cell);
+  setLocked (isLocked ());
 }
 
 void DirView::showHeaderContextMenu ()
@@ -424,9 +517,66 @@ bool DirView::eventFilter (QObject *watched, QEvent *event)
   {
     setGraphicsEffect (nullptr);
   }
+  else if (event->type () == QEvent::Paint && watched == view ()->viewport ())
+  {
+    updateVisibleRows ();
+  }
   return false;
 }
 
+void DirView::updateVisibleRows ()
+{
+  auto first = -1;
+  auto last = -1;
+  const auto rows = model_->rowCount (rootIndex ());
+  if (rows > 0)
+  {
+    if (isList_)
+    {
+      // corners of viewport usually fall into gaps between items, so rows are
+      // found by their positions, which follow row order in flow direction
+      const auto rect = list_->viewport ()->rect ();
+      const auto root = rootIndex ();
+      const auto isLeftToRight = (list_->flow () == QListView::LeftToRight);
+      first = countBefore (rows, [this, &rect, &root, isLeftToRight](int row) {
+                             const auto item = list_->visualRect (model_->index (row, 0, root));
+                             return isLeftToRight ? item.bottom () < rect.top ()
+                                                  : item.right () < rect.left ();
+                           });
+      last = countBefore (rows, [this, &rect, &root, isLeftToRight](int row) {
+                            const auto item = list_->visualRect (model_->index (row, 0, root));
+                            return isLeftToRight ? item.top () <= rect.bottom ()
+                                                 : item.left () <= rect.right ();
+                          }) - 1;
+      first = std::min (first, rows - 1);
+      last = std::max (last, first);
+    }
+    else
+    {
+      first = table_->rowAt (0);
+      last = table_->rowAt (table_->viewport ()->height () - 1);
+      first = (first == -1 ? 0 : first);
+      last = (last == -1 ? rows - 1 : last); // viewport is below the last row
+    }
+  }
+
+  if (first == firstVisibleRow_ && last == lastVisibleRow_)
+  {
+    return;
+  }
+  firstVisibleRow_ = first;
+  lastVisibleRow_ = last;
+  if (rows > 0)
+  {
+    emit visibleRowsChanged (model_->index (first, 0, rootIndex ()),
+                             model_->index (last, 0, rootIndex ()));
+  }
+  else
+  {
+    emit visibleRowsChanged ({}, {});
+  }
+}
+
 void DirView::updateStyle ()
 {
   const auto &options = StyleOptionsProxy::instance ();
@@ -2,6 +2,7 @@
 
 #include <QWidget>
 #include <QModelIndex>
+#include <QItemSelection>
 
 class FileDelegate;
 
@@ -32,6 +33,7 @@ public:
   void setRootIndex (const QModelIndex &index);
 
   QModelIndexList selectedRows () const;
+  QItemSelection selection () const;
 
   void renameCurrent ();
   void changeCurrentPermissions ();
@@ -48,29 +50,36 @@ public:
   bool eventFilter (QObject *watched, QEvent *event) override;
 
 signals:
-  void selectionChanged ();
+  void selectionChanged (const QItemSelection &selected, const QItemSelection &deselected);
   void currentChanged (const QModelIndex &index);
   void movedBackward ();
   void activated (const QModelIndex &index);
   void backgroundActivated (const QModelIndex &index);
   void contextMenuRequested ();
+  void visibleRowsChanged (const QModelIndex &first, const QModelIndex &last);
 
 private:
   void setCurrentIndex (const QModelIndex &index, bool updateSelection);
   void showHeaderContextMenu ();
   QAbstractItemView * view () const;
   void selectFirst ();
+  void updateVisibleRows ();
   void initTable ();
   void initList ();
+  void updateHugeMode ();
+  void applyHugeMode ();
   void updateStyle ();
   void setGlowColor (const QColor &color);
 
   bool isList_;
   bool isLocked_;
   bool isExtensive_;
+  bool isHuge_;
   FileDelegate *delegate_;
   QAbstractItemModel *model_;
   QTableView *table_;
   QListView *list_;
   QColor glowColor_;
+  int firstVisibleRow_;
+  int lastVisibleRow_;
 };
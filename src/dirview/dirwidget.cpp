@@ -14,10 +14,13 @@
 #include "dirstatuswidget.h"
 #include "settingsmanager.h"
 #include "navigationhistory.h"
+#include "frecencystore.h"
 #include "shellcommandmodel.h"
 #include "fileoperationmodel.h"
 #include "transferdialog.h"
 #include "searchwidget.h"
+#include "quickjumpdialog.h"
+#include "backport.h"
 
 #include <QBoxLayout>
 #include <QLabel>
@@ -34,6 +37,8 @@
 #include <QClipboard>
 #include <QProcess>
 #include <QRegularExpression>
+#include <QTimer>
+#include <QDir>
 
 namespace
 {
@@ -45,6 +50,8 @@ const QString qs_showDirs = "showDirs";
 const QString qs_showHidden = "showHidden";
 const QString qs_showThumbs = "showThumbs";
 const QString qs_minSize = "minSize";
+
+const int prefetchDelayMs = 300;
 }
 
 DirWidget::DirWidget (FileSystemModel *model, ShellCommandModel *commands,
@@ -56,6 +63,8 @@ DirWidget::DirWidget (FileSystemModel *model, ShellCommandModel *commands,
   index_ (),
   path_ (),
   lastCurrentFile_ (),
+  pendingPath_ (),
+  pendingCurrentFile_ (),
   pathWidget_ (new PathWidget (model, this)),
   status_ (new DirStatusWidget (proxy_, this)),
   commandPrompt_ (new QLineEdit (this)),
@@ -63,6 +72,9 @@ DirWidget::DirWidget (FileSystemModel *model, ShellCommandModel *commands,
   fileOperations_ (fileOperations),
   siblings_ (),
   navigationHistory_ (new NavigationHistory (this)),
+  nameFilter_ (),
+  selectionTotals_ (),
+  prefetchTimer_ (new QTimer (this)),
   menu_ (new QMenu (this)),
   isLocked_ (nullptr),
   showDirs_ (nullptr),
@@ -101,13 +113,15 @@ DirWidget::DirWidget (FileSystemModel *model, ShellCommandModel *commands,
 
   connect (model_, &QAbstractItemModel::rowsRemoved,
            this, &DirWidget::checkDirExistence);
-  connect (model_, &QFileSystemModel::fileRenamed,
+  connect (model_, &FileSystemModel::fileRenamed,
            this, &DirWidget::handleDirRename);
-  connect (model_, &QFileSystemModel::fileRenamed,
+  connect (model_, &FileSystemModel::fileRenamed,
            this, &DirWidget::handleFileRename);
 
   connect (view_, &DirView::currentChanged,
            proxy_, &ProxyModel::setCurrentIndex);
+  connect (view_, &DirView::visibleRowsChanged,
+           proxy_, &ProxyModel::setVisibleRows);
 
 
   using Shortcut = ShortcutManager;
@@ -142,6 +156,10 @@ DirWidget::DirWidget (FileSystemModel *model, ShellCommandModel *commands,
   connect (search, &QAction::triggered,
            this, &DirWidget::advancedSearch);
 
+  auto quickJump = Shortcut::create (this, Shortcut::QuickJump, menu_);
+  connect (quickJump, &QAction::triggered,
+           this, &DirWidget::quickJump);
+
 
   menu_->addSeparator ();
 
@@ -350,11 +368,23 @@ DirWidget::DirWidget (FileSystemModel *model, ShellCommandModel *commands,
   connect (view_, &DirView::backgroundActivated,
            this, &DirWidget::openInBackground);
   connect (view_, &DirView::selectionChanged,
-           this, &DirWidget::updateActions);
-  connect (view_, &DirView::selectionChanged,
+           this, &DirWidget::updateSelection);
+  connect (proxy_, &ProxyModel::contentsChanged,
            this, &DirWidget::updateStatusSelection);
   connect (view_, &DirView::currentChanged,
            this, &DirWidget::updateCurrentFile);
+  connect (model_, &FileSystemModel::directoryLoaded,
+           this, &DirWidget::selectPendingFile);
+  connect (model_, &FileSystemModel::pathFetched,
+           this, &DirWidget::openPendingPath);
+
+  // warm up listings of places that are likely to be opened next
+  prefetchTimer_->setSingleShot (true);
+  prefetchTimer_->setInterval (prefetchDelayMs);
+  connect (prefetchTimer_, &QTimer::timeout,
+           this, &DirWidget::prefetch);
+  connect (view_, &DirView::currentChanged,
+           prefetchTimer_, static_cast<void (QTimer::*)()>(&QTimer::start));
 
   installEventFilter (this);
 }
@@ -490,6 +520,43 @@ void DirWidget::advancedSearch ()
   w->show ();
 }
 
+void DirWidget::quickJump ()
+{
+  QuickJumpDialog dialog (this);
+  if (dialog.exec () != QDialog::Accepted)
+  {
+    return;
+  }
+  const auto path = dialog.path ();
+  if (path.isEmpty ())
+  {
+    return;
+  }
+  const QFileInfo info (path);
+  if (info.isDir ())
+  {
+    setPath (info);
+    return;
+  }
+  setPath (info.absolutePath ());
+  pendingCurrentFile_ = info.absoluteFilePath ();
+  selectPendingFile ();
+}
+
+void DirWidget::selectPendingFile ()
+{
+  if (pendingCurrentFile_.isEmpty ())
+  {
+    return;
+  }
+  const auto index = proxy_->mapFromSource (model_->index (pendingCurrentFile_));
+  if (index.isValid ())
+  {
+    view_->setCurrentIndex (index);
+    pendingCurrentFile_.clear ();
+  }
+}
+
 void DirWidget::openConsole ()
 {
   commandRunner_->openConsole (path_);
@@ -518,7 +585,28 @@ QString DirWidget::fullName (int preferredWidth) const
 
 void DirWidget::setPath (const QFileInfo &path)
 {
-  openPath (proxy_->mapFromSource (model_->index (path.absoluteFilePath ())));
+  const auto absolutePath = QDir::cleanPath (path.absoluteFilePath ());
+  const auto index = model_->index (absolutePath);
+  if (index.isValid ())
+  {
+    openSourcePath (index);
+    return;
+  }
+  // parents are not listed yet, their entries are read in background
+  pendingPath_ = absolutePath;
+  model_->fetchPath (absolutePath);
+}
+
+void DirWidget::openPendingPath (const QString &path)
+{
+  if (path != pendingPath_)
+  {
+    return;
+  }
+  const auto file = pendingCurrentFile_;
+  openSourcePath (model_->index (path));
+  pendingCurrentFile_ = file;
+  selectPendingFile ();
 }
 
 void DirWidget::setNameFilter (const QString &filter)
@@ -532,34 +620,69 @@ void DirWidget::setNameFilter (const QString &filter)
 
 void DirWidget::openPath (const QModelIndex &index)
 {
-  if (isLocked ())
-  {
-    return;
-  }
-
   if (index.isValid () && proxy_->isDotDot (index))
   {
     openPath (index.parent ().parent ());
     return;
   }
+  openSourcePath (proxy_->mapToSource (index));
+}
 
-  if (!index.isValid ()) // drives
+void DirWidget::openSourcePath (const QModelIndex &index)
+{
+  if (isLocked ())
   {
-    view_->setRootIndex ({});
-    proxy_->setRootIndex ({});
+    return;
   }
-  else
+  pendingPath_.clear ();
+  pendingCurrentFile_.clear ();
+
+  // proxy maps only the current directory so it must be switched before view
+  const auto previous = proxy_->mapToSource (view_->rootIndex ());
+  proxy_->setSourceRoot (index);
+  const auto newIndex = proxy_->rootIndex ();
+  view_->setRootIndex (newIndex);
+  selectionTotals_ = proxy_->totals (view_->selection ());
+  if (newIndex.isValid ())
   {
-    auto newIndex = index.sibling (index.row (), FileSystemModel::Name);
-    const auto previous = view_->rootIndex ();
-    const auto moveUp = previous.parent () == newIndex;
-    view_->setRootIndex (newIndex);
-    view_->setCurrentIndex (moveUp ? previous : view_->firstItem ());
-    proxy_->setRootIndex (newIndex);
+    const auto moveUp = previous.isValid () && previous.parent () == index;
+    view_->setCurrentIndex (moveUp ? proxy_->mapFromSource (previous) : view_->firstItem ());
   }
+
   path_ = fileInfo (view_->rootIndex ());
   pathWidget_->setPath (path_);
   navigationHistory_->addPath (path_);
+  FrecencyStore::instance ().addVisit (path_.absoluteFilePath ());
+  prefetchTimer_->start ();
+}
+
+void DirWidget::prefetch ()
+{
+  if (!isVisible ())
+  {
+    return;
+  }
+
+  // directories of siblings are shown so they are loaded already
+  QStringList paths;
+  const auto currentIndex = proxy_->mapToSource (view_->currentIndex ());
+  if (model_->isDir (currentIndex) && !model_->isDotDot (currentIndex))
+  {
+    paths << model_->filePath (currentIndex);
+  }
+  if (!path_.isRoot ())
+  {
+    paths << path_.absolutePath ();
+  }
+  for (const auto &i: navigationHistory_->neighbours ())
+  {
+    paths << i.absoluteFilePath ();
+  }
+
+  for (const auto &i: nonstd::as_const (paths))
+  {
+    model_->prefetch (i);
+  }
 }
 
 void DirWidget::openFile (const QFileInfo &info)
@@ -705,9 +828,16 @@ void DirWidget::promptRemove ()
 QList<QFileInfo> DirWidget::selected () const
 {
   QList<QFileInfo> infos;
-  for (const auto &i: view_->selectedRows ())
+  for (const auto &range: view_->selection ())
   {
-    infos << fileInfo (i);
+    for (auto row = range.top (), end = range.bottom (); row <= end; ++row)
+    {
+      const auto index = proxy_->index (row, 0, range.parent ());
+      if (!proxy_->isDotDot (index))
+      {
+        infos << fileInfo (index);
+      }
+    }
   }
   return infos;
 }
@@ -817,8 +947,12 @@ void DirWidget::openInBackground (const QModelIndex &index)
 
 void DirWidget::showProperties ()
 {
-  const auto info = view_->currentIndex ().isValid () ? current () : path_;
-  auto *w = new PropertiesWidget (info);
+  auto infos = selected ();
+  if (infos.isEmpty ())
+  {
+    infos << (view_->currentIndex ().isValid () ? current () : path_);
+  }
+  auto *w = new PropertiesWidget (infos);
   w->setAttribute (Qt::WA_DeleteOnClose, true);
   w->show ();
   auto global = mapToGlobal (rect ().center ());
@@ -904,9 +1038,33 @@ void DirWidget::setShowDirs (bool on)
   updateActions ();
 }
 
+void DirWidget::updateSelection (const QItemSelection &selected,
+                                 const QItemSelection &deselected)
+{
+  if (!view_->selection ().isEmpty ())
+  {
+    const auto added = proxy_->totals (selected);
+    const auto removed = proxy_->totals (deselected);
+    selectionTotals_.files += added.files - removed.files;
+    selectionTotals_.dirs += added.dirs - removed.dirs;
+    selectionTotals_.size += added.size - removed.size;
+  }
+  else
+  {
+    selectionTotals_ = ProxyModel::Totals ();
+  }
+  status_->updateSelection (selectionTotals_);
+  updateActions ();
+}
+
 void DirWidget::updateStatusSelection ()
 {
-  status_->updateSelection (selected ());
+  // sizes of selected entries may have changed
+  if (!view_->selection ().isEmpty ())
+  {
+    selectionTotals_ = proxy_->totals (view_->selection ());
+    status_->updateSelection (selectionTotals_);
+  }
 }
 
 void DirWidget::updateActions ()
@@ -915,9 +1073,9 @@ void DirWidget::updateActions ()
   const auto locked = isLocked_->isChecked ();
   const auto index = view_->currentIndex ();
   const auto isDotDot = index.isValid () && proxy_->isDotDot (index);
-  const auto isDir =  proxy_->isDir (index.row ());
+  const auto isDir = model_->isDir (proxy_->mapToSource (index));
   const auto isValid = index.isValid ();
-  const auto isSingleSelected = (view_->selectedRows ().size () <= 1);
+  const auto isSingleSelected = (selectionTotals_.files + selectionTotals_.dirs <= 1);
 
   newFolderAction_->setEnabled (dirs && !locked);
   upAction_->setEnabled (!locked);
@@ -947,7 +1105,7 @@ void DirWidget::updateActions ()
   removeAction_->setEnabled (!locked && isValid && !isDotDot);
   trashAction_->setEnabled (!locked && isValid && !isDotDot);
 
-  showPropertiesAction_->setEnabled (isValid && isSingleSelected);
+  showPropertiesAction_->setEnabled (isValid);
 }
 
 void DirWidget::checkDirExistence ()
@@ -1,9 +1,10 @@
 #pragma once
 
+#include "proxymodel.h"
+
 #include <QWidget>
 #include <QFileInfo>
 
-class ProxyModel;
 class FileSystemModel;
 class DirView;
 class PathWidget;
@@ -18,6 +19,7 @@ class QToolButton;
 class QSettings;
 class QBoxLayout;
 class QLineEdit;
+class QTimer;
 class QFileInfo;
 
 class DirWidget : public QWidget
@@ -65,6 +67,7 @@ private:
 
   void openSelected ();
   void openPath (const QModelIndex &index);
+  void openSourcePath (const QModelIndex &index);
   void openFile (const QFileInfo &info);
 
   void promptClose ();
@@ -94,12 +97,16 @@ private:
   void execCommandPrompt ();
 
   void advancedSearch ();
+  void quickJump ();
+  void selectPendingFile ();
+  void openPendingPath (const QString &path);
 
   bool isLocked () const;
   void setLocked (bool isLocked);
 
   void setShowDirs (bool on);
 
+  void updateSelection (const QItemSelection &selected, const QItemSelection &deselected);
   void updateStatusSelection ();
   void updateActions ();
   void checkDirExistence ();
@@ -107,6 +114,7 @@ private:
   void handleDirRename (const QString &path, const QString &old, const QString &now);
   void handleFileRename (const QString &path, const QString &old, const QString &now);
   void handleIsVisibleChanged (bool isVisible);
+  void prefetch ();
 
 
   FileSystemModel *model_;
@@ -115,6 +123,8 @@ private:
   QString index_;
   QFileInfo path_;
   QString lastCurrentFile_;
+  QString pendingPath_; // to open when its parts are read
+  QString pendingCurrentFile_; // to select when its directory is loaded
   PathWidget *pathWidget_;
   DirStatusWidget *status_;
   QLineEdit *commandPrompt_;
@@ -123,6 +133,8 @@ private:
   QList<DirWidget *> siblings_;
   NavigationHistory *navigationHistory_;
   QString nameFilter_;
+  ProxyModel::Totals selectionTotals_;
+  QTimer *prefetchTimer_;
 
   QMenu *menu_;
   QAction *isLocked_;
@@ -70,6 +70,20 @@ QAction * NavigationHistory::backwardAction () const
   return backward_;
 }
 
+QList<QFileInfo> NavigationHistory::neighbours () const
+{
+  QList<QFileInfo> result;
+  if (currentIndex_ >= 1)
+  {
+    result << history_[currentIndex_ - 1];
+  }
+  if (currentIndex_ + 1 < history_.size ())
+  {
+    result << history_[currentIndex_ + 1];
+  }
+  return result;
+}
+
 void NavigationHistory::moveForward ()
 {
   if (currentIndex_ + 1 < history_.size ())
@@ -16,6 +16,8 @@ public:
 
   QAction * forwardAction () const;
   QAction * backwardAction () const;
+  //! Paths one step backward and forward, if any.
+  QList<QFileInfo> neighbours () const;
 
 signals:
   void pathChanged (const QFileInfo &path);
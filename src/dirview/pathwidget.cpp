@@ -1,6 +1,7 @@
 #include "pathwidget.h"
 #include "filesystemcompleter.h"
 #include "constants.h"
+#include "frecencystore.h"
 #include "debug.h"
 
 #include <QLabel>
@@ -9,6 +10,11 @@
 #include <QDir>
 #include <QKeyEvent>
 
+namespace
+{
+const int maxJumpCandidates = 5;
+}
+
 PathWidget::PathWidget (FileSystemModel *model, QWidget *parent) :
   QWidget (parent),
   isReadOnly_ (false),
@@ -156,7 +162,26 @@ void PathWidget::applyEdition ()
     return;
   }
 #endif
-  if (newPath != path && QFile::exists (newPath))
+  if (!newPath.isEmpty () && QDir::isRelativePath (newPath))
+  {
+    // parts of a visited path, the best one that still exists is opened
+    auto &visits = FrecencyStore::instance ();
+    const auto current = path_.absoluteFilePath ();
+    for (const auto &i: visits.find (newPath, maxJumpCandidates))
+    {
+      if (i == current)
+      {
+        continue;
+      }
+      if (QFileInfo (i).isDir ())
+      {
+        emit pathChanged (QFileInfo (i));
+        break;
+      }
+      visits.remove (i);
+    }
+  }
+  else if (newPath != path && QFile::exists (newPath))
   {
     emit pathChanged (QFileInfo (newPath));
   }
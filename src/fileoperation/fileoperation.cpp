@@ -6,12 +6,14 @@
 #include "utils.h"
 #include "constants.h"
 #include "storagemanager.h"
+#include "dirsizes.h"
 
 #include <QDir>
 #include <QtConcurrentRun>
 #include <QApplication>
 
 #include <array>
+#include <algorithm>
 
 namespace
 {
@@ -98,14 +100,7 @@ void FileOperation::startAsync (FileConflictResolver *resolver)
 {
   ASSERT (resolver);
   resolver_ = resolver;
-  if (action_ != FileOperation::Action::Link)
-  {
-    for (const auto &i: sources_)
-    {
-      totalSize_ += utils::totalSize (i);
-    }
-  }
-  else
+  if (action_ == FileOperation::Action::Link)
   {
     totalSize_ = sources_.size ();
   }
@@ -138,6 +133,21 @@ void FileOperation::startAsync (FileConflictResolver *resolver)
   }
 }
 
+//! Called in worker thread before the first entry is processed.
+void FileOperation::measure ()
+{
+  for (const auto &i: sources_)
+  {
+    if (isAborted_)
+    {
+      return;
+    }
+    const auto size = i.isDir () ? DirSizes::compute (i.absoluteFilePath (), isAborted_)
+                                 : i.size ();
+    totalSize_ += std::max (size, qint64 (0));
+  }
+}
+
 void FileOperation::advance (qint64 size)
 {
   doneSize_ += size;
@@ -156,6 +166,18 @@ void FileOperation::setCurrent (const QString &name)
 
 void FileOperation::finish (bool ok)
 {
+  if (!target_.filePath ().isEmpty ())
+  {
+    DirSizes::invalidate (target_.absoluteFilePath ());
+  }
+  if (action_ == FileOperation::Action::Move || action_ == FileOperation::Action::Remove ||
+      action_ == FileOperation::Action::Trash)
+  {
+    for (const auto &i: sources_)
+    {
+      DirSizes::invalidate (i.absolutePath ());
+    }
+  }
   emit finished (ok, this);
 }
 
@@ -201,9 +223,7 @@ bool FileOperation::copy (const QString &oldName, const QString &newName)
 
 bool FileOperation::rename (const QString &oldName, const QString &newName)
 {
-  auto source = StorageManager::storage (oldName);
-  auto target = StorageManager::storage (newName);
-  if (source == target)
+  if (StorageManager::isSameStorage (oldName, newName))
   {
     QFile in (newName);
     const auto size = in.size ();
@@ -265,6 +285,11 @@ bool FileOperation::rename (const QString &oldName, const QString &newName)
 bool FileOperation::transfer (const FileOperation::Infos &sources, const QFileInfo &target,
                               int depth)
 {
+  if (depth == 0)
+  {
+    measure ();
+  }
+
   auto ok = true;
   const auto shouldRename = (depth == 0 && !target.exists () && sources.size () == 1);
   QDir targetDir (target.absoluteFilePath ());
@@ -412,6 +437,11 @@ bool FileOperation::link (const FileOperation::Infos &sources, const QFileInfo &
 
 bool FileOperation::erase (const FileOperation::Infos &infos, int depth)
 {
+  if (depth == 0)
+  {
+    measure ();
+  }
+
   auto ok = true;
   for (const auto &i: infos)
   {
@@ -36,6 +36,7 @@ private:
   bool erase (const Infos &infos, int depth);
 
   int resolveConflict (const QFileInfo &source, const QFileInfo &target);
+  void measure ();
   void advance (qint64 size);
   void setCurrent (const QString &name);
   void finish (bool ok);
@@ -0,0 +1,667 @@
+#include "direntries.h"
+#include "constants.h"
+#include "debug.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QDir>
+#include <QSet>
+#include <QReadWriteLock>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <grp.h>
+#include <climits>
+#include <cerrno>
+#endif
+
+namespace
+{
+
+//! User or group names interned by id. Filled by listing workers, read by views.
+class NameTable
+{
+public:
+  using Resolver = QString (*)(quint32 id);
+
+  explicit NameTable (Resolver resolver) :
+    resolver_ (resolver),
+    lock_ (),
+    names_ ()
+  {
+  }
+
+  QString name (quint32 id)
+  {
+    {
+      QReadLocker locker (&lock_);
+      const auto it = names_.constFind (id);
+      if (it != names_.constEnd ())
+      {
+        return it.value ();
+      }
+    }
+    const auto name = resolver_ ? resolver_ (id) : QString ();
+    QWriteLocker locker (&lock_);
+    names_.insert (id, name);
+    return name;
+  }
+
+  quint32 id (const QString &name)
+  {
+    QWriteLocker locker (&lock_);
+    for (auto it = names_.cbegin (), end = names_.cend (); it != end; ++it)
+    {
+      if (it.value () == name)
+      {
+        return it.key ();
+      }
+    }
+    const auto id = quint32 (names_.size ());
+    names_.insert (id, name);
+    return id;
+  }
+
+private:
+  Resolver resolver_;
+  QReadWriteLock lock_;
+  QHash<quint32, QString> names_;
+};
+
+
+quint8 toColorClass (quint8 flags, quint16 permissions)
+{
+  const auto isExecutable = (permissions & QFile::ExeUser) != 0;
+  const auto isReadable = (permissions & QFile::ReadUser) != 0;
+  if (flags & DirEntries::IsDir)
+  {
+    return (isExecutable && isReadable) ? DirEntries::Dir : DirEntries::InaccessibleDir;
+  }
+  if (isExecutable)
+  {
+    return DirEntries::Executable;
+  }
+  return isReadable ? DirEntries::Plain : DirEntries::UnreadableFile;
+}
+
+
+#ifdef Q_OS_UNIX
+QString childPath (const QString &path, const QString &name)
+{
+  return path.endsWith (QLatin1Char ('/')) ? path + name : path + QLatin1Char ('/') + name;
+}
+
+QString resolveUser (quint32 id)
+{
+  QByteArray buffer (1024, Qt::Uninitialized);
+  struct passwd entry;
+  struct passwd *found = nullptr;
+  int error = 0;
+  while ((error = ::getpwuid_r (id, &entry, buffer.data (), buffer.size (), &found)) == ERANGE &&
+         buffer.size () < (1 << 20))
+  {
+    buffer.resize (buffer.size () * 2);
+  }
+  return (error == 0 && found) ? QFile::decodeName (entry.pw_name) : QString::number (id);
+}
+
+QString resolveGroup (quint32 id)
+{
+  QByteArray buffer (1024, Qt::Uninitialized);
+  struct group entry;
+  struct group *found = nullptr;
+  int error = 0;
+  while ((error = ::getgrgid_r (id, &entry, buffer.data (), buffer.size (), &found)) == ERANGE &&
+         buffer.size () < (1 << 20))
+  {
+    buffer.resize (buffer.size () * 2);
+  }
+  return (error == 0 && found) ? QFile::decodeName (entry.gr_name) : QString::number (id);
+}
+
+NameTable &userNames ()
+{
+  static NameTable table (resolveUser);
+  return table;
+}
+
+NameTable &groupNames ()
+{
+  static NameTable table (resolveGroup);
+  return table;
+}
+
+QString toLinkTarget (const QString &dir, const QByteArray &target)
+{
+  const auto decoded = QFile::decodeName (target);
+  return QDir::cleanPath (decoded.startsWith (QLatin1Char ('/')) ? decoded
+                                                                 : childPath (dir, decoded));
+}
+
+bool isInGroup (gid_t group)
+{
+  static const auto groups = [] {
+                               QVector<gid_t> result (std::max (0, ::getgroups (0, nullptr)));
+                               if (!result.isEmpty ())
+                               {
+                                 result.resize (std::max (0, ::getgroups (result.size (), result.data ())));
+                               }
+                               result.append (::getegid ());
+                               return result;
+                             } ();
+  return groups.contains (group);
+}
+
+quint16 toPermissions (const struct stat &st)
+{
+  using P = QFile::Permission;
+  const auto mode = st.st_mode;
+  QFile::Permissions result;
+  result |= (mode & S_IRUSR) ? P::ReadOwner : P (0);
+  result |= (mode & S_IWUSR) ? P::WriteOwner : P (0);
+  result |= (mode & S_IXUSR) ? P::ExeOwner : P (0);
+  result |= (mode & S_IRGRP) ? P::ReadGroup : P (0);
+  result |= (mode & S_IWGRP) ? P::WriteGroup : P (0);
+  result |= (mode & S_IXGRP) ? P::ExeGroup : P (0);
+  result |= (mode & S_IROTH) ? P::ReadOther : P (0);
+  result |= (mode & S_IWOTH) ? P::WriteOther : P (0);
+  result |= (mode & S_IXOTH) ? P::ExeOther : P (0);
+
+  // user bits are the ones that apply to the current process
+  const auto euid = ::geteuid ();
+  if (euid == 0)
+  {
+    result |= P::ReadUser | P::WriteUser;
+    if (S_ISDIR (mode) || (mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+    {
+      result |= P::ExeUser;
+    }
+  }
+  else
+  {
+    const auto shift = (st.st_uid == euid ? 6 : isInGroup (st.st_gid) ? 3 : 0);
+    const auto bits = (mode >> shift) & 07;
+    result |= (bits & 04) ? P::ReadUser : P (0);
+    result |= (bits & 02) ? P::WriteUser : P (0);
+    result |= (bits & 01) ? P::ExeUser : P (0);
+  }
+  return quint16 (result);
+}
+
+qint64 toMsecs (const struct stat &st)
+{
+#ifdef Q_OS_MAC
+  return qint64 (st.st_mtimespec.tv_sec) * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#else
+  return qint64 (st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#endif
+}
+
+qint64 toStamp (const struct stat &st)
+{
+#ifdef Q_OS_MAC
+  return qint64 (st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+  return qint64 (st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+void appendEntry (DirEntries &target, const QString &name, const struct stat &link,
+                  const struct stat *resolved, const QString &linkTarget)
+{
+  const auto &st = resolved ? *resolved : link;
+  quint8 flags = 0;
+  flags |= S_ISDIR (st.st_mode) ? DirEntries::IsDir : 0;
+  flags |= S_ISREG (st.st_mode) ? DirEntries::IsFile : 0;
+  flags |= S_ISLNK (link.st_mode) ? DirEntries::IsSymLink : 0;
+  if (name == constants::dotdot)
+  {
+    flags |= DirEntries::IsDotDot;
+  }
+  else if (name.startsWith (QLatin1Char ('.')))
+  {
+    flags |= DirEntries::IsHidden;
+  }
+
+  const auto permissions = toPermissions (st);
+  target.names.append (name);
+  target.sizes.append (st.st_size);
+  target.modified.append (toMsecs (st));
+  target.permissions.append (permissions);
+  target.flags.append (flags);
+  target.colorClasses.append (toColorClass (flags, permissions));
+  target.owners.append (quint32 (link.st_uid));
+  target.groups.append (quint32 (link.st_gid));
+  target.linkTargets.append (linkTarget);
+  target.devices.append (quint64 (st.st_dev));
+}
+
+bool statEntry (const QString &dir, int dirFd, const QByteArray &name, DirEntries &target)
+{
+  struct stat link;
+  if (::fstatat (dirFd, name.constData (), &link, AT_SYMLINK_NOFOLLOW) != 0)
+  {
+    return false;
+  }
+
+  if (!S_ISLNK (link.st_mode))
+  {
+    appendEntry (target, QFile::decodeName (name), link, nullptr, {});
+    return true;
+  }
+
+  struct stat resolved;
+  const auto isResolved = ::fstatat (dirFd, name.constData (), &resolved, 0) == 0;
+  char buffer[PATH_MAX];
+  const auto size = ::readlinkat (dirFd, name.constData (), buffer, sizeof (buffer));
+  const auto linkTarget = size > 0 ? toLinkTarget (dir, QByteArray (buffer, int (size)))
+                                   : QString ();
+  appendEntry (target, QFile::decodeName (name), link, isResolved ? &resolved : nullptr,
+               linkTarget);
+  return true;
+}
+
+//! Resolve names in background so views only read interned ones.
+void resolveNames (const DirEntries &entries)
+{
+  QSet<quint32> ownerIds;
+  QSet<quint32> groupIds;
+  for (auto i = 0, end = entries.count (); i < end; ++i)
+  {
+    ownerIds.insert (entries.owners[i]);
+    groupIds.insert (entries.groups[i]);
+  }
+  for (const auto id: ownerIds)
+  {
+    userNames ().name (id);
+  }
+  for (const auto id: groupIds)
+  {
+    groupNames ().name (id);
+  }
+}
+#else
+NameTable &userNames ()
+{
+  static NameTable table (nullptr);
+  return table;
+}
+
+NameTable &groupNames ()
+{
+  static NameTable table (nullptr);
+  return table;
+}
+
+void appendEntry (DirEntries &target, const QString &name, const QFileInfo &info)
+{
+  quint8 flags = 0;
+  flags |= info.isDir () ? DirEntries::IsDir : 0;
+  flags |= info.isFile () ? DirEntries::IsFile : 0;
+  flags |= info.isSymLink () ? DirEntries::IsSymLink : 0;
+  if (name == constants::dotdot)
+  {
+    flags |= DirEntries::IsDotDot;
+  }
+  else if (info.isHidden ())
+  {
+    flags |= DirEntries::IsHidden;
+  }
+
+  const auto permissions = quint16 (info.permissions ());
+  target.names.append (name);
+  target.sizes.append (info.size ());
+  target.modified.append (info.lastModified ().toMSecsSinceEpoch ());
+  target.permissions.append (permissions);
+  target.flags.append (flags);
+  target.colorClasses.append (toColorClass (flags, permissions));
+  target.owners.append (userNames ().id (info.owner ()));
+  target.groups.append (groupNames ().id (info.group ()));
+  target.linkTargets.append (info.isSymLink () ? info.symLinkTarget () : QString ());
+  const auto filePath = info.absoluteFilePath ();
+  target.devices.append (qHash (filePath.left (filePath.indexOf (QLatin1Char ('/')) + 1)));
+}
+#endif
+
+
+//! Passes rows read since the last report once there are enough of them.
+class ChunkReporter
+{
+public:
+  explicit ChunkReporter (const DirEntries::ChunkHandler &handler) :
+    handler_ (handler),
+    reported_ (0),
+    chunkRows_ (1000)
+  {
+  }
+
+  void check (const DirEntries &entries)
+  {
+    const auto count = entries.count ();
+    if (!handler_ || count - reported_ < chunkRows_)
+    {
+      return;
+    }
+    const auto chunk = entries.mid (reported_, count - reported_);
+#ifdef Q_OS_UNIX
+    resolveNames (chunk);
+#endif
+    handler_ (chunk);
+    reported_ = count;
+    chunkRows_ = std::min (chunkRows_ * 2, 100000);
+  }
+
+private:
+  const DirEntries::ChunkHandler &handler_;
+  int reported_;
+  int chunkRows_;
+};
+
+
+bool readFileEntry (const QString &filePath, const QString &name, DirEntries &target)
+{
+#ifdef Q_OS_UNIX
+  const auto encoded = QFile::encodeName (filePath);
+  struct stat link;
+  if (::lstat (encoded.constData (), &link) != 0)
+  {
+    return false;
+  }
+  if (!S_ISLNK (link.st_mode))
+  {
+    appendEntry (target, name, link, nullptr, {});
+    return true;
+  }
+
+  struct stat resolved;
+  const auto isResolved = ::stat (encoded.constData (), &resolved) == 0;
+  char buffer[PATH_MAX];
+  const auto size = ::readlink (encoded.constData (), buffer, sizeof (buffer));
+  const auto linkTarget = size > 0
+                          ? toLinkTarget (QFileInfo (filePath).absolutePath (),
+                                          QByteArray (buffer, int (size)))
+                          : QString ();
+  appendEntry (target, name, link, isResolved ? &resolved : nullptr, linkTarget);
+  return true;
+#else
+  const QFileInfo info (filePath);
+  if (!info.exists ())
+  {
+    return false;
+  }
+  appendEntry (target, name, info);
+  return true;
+#endif
+}
+
+}
+
+
+DirEntries DirEntries::read (const QString &path, const ChunkHandler &handler)
+{
+  DirEntries result;
+  ChunkReporter reporter (handler);
+
+#ifdef Q_OS_UNIX
+  const auto encoded = QFile::encodeName (path);
+  auto dir = ::opendir (encoded.constData ());
+  if (!dir)
+  {
+    // unreadable but existing directory is still valid
+    struct stat st;
+    if (::stat (encoded.constData (), &st) == 0)
+    {
+      result.isValid = S_ISDIR (st.st_mode);
+      result.device = quint64 (st.st_dev);
+    }
+    else
+    {
+      result.isValid = (errno != ENOENT && errno != ENOTDIR);
+    }
+    if (result.isValid)
+    {
+      readEntry (childPath (path, constants::dotdot), constants::dotdot, result);
+    }
+    return result;
+  }
+
+  const auto fd = ::dirfd (dir);
+  struct stat st;
+  if (::fstat (fd, &st) == 0)
+  {
+    result.device = quint64 (st.st_dev);
+    result.stamp = toStamp (st);
+  }
+  result.isValid = true;
+
+  while (auto entry = ::readdir (dir))
+  {
+    const QByteArray name (entry->d_name);
+    if (name == ".")
+    {
+      continue;
+    }
+    if (!statEntry (path, fd, name, result))
+    {
+      LDEBUG () << "Failed to stat" << LARG (path) << LARG (name);
+    }
+    reporter.check (result);
+  }
+  ::closedir (dir);
+  resolveNames (result);
+#else
+  const QFileInfo self (path);
+  result.isValid = self.isDir ();
+  if (!result.isValid)
+  {
+    return result;
+  }
+  result.device = qHash (path.left (path.indexOf (QLatin1Char ('/')) + 1));
+  result.stamp = self.lastModified ().toMSecsSinceEpoch ();
+
+  QDirIterator it (path, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDot);
+  while (it.hasNext ())
+  {
+    it.next ();
+    const auto info = it.fileInfo ();
+    appendEntry (result, it.fileName (), info);
+    reporter.check (result);
+  }
+#endif
+
+  result.names.squeeze ();
+  result.sizes.squeeze ();
+  result.modified.squeeze ();
+  result.permissions.squeeze ();
+  result.flags.squeeze ();
+  result.colorClasses.squeeze ();
+  result.owners.squeeze ();
+  result.groups.squeeze ();
+  result.linkTargets.squeeze ();
+  result.devices.squeeze ();
+  return result;
+}
+
+qint64 DirEntries::stamp (const QString &path)
+{
+#ifdef Q_OS_UNIX
+  struct stat st;
+  if (::stat (QFile::encodeName (path).constData (), &st) != 0)
+  {
+    return 0;
+  }
+  return toStamp (st);
+#else
+  const QFileInfo info (path);
+  return info.exists () ? info.lastModified ().toMSecsSinceEpoch () : 0;
+#endif
+}
+
+bool DirEntries::readEntry (const QString &filePath, const QString &name, DirEntries &target)
+{
+  const auto isRead = readFileEntry (filePath, name, target);
+  if (isRead && !target.rows_.isEmpty ())
+  {
+    target.rows_.insert (name, target.count () - 1);
+  }
+  return isRead;
+}
+
+int DirEntries::count () const
+{
+  return names.size ();
+}
+
+int DirEntries::find (const QString &name) const
+{
+  if (rows_.isEmpty ())
+  {
+    rows_.reserve (names.size ());
+    for (auto i = 0, end = names.size (); i < end; ++i)
+    {
+      rows_.insert (names[i], i);
+    }
+  }
+  return rows_.value (name, -1);
+}
+
+bool DirEntries::has (int row, DirEntries::Flag flag) const
+{
+  return flags[row] & flag;
+}
+
+QString DirEntries::owner (int row) const
+{
+  return userNames ().name (owners[row]);
+}
+
+QString DirEntries::group (int row) const
+{
+  return groupNames ().name (groups[row]);
+}
+
+void DirEntries::append (const DirEntries &source, int sourceRow)
+{
+  names.append (source.names[sourceRow]);
+  sizes.append (source.sizes[sourceRow]);
+  modified.append (source.modified[sourceRow]);
+  permissions.append (source.permissions[sourceRow]);
+  flags.append (source.flags[sourceRow]);
+  colorClasses.append (source.colorClasses[sourceRow]);
+  owners.append (source.owners[sourceRow]);
+  groups.append (source.groups[sourceRow]);
+  linkTargets.append (source.linkTargets[sourceRow]);
+  devices.append (source.devices[sourceRow]);
+  if (!rows_.isEmpty ())
+  {
+    rows_.insert (names.last (), names.size () - 1);
+  }
+}
+
+DirEntries DirEntries::mid (int first, int count) const
+{
+  DirEntries result;
+  result.names = names.mid (first, count);
+  result.sizes = sizes.mid (first, count);
+  result.modified = modified.mid (first, count);
+  result.permissions = permissions.mid (first, count);
+  result.flags = flags.mid (first, count);
+  result.colorClasses = colorClasses.mid (first, count);
+  result.owners = owners.mid (first, count);
+  result.groups = groups.mid (first, count);
+  result.linkTargets = linkTargets.mid (first, count);
+  result.devices = devices.mid (first, count);
+  result.device = device;
+  result.stamp = stamp;
+  result.isValid = isValid;
+  return result;
+}
+
+void DirEntries::assign (int row, const DirEntries &source, int sourceRow)
+{
+  rename (row, source.names[sourceRow]);
+  sizes[row] = source.sizes[sourceRow];
+  modified[row] = source.modified[sourceRow];
+  permissions[row] = source.permissions[sourceRow];
+  flags[row] = source.flags[sourceRow];
+  colorClasses[row] = source.colorClasses[sourceRow];
+  owners[row] = source.owners[sourceRow];
+  groups[row] = source.groups[sourceRow];
+  linkTargets[row] = source.linkTargets[sourceRow];
+  devices[row] = source.devices[sourceRow];
+}
+
+bool DirEntries::equals (int row, const DirEntries &source, int sourceRow) const
+{
+  return sizes[row] == source.sizes[sourceRow] &&
+         modified[row] == source.modified[sourceRow] &&
+         permissions[row] == source.permissions[sourceRow] &&
+         flags[row] == source.flags[sourceRow] &&
+         owners[row] == source.owners[sourceRow] &&
+         groups[row] == source.groups[sourceRow] &&
+         linkTargets[row] == source.linkTargets[sourceRow] &&
+         devices[row] == source.devices[sourceRow];
+}
+
+void DirEntries::rename (int row, const QString &name)
+{
+  if (names[row] == name)
+  {
+    return;
+  }
+  if (!rows_.isEmpty ())
+  {
+    rows_.remove (names[row]);
+    rows_.insert (name, row);
+  }
+  names[row] = name;
+}
+
+void DirEntries::remove (int first, int count)
+{
+  if (!rows_.isEmpty ())
+  {
+    for (auto i = first, end = first + count; i < end; ++i)
+    {
+      rows_.remove (names[i]);
+    }
+    for (auto i = first + count, end = names.size (); i < end; ++i)
+    {
+      rows_[names[i]] = i - count;
+    }
+  }
+  names.remove (first, count);
+  sizes.remove (first, count);
+  modified.remove (first, count);
+  permissions.remove (first, count);
+  flags.remove (first, count);
+  colorClasses.remove (first, count);
+  owners.remove (first, count);
+  groups.remove (first, count);
+  linkTargets.remove (first, count);
+  devices.remove (first, count);
+}
+
+void DirEntries::clear ()
+{
+  names.clear ();
+  sizes.clear ();
+  modified.clear ();
+  permissions.clear ();
+  flags.clear ();
+  colorClasses.clear ();
+  owners.clear ();
+  groups.clear ();
+  linkTargets.clear ();
+  devices.clear ();
+  rows_.clear ();
+}
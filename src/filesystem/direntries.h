@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include <QHash>
+#include <QMetaType>
+
+#include <functional>
+
+// Compact per-directory entry store. Every attribute is kept in its own array
+// so a directory of N entries costs N small records instead of N QFileInfo.
+struct DirEntries
+{
+  enum Flag : quint8
+  {
+    IsDir = 0x01, IsFile = 0x02, IsSymLink = 0x04, IsHidden = 0x08, IsDotDot = 0x10
+  };
+
+  //! How the entry is highlighted, decided once while listing.
+  enum ColorClass : quint8
+  {
+    Plain, Dir, InaccessibleDir, Executable, UnreadableFile,
+    ColorClassCount
+  };
+
+  using ChunkHandler = std::function<void (const DirEntries &chunk)>;
+
+  //! Handler gets rows read so far in growing chunks, so first rows of a huge
+  //! directory can be shown before it is read completely.
+  static DirEntries read (const QString &path, const ChunkHandler &handler = nullptr);
+  static bool readEntry (const QString &filePath, const QString &name, DirEntries &target);
+  //! Modification time of directory itself, changes when entries are added or
+  //! removed. 0 if unknown.
+  static qint64 stamp (const QString &path);
+
+  int count () const;
+  //! Row of name or -1. Rows are indexed by the first call and kept indexed
+  //! by the modifiers below.
+  int find (const QString &name) const;
+  bool has (int row, Flag flag) const;
+  QString owner (int row) const;
+  QString group (int row) const;
+
+  void append (const DirEntries &source, int sourceRow);
+  DirEntries mid (int first, int count) const;
+  void assign (int row, const DirEntries &source, int sourceRow);
+  bool equals (int row, const DirEntries &source, int sourceRow) const;
+  void rename (int row, const QString &name);
+  void remove (int first, int count);
+  void clear ();
+
+  QVector<QString> names;
+  QVector<qint64> sizes;
+  QVector<qint64> modified; // msecs since epoch
+  QVector<quint16> permissions;
+  QVector<quint8> flags;
+  QVector<quint8> colorClasses;
+  QVector<quint32> owners; // ids of interned names, see owner ()
+  QVector<quint32> groups;
+  QVector<QString> linkTargets; // absolute, empty if not a link
+  QVector<quint64> devices; // differs from directory one for mount points
+  quint64 device{0};
+  qint64 stamp{0}; // of directory when it was read, see stamp ()
+  bool isValid{false};
+  bool isUnchanged{false}; // not read again because stamp did not change
+
+private:
+  mutable QHash<QString, int> rows_; // name -> row, empty until find ()
+};
+
+Q_DECLARE_METATYPE (DirEntries)
@@ -0,0 +1,261 @@
+#include "dirlister.h"
+#include "debug.h"
+#include "backport.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+
+struct DirListerState
+{
+  QMutex mutex;
+  DirLister *lister;
+};
+
+namespace
+{
+const int listPriority = 1;
+const int prefetchPriority = 0;
+
+//! Removes task from queue if it is not started yet.
+bool takeQueued (QThreadPool *pool, QRunnable *task)
+{
+#if QT_VERSION >= QT_VERSION_CHECK (5, 9, 0)
+  return pool->tryTake (task);
+#else
+  Q_UNUSED (pool);
+  Q_UNUSED (task);
+  return false;
+#endif
+}
+
+QString childPath (const QString &path, const QString &name)
+{
+  if (path.isEmpty ())
+  {
+    return name;
+  }
+  return path.endsWith (QLatin1Char ('/')) ? path + name : path + QLatin1Char ('/') + name;
+}
+
+class ListTask : public QRunnable
+{
+public:
+  ListTask (const QString &path, quint64 device,
+            const QSharedPointer<DirListerState> &state, qint64 knownStamp = 0) :
+    path_ (path),
+    device_ (device),
+    knownStamp_ (knownStamp),
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  QString path_;
+  quint64 device_;
+  qint64 knownStamp_;
+  QSharedPointer<DirListerState> state_;
+};
+
+class PathTask : public QRunnable
+{
+public:
+  PathTask (const QString &dir, const QStringList &names,
+            const QSharedPointer<DirListerState> &state) :
+    dir_ (dir),
+    names_ (names),
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  QString dir_;
+  QStringList names_;
+  QSharedPointer<DirListerState> state_;
+};
+}
+
+DirLister::DirLister (QObject *parent) :
+  QObject (parent),
+  state_ (new DirListerState),
+  pools_ (),
+  pending_ (),
+  prefetching_ ()
+{
+  state_->lister = this;
+  qRegisterMetaType<DirEntries>();
+}
+
+DirLister::~DirLister ()
+{
+  {
+    QMutexLocker locker (&state_->mutex);
+    state_->lister = nullptr;
+  }
+
+  for (auto *pool: pools_)
+  {
+    pool->clear ();
+    if (!pool->waitForDone (1000))
+    {
+      LWARNING () << "Directory listing hangs. Leaving its worker";
+      continue;
+    }
+    delete pool;
+  }
+}
+
+void DirLister::list (const QString &path, quint64 device)
+{
+  const auto prefetch = prefetching_.find (path);
+  if (prefetch != prefetching_.end ())
+  {
+    // queued prefetch may wait long, list in front of it. Running one is
+    // waited for
+    auto *task = prefetch.value ();
+    prefetching_.erase (prefetch);
+    auto *devicePool = pool (device);
+    if (takeQueued (devicePool, task))
+    {
+      devicePool->start (task, listPriority);
+    }
+    return;
+  }
+  if (pending_.contains (path))
+  {
+    pending_[path] = true;
+    return;
+  }
+  pending_.insert (path, false);
+
+  auto task = new ListTask (path, device, state_);
+  pool (device)->start (task, listPriority);
+}
+
+void DirLister::revalidate (const QString &path, quint64 device, qint64 knownStamp)
+{
+  if (knownStamp == 0 || pending_.contains (path))
+  {
+    list (path, device);
+    return;
+  }
+  pending_.insert (path, false);
+
+  auto task = new ListTask (path, device, state_, knownStamp);
+  pool (device)->start (task, listPriority);
+}
+
+void DirLister::prefetch (const QString &path, quint64 device)
+{
+  if (pending_.contains (path))
+  {
+    return;
+  }
+  pending_.insert (path, false);
+
+  auto task = new ListTask (path, device, state_);
+  prefetching_.insert (path, task);
+  pool (device)->start (task, prefetchPriority);
+}
+
+void DirLister::readPath (const QString &dir, const QStringList &names, quint64 device)
+{
+  auto task = new PathTask (dir, names, state_);
+  pool (device)->start (task, listPriority);
+}
+
+void DirLister::finishPart (const QString &path, const DirEntries &entries)
+{
+  emit listedPart (path, entries);
+}
+
+void DirLister::finish (const QString &path, const DirEntries &entries, quint64 device)
+{
+  prefetching_.remove (path);
+  const auto repeat = pending_.take (path);
+  emit listed (path, entries);
+  if (repeat)
+  {
+    list (path, entries.isValid ? entries.device : device);
+  }
+}
+
+void DirLister::finishPath (const QString &dir, const QStringList &names,
+                            const DirEntries &entries)
+{
+  emit pathRead (dir, names, entries);
+}
+
+QThreadPool * DirLister::pool (quint64 device)
+{
+  auto &pool = pools_[device];
+  if (!pool)
+  {
+    pool = new QThreadPool;
+    pool->setMaxThreadCount (1);
+  }
+  return pool;
+}
+
+void ListTask::run ()
+{
+  DirEntries entries;
+  if (knownStamp_ != 0 && DirEntries::stamp (path_) == knownStamp_)
+  {
+    entries.isValid = true;
+    entries.isUnchanged = true;
+    entries.device = device_;
+    entries.stamp = knownStamp_;
+  }
+  else
+  {
+    auto state = state_;
+    const auto path = path_;
+    entries = DirEntries::read (path_, [state, path](const DirEntries &chunk) {
+                                 QMutexLocker locker (&state->mutex);
+                                 if (state->lister)
+                                 {
+                                   QMetaObject::invokeMethod (state->lister, "finishPart",
+                                                              Qt::QueuedConnection,
+                                                              Q_ARG (QString, path),
+                                                              Q_ARG (DirEntries, chunk));
+                                 }
+                               });
+  }
+
+  QMutexLocker locker (&state_->mutex);
+  if (state_->lister)
+  {
+    QMetaObject::invokeMethod (state_->lister, "finish", Qt::QueuedConnection,
+                               Q_ARG (QString, path_), Q_ARG (DirEntries, entries),
+                               Q_ARG (quint64, device_));
+  }
+}
+
+void PathTask::run ()
+{
+  DirEntries entries;
+  auto path = dir_;
+  for (const auto &name: nonstd::as_const (names_))
+  {
+    path = childPath (path, name);
+    if (!DirEntries::readEntry (path, name, entries))
+    {
+      break;
+    }
+  }
+
+  QMutexLocker locker (&state_->mutex);
+  if (state_->lister)
+  {
+    QMetaObject::invokeMethod (state_->lister, "finishPath", Qt::QueuedConnection,
+                               Q_ARG (QString, dir_), Q_ARG (QStringList, names_),
+                               Q_ARG (DirEntries, entries));
+  }
+}
+
+#include "moc_dirlister.cpp"
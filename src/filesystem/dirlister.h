@@ -0,0 +1,51 @@
+#pragma once
+
+#include "direntries.h"
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QSharedPointer>
+
+class QThreadPool;
+class QRunnable;
+struct DirListerState;
+
+// Lists directories in background. Every device gets its own serial worker so
+// a slow network mount does not delay listings of local disks. Prefetches wait
+// for all regular listings of their device. Huge directories are reported in
+// parts while they are read.
+class DirLister : public QObject
+{
+Q_OBJECT
+public:
+  explicit DirLister (QObject *parent = nullptr);
+  ~DirLister ();
+
+  void list (const QString &path, quint64 device);
+  //! Lists only if stamp of directory differs from known one.
+  void revalidate (const QString &path, quint64 device, qint64 knownStamp);
+  void prefetch (const QString &path, quint64 device);
+  //! Reads entries of names below dir, each one inside the previous one.
+  void readPath (const QString &dir, const QStringList &names, quint64 device);
+
+signals:
+  //! Rows read so far, followed by more parts and the complete listing.
+  void listedPart (const QString &path, const DirEntries &entries);
+  void listed (const QString &path, const DirEntries &entries);
+  //! Entries of leading names that exist, up to the first missing one.
+  void pathRead (const QString &dir, const QStringList &names, const DirEntries &entries);
+
+private slots:
+  void finishPart (const QString &path, const DirEntries &entries);
+  void finish (const QString &path, const DirEntries &entries, quint64 device);
+  void finishPath (const QString &dir, const QStringList &names, const DirEntries &entries);
+
+private:
+  QThreadPool * pool (quint64 device);
+
+  QSharedPointer<DirListerState> state_;
+  QHash<quint64, QThreadPool *> pools_;
+  QHash<QString, bool> pending_; // path -> needs one more listing
+  QHash<QString, QRunnable *> prefetching_; // pending prefetch tasks, not owned
+};
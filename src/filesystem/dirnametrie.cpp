@@ -0,0 +1,198 @@
+#include "dirnametrie.h"
+#include "namefilter.h"
+
+#include <QDir>
+#include <QDateTime>
+#include <QSet>
+
+#include <algorithm>
+
+namespace
+{
+const int maxNodes = 200000;
+
+#ifdef Q_OS_WIN
+const auto caseSensitivity = Qt::CaseInsensitive;
+QString toKey (const QString &name)
+{
+  return name.toCaseFolded ();
+}
+#else
+const auto caseSensitivity = Qt::CaseSensitive;
+QString toKey (const QString &name)
+{
+  return name;
+}
+#endif
+
+QStringList toParts (const QString &dir)
+{
+  return QDir::cleanPath (QDir::fromNativeSeparators (dir))
+         .split (QLatin1Char ('/'), QString::SkipEmptyParts);
+}
+}
+
+
+struct DirNameTrie::Node
+{
+  ~Node ()
+  {
+    qDeleteAll (children);
+  }
+
+  QString name;
+  QMap<QString, Node *> children; // by key of name
+  qint64 listedAt{0};
+};
+
+
+DirNameTrie::DirNameTrie () :
+  root_ (new Node),
+  nodeCount_ (0)
+{
+}
+
+DirNameTrie::~DirNameTrie () = default;
+
+void DirNameTrie::add (const QString &dir, const QStringList &names)
+{
+  if (nodeCount_ + names.size () > maxNodes)
+  {
+    clear ();
+  }
+
+  auto *node = find (dir, true);
+  for (const auto &i: names)
+  {
+    insert (node, i);
+  }
+}
+
+void DirNameTrie::reset (const QString &dir, const QStringList &names)
+{
+  add (dir, names);
+
+  auto *node = find (dir, true);
+  node->listedAt = QDateTime::currentMSecsSinceEpoch ();
+
+  QSet<QString> keys;
+  for (const auto &i: names)
+  {
+    keys.insert (toKey (i));
+  }
+  for (auto it = node->children.begin (); it != node->children.end ();)
+  {
+    if (keys.contains (it.key ()))
+    {
+      ++it;
+      continue;
+    }
+    delete it.value ();
+    it = node->children.erase (it);
+    --nodeCount_;
+  }
+}
+
+qint64 DirNameTrie::listedAt (const QString &dir) const
+{
+  const auto *node = find (dir, false);
+  return node ? node->listedAt : 0;
+}
+
+QStringList DirNameTrie::complete (const QString &dir, const QString &prefix, int limit) const
+{
+  const auto *node = find (dir, false);
+  if (!node)
+  {
+    return {};
+  }
+
+  const auto showHidden = prefix.startsWith (QLatin1Char ('.'));
+  QStringList result;
+
+  const auto key = toKey (prefix);
+  for (auto it = node->children.lowerBound (key), end = node->children.end ();
+       it != end && result.size () < limit && it.key ().startsWith (key); ++it)
+  {
+    const auto &name = it.value ()->name;
+    if (showHidden || !name.startsWith (QLatin1Char ('.')))
+    {
+      result << name;
+    }
+  }
+
+  if (prefix.isEmpty () || result.size () >= limit)
+  {
+    return result;
+  }
+
+  const NameFilter filter (prefix, NameFilter::Mode::Fuzzy);
+  QVector<QPair<int, QString> > fuzzy;
+  for (const auto *child: node->children)
+  {
+    const auto &name = child->name;
+    if ((!showHidden && name.startsWith (QLatin1Char ('.'))) ||
+        name.startsWith (prefix, caseSensitivity))
+    {
+      continue;
+    }
+    const auto score = filter.score (name);
+    if (score >= 0)
+    {
+      fuzzy.append ({score, name});
+    }
+  }
+  std::stable_sort (fuzzy.begin (), fuzzy.end (),
+                    [](const QPair<int, QString> &l, const QPair<int, QString> &r) {
+                      return l.first > r.first;
+                    });
+  for (const auto &i: fuzzy)
+  {
+    if (result.size () >= limit)
+    {
+      break;
+    }
+    result << i.second;
+  }
+  return result;
+}
+
+void DirNameTrie::clear ()
+{
+  root_.reset (new Node);
+  nodeCount_ = 0;
+}
+
+DirNameTrie::Node * DirNameTrie::find (const QString &dir, bool isCreated) const
+{
+  auto *node = root_.get ();
+  for (const auto &i: toParts (dir))
+  {
+    const auto key = toKey (i);
+    auto *child = node->children.value (key);
+    if (!child)
+    {
+      if (!isCreated)
+      {
+        return nullptr;
+      }
+      const_cast<DirNameTrie *>(this)->insert (node, i);
+      child = node->children.value (key);
+    }
+    node = child;
+  }
+  return node;
+}
+
+void DirNameTrie::insert (Node *node, const QString &name)
+{
+  const auto key = toKey (name);
+  if (node->children.contains (key))
+  {
+    return;
+  }
+  auto *child = new Node;
+  child->name = name;
+  node->children.insert (key, child);
+  ++nodeCount_;
+}
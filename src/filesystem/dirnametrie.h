@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+
+#include <memory>
+
+// Names of known directories as a tree of path components. Subdirectories of
+// a directory are kept sorted, so names starting with a prefix are found by
+// one lookup. Not thread safe.
+class DirNameTrie
+{
+public:
+  DirNameTrie ();
+  ~DirNameTrie ();
+
+  //! Adds names to ones already known.
+  void add (const QString &dir, const QStringList &names);
+  //! Replaces known names with the complete listing.
+  void reset (const QString &dir, const QStringList &names);
+  //! Msecs since epoch of the last complete listing, 0 if never listed.
+  qint64 listedAt (const QString &dir) const;
+
+  //! Names starting with prefix, then fuzzy matched ones by match quality.
+  //! Hidden names are matched only by prefix that starts with a dot.
+  QStringList complete (const QString &dir, const QString &prefix, int limit) const;
+
+  void clear ();
+
+private:
+  struct Node;
+
+  Node * find (const QString &dir, bool isCreated) const;
+  void insert (Node *node, const QString &name);
+
+  std::unique_ptr<Node> root_;
+  int nodeCount_;
+};
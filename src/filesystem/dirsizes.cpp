@@ -0,0 +1,451 @@
+#include "dirsizes.h"
+#include "debug.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+#ifdef Q_OS_UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <QDirIterator>
+#include <QDateTime>
+#endif
+
+struct DirSizesState
+{
+  QMutex mutex;
+  DirSizes *owner;
+  QStringList queue; // most wanted last
+  QVector<DirSizes::Size> computed;
+  int workerCount;
+  std::atomic_bool isAborted;
+};
+
+namespace
+{
+const int deliveryDelayMs = 100;
+const int maxCachedSizes = 500000;
+const qint64 aborted = -1;
+
+using Key = QPair<quint64, quint64>; // device, inode
+
+struct Known
+{
+  qint64 size;
+  qint64 changed; // of directory itself, detects direct changes and reused inodes
+};
+
+struct Cache
+{
+  QMutex mutex;
+  QHash<Key, Known> sizes;
+  QSet<QString> outdated; // paths that are resolved to keys by next lookup
+};
+
+Cache &cache ()
+{
+  static Cache instance;
+  return instance;
+}
+
+qint64 cachedSize (const Key &key, qint64 changed)
+{
+  auto &c = cache ();
+  QMutexLocker locker (&c.mutex);
+  const auto known = c.sizes.constFind (key);
+  return (known != c.sizes.constEnd () && known->changed == changed) ? known->size : -1;
+}
+
+void storeSize (const Key &key, qint64 changed, qint64 size)
+{
+  auto &c = cache ();
+  QMutexLocker locker (&c.mutex);
+  if (c.sizes.size () >= maxCachedSizes)
+  {
+    c.sizes.clear ();
+  }
+  c.sizes.insert (key, {size, changed});
+}
+
+void forgetSize (const Key &key)
+{
+  auto &c = cache ();
+  QMutexLocker locker (&c.mutex);
+  c.sizes.remove (key);
+}
+
+
+#ifdef Q_OS_UNIX
+Key toKey (const struct stat &st)
+{
+  return {quint64 (st.st_dev), quint64 (st.st_ino)};
+}
+
+qint64 toChanged (const struct stat &st)
+{
+#ifdef Q_OS_MAC
+  return qint64 (st.st_ctimespec.tv_sec) * 1000000000 + st.st_ctimespec.tv_nsec;
+#else
+  return qint64 (st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+#endif
+}
+
+bool keyOf (const QString &path, Key &key, qint64 &changed)
+{
+  struct stat st;
+  if (::stat (QFile::encodeName (path).constData (), &st) != 0)
+  {
+    return false;
+  }
+  key = toKey (st);
+  changed = toChanged (st);
+  return true;
+}
+
+//! Sum of regular file sizes below directory, not crossing its device. Takes
+//! ownership of fd. Sizes of visited directories are cached.
+qint64 walk (int fd, const struct stat &st, const std::atomic_bool &isAborted)
+{
+  const auto key = toKey (st);
+  const auto changed = toChanged (st);
+  const auto known = cachedSize (key, changed);
+  if (known >= 0)
+  {
+    ::close (fd);
+    return known;
+  }
+
+  auto *dir = ::fdopendir (fd);
+  if (!dir)
+  {
+    ::close (fd);
+    return 0;
+  }
+
+  qint64 result = 0;
+  while (const auto *entry = ::readdir (dir))
+  {
+    if (isAborted)
+    {
+      ::closedir (dir);
+      return aborted;
+    }
+
+    const auto *name = entry->d_name;
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+    {
+      continue;
+    }
+
+    struct stat child;
+    if (::fstatat (::dirfd (dir), name, &child, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+      continue;
+    }
+
+    if (S_ISREG (child.st_mode))
+    {
+      result += child.st_size;
+    }
+    else if (S_ISDIR (child.st_mode) && child.st_dev == st.st_dev)
+    {
+      const auto childFd = ::openat (::dirfd (dir), name,
+                                     O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (childFd == -1)
+      {
+        continue;
+      }
+      const auto size = walk (childFd, child, isAborted);
+      if (size == aborted)
+      {
+        ::closedir (dir);
+        return aborted;
+      }
+      result += size;
+    }
+  }
+  ::closedir (dir);
+
+  storeSize (key, changed, result);
+  return result;
+}
+
+qint64 computeSize (const QString &path, const std::atomic_bool &isAborted)
+{
+  const auto fd = ::open (QFile::encodeName (path).constData (),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1)
+  {
+    return 0;
+  }
+  struct stat st;
+  if (::fstat (fd, &st) != 0)
+  {
+    ::close (fd);
+    return 0;
+  }
+  return walk (fd, st, isAborted);
+}
+
+#else
+bool keyOf (const QString &path, Key &key, qint64 &changed)
+{
+  const QFileInfo info (path);
+  if (!info.exists ())
+  {
+    return false;
+  }
+  key = {0, qHash (QDir::cleanPath (path))};
+  changed = info.lastModified ().toMSecsSinceEpoch ();
+  return true;
+}
+
+qint64 computeSize (const QString &path, const std::atomic_bool &isAborted)
+{
+  Key key;
+  qint64 changed = 0;
+  if (!keyOf (path, key, changed))
+  {
+    return 0;
+  }
+  const auto known = cachedSize (key, changed);
+  if (known >= 0)
+  {
+    return known;
+  }
+
+  qint64 result = 0;
+  QDirIterator it (path, QDir::Files | QDir::Dirs | QDir::Hidden | QDir::System |
+                   QDir::NoDotAndDotDot);
+  while (it.hasNext ())
+  {
+    it.next ();
+    if (isAborted)
+    {
+      return aborted;
+    }
+
+    const auto info = it.fileInfo ();
+    if (info.isSymLink ())
+    {
+      continue;
+    }
+    if (!info.isDir ())
+    {
+      result += info.size ();
+      continue;
+    }
+    const auto size = computeSize (info.filePath (), isAborted);
+    if (size == aborted)
+    {
+      return aborted;
+    }
+    result += size;
+  }
+
+  storeSize (key, changed, result);
+  return result;
+}
+#endif
+
+//! Stats paths passed to invalidate and their ancestors in calling thread.
+void forgetOutdated ()
+{
+  QSet<QString> outdated;
+  {
+    auto &c = cache ();
+    QMutexLocker locker (&c.mutex);
+    if (c.outdated.isEmpty ())
+    {
+      return;
+    }
+    outdated.swap (c.outdated);
+  }
+
+  QSet<QString> visited;
+  for (const auto &path: outdated)
+  {
+    auto current = path;
+    while (!visited.contains (current))
+    {
+      visited.insert (current);
+      Key key;
+      qint64 changed = 0;
+      if (keyOf (current, key, changed))
+      {
+        forgetSize (key);
+      }
+      const auto parent = QFileInfo (current).path ();
+      if (parent == current || parent == QLatin1String ("."))
+      {
+        break;
+      }
+      current = parent;
+    }
+  }
+}
+
+
+class SizeTask : public QRunnable
+{
+public:
+  explicit SizeTask (const QSharedPointer<DirSizesState> &state) :
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  QSharedPointer<DirSizesState> state_;
+};
+}
+
+
+DirSizes::DirSizes (QObject *parent) :
+  QObject (parent),
+  state_ (new DirSizesState),
+  pool_ (new QThreadPool),
+  deliveryTimer_ (new QTimer (this)),
+  requested_ ()
+{
+  state_->owner = this;
+  state_->workerCount = 0;
+  state_->isAborted = false;
+
+  deliveryTimer_->setSingleShot (true);
+  deliveryTimer_->setInterval (deliveryDelayMs);
+  connect (deliveryTimer_, &QTimer::timeout,
+           this, &DirSizes::deliver);
+}
+
+DirSizes::~DirSizes ()
+{
+  {
+    QMutexLocker locker (&state_->mutex);
+    state_->owner = nullptr;
+    state_->queue.clear ();
+  }
+  state_->isAborted = true;
+
+  if (!pool_->waitForDone (1000))
+  {
+    LWARNING () << "Directory size computation hangs. Leaving its workers";
+    return;
+  }
+  delete pool_;
+}
+
+qint64 DirSizes::cached (const QString &path)
+{
+  forgetOutdated ();
+  Key key;
+  qint64 changed = 0;
+  return keyOf (path, key, changed) ? cachedSize (key, changed) : -1;
+}
+
+qint64 DirSizes::compute (const QString &path, const std::atomic_bool &isAborted)
+{
+  // cached () resolves outdated paths first
+  const auto known = cached (path);
+  return known >= 0 ? known : computeSize (path, isAborted);
+}
+
+void DirSizes::invalidate (const QString &path)
+{
+  auto &c = cache ();
+  QMutexLocker locker (&c.mutex);
+  if (c.outdated.size () >= maxCachedSizes)
+  {
+    c.outdated.clear ();
+    c.sizes.clear ();
+    return;
+  }
+  c.outdated.insert (QDir::cleanPath (path));
+}
+
+void DirSizes::request (const QString &path)
+{
+  if (requested_.contains (path))
+  {
+    return;
+  }
+  requested_.insert (path);
+
+  QMutexLocker locker (&state_->mutex);
+  state_->queue.append (path);
+  if (state_->workerCount < pool_->maxThreadCount ())
+  {
+    ++state_->workerCount;
+    pool_->start (new SizeTask (state_));
+  }
+}
+
+void DirSizes::scheduleDelivery ()
+{
+  if (!deliveryTimer_->isActive ())
+  {
+    deliveryTimer_->start ();
+  }
+}
+
+void DirSizes::deliver ()
+{
+  QVector<Size> sizes;
+  {
+    QMutexLocker locker (&state_->mutex);
+    sizes.swap (state_->computed);
+  }
+
+  for (const auto &i: sizes)
+  {
+    requested_.remove (i.path);
+  }
+  if (!sizes.isEmpty ())
+  {
+    emit computed (sizes);
+  }
+}
+
+void SizeTask::run ()
+{
+  forever
+  {
+    QString path;
+    {
+      QMutexLocker locker (&state_->mutex);
+      if (state_->queue.isEmpty () || !state_->owner)
+      {
+        --state_->workerCount;
+        return;
+      }
+      path = state_->queue.takeLast ();
+    }
+
+    const auto size = DirSizes::compute (path, state_->isAborted);
+    if (size == aborted)
+    {
+      continue; // queue is cleared
+    }
+
+    QMutexLocker locker (&state_->mutex);
+    state_->computed.append ({path, size});
+    if (state_->computed.size () == 1 && state_->owner)
+    {
+      QMetaObject::invokeMethod (state_->owner, "scheduleDelivery", Qt::QueuedConnection);
+    }
+  }
+}
+
+#include "moc_dirsizes.cpp"
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QVector>
+#include <QSharedPointer>
+
+#include <atomic>
+
+class QThreadPool;
+class QTimer;
+struct DirSizesState;
+
+// Recursive sizes of directories. Results are shared by the whole process and
+// keyed by device and inode, so views and file operations reuse each other's
+// work. A change inside a directory forgets sizes of it and of its ancestors.
+class DirSizes : public QObject
+{
+Q_OBJECT
+public:
+  struct Size
+  {
+    QString path;
+    qint64 size;
+  };
+
+  explicit DirSizes (QObject *parent = nullptr);
+  ~DirSizes ();
+
+  //! -1 if not computed yet.
+  static qint64 cached (const QString &path);
+  //! Walks the tree in calling thread if not cached. -1 if aborted.
+  static qint64 compute (const QString &path, const std::atomic_bool &isAborted);
+  //! Forgets sizes of path and of its ancestors. Does not touch the file
+  //! system, paths are resolved by the next lookup in its thread.
+  static void invalidate (const QString &path);
+
+  //! Computes in background. Recently requested are computed first.
+  void request (const QString &path);
+
+signals:
+  void computed (const QVector<DirSizes::Size> &sizes);
+
+private slots:
+  void scheduleDelivery ();
+
+private:
+  void deliver ();
+
+  QSharedPointer<DirSizesState> state_;
+  QThreadPool *pool_;
+  QTimer *deliveryTimer_;
+  QSet<QString> requested_;
+};
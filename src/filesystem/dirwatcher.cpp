@@ -0,0 +1,429 @@
+#include "dirwatcher.h"
+#include "storagemanager.h"
+#include "debug.h"
+
+#include <QTimer>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace
+{
+const int flushDelayMs = 200;
+const int pollTickMs = 1000;
+const int localPollMs = 2000;
+const int fusePollMs = 3000;
+const int networkPollMs = 5000;
+
+#ifdef Q_OS_LINUX
+const quint32 watchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY |
+                          IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+//! Interval for filesystems whose remote changes are not reported, 0 for others.
+//! Type is taken from the mount table, so a hung mount is not touched.
+int pollInterval (const QString &path)
+{
+  static const QStringList networkTypes {"nfs", "nfs4", "cifs", "smb3", "smbfs", "afs", "coda",
+                                         "ceph", "9p"};
+  const auto type = StorageManager::storage (QFileInfo (path)).type;
+  if (networkTypes.contains (type))
+  {
+    return networkPollMs;
+  }
+  if (type == QLatin1String ("fuse") || type.startsWith (QLatin1String ("fuse.")))
+  {
+    return fusePollMs;
+  }
+  return 0;
+}
+#endif
+}
+
+
+DirWatcher::DirWatcher (QObject *parent) :
+  QObject (parent),
+  watches_ (),
+  descriptorPaths_ (),
+  pending_ (),
+  rescans_ (),
+  revalidations_ (),
+  flushTimer_ (new QTimer (this)),
+  pollTimer_ (new QTimer (this)),
+  inotify_ (-1),
+  notifier_ (nullptr),
+  fallback_ (nullptr)
+{
+  flushTimer_->setSingleShot (true);
+  flushTimer_->setInterval (flushDelayMs);
+  connect (flushTimer_, &QTimer::timeout,
+           this, &DirWatcher::flush);
+
+  pollTimer_->setInterval (pollTickMs);
+  connect (pollTimer_, &QTimer::timeout,
+           this, &DirWatcher::poll);
+
+#ifdef Q_OS_LINUX
+  inotify_ = ::inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_ != -1)
+  {
+    notifier_ = new QSocketNotifier (inotify_, QSocketNotifier::Read, this);
+    connect (notifier_, &QSocketNotifier::activated,
+             this, &DirWatcher::readEvents);
+  }
+  else
+  {
+    LWARNING () << "inotify is not available, directories are polled" << LARG (std::strerror (errno));
+  }
+#else
+  fallback_ = new QFileSystemWatcher (this);
+  connect (fallback_, &QFileSystemWatcher::directoryChanged,
+           this, &DirWatcher::addRescan);
+#endif
+}
+
+DirWatcher::~DirWatcher ()
+{
+#ifdef Q_OS_LINUX
+  if (inotify_ != -1)
+  {
+    ::close (inotify_);
+  }
+#endif
+}
+
+void DirWatcher::watch (const QString &path)
+{
+  if (path.isEmpty ())
+  {
+    return;
+  }
+
+  auto &watch = watches_[path];
+  if (++watch.count == 1)
+  {
+    startWatching (path, watch);
+  }
+}
+
+void DirWatcher::unwatch (const QString &path)
+{
+  auto it = watches_.find (path);
+  if (it == watches_.end () || --it.value ().count > 0)
+  {
+    return;
+  }
+
+  stopWatching (path, it.value ());
+  watches_.erase (it);
+  pending_.remove (path);
+  rescans_.removeAll (path);
+  revalidations_.removeAll (path);
+}
+
+bool DirWatcher::isWatched (const QString &path) const
+{
+  return watches_.contains (path);
+}
+
+void DirWatcher::startWatching (const QString &path, DirWatcher::Watch &watch)
+{
+  watch.descriptor = -1;
+  watch.pollIntervalMs = 0;
+  watch.isMissing = false;
+
+#ifdef Q_OS_LINUX
+  const auto interval = pollInterval (path);
+  if (interval == 0 && inotify_ != -1)
+  {
+    if (addWatch (path, watch))
+    {
+      return;
+    }
+    // deleted directory is polled until it is created again, otherwise most
+    // likely the limit of watches per user is reached
+    watch.isMissing = (errno == ENOENT);
+    LWARNING_IF (!watch.isMissing) << "Failed to watch, polling" << LARG (path)
+                                   << LARG (std::strerror (errno));
+  }
+  watch.pollIntervalMs = (interval > 0 ? interval : localPollMs);
+#else
+  if (fallback_->addPath (path))
+  {
+    return;
+  }
+  watch.pollIntervalMs = localPollMs;
+#endif
+
+  watch.nextPollMs = QDateTime::currentMSecsSinceEpoch () + watch.pollIntervalMs;
+  if (!pollTimer_->isActive ())
+  {
+    pollTimer_->start ();
+  }
+}
+
+bool DirWatcher::addWatch (const QString &path, DirWatcher::Watch &watch)
+{
+#ifdef Q_OS_LINUX
+  const auto descriptor = ::inotify_add_watch (inotify_, QFile::encodeName (path).constData (),
+                                               watchMask);
+  if (descriptor == -1)
+  {
+    return false;
+  }
+  watch.descriptor = descriptor;
+  watch.pollIntervalMs = 0;
+  watch.isMissing = false;
+  descriptorPaths_[descriptor].append (path);
+  return true;
+#else
+  Q_UNUSED (path);
+  Q_UNUSED (watch);
+  return false;
+#endif
+}
+
+void DirWatcher::stopWatching (const QString &path, const DirWatcher::Watch &watch)
+{
+  if (watch.pollIntervalMs > 0)
+  {
+    return;
+  }
+
+#ifdef Q_OS_LINUX
+  auto it = descriptorPaths_.find (watch.descriptor);
+  if (it == descriptorPaths_.end ())
+  {
+    return; // removed by kernel along with directory
+  }
+  it.value ().removeOne (path);
+  if (it.value ().isEmpty ())
+  {
+    descriptorPaths_.erase (it);
+    ::inotify_rm_watch (inotify_, watch.descriptor);
+  }
+#else
+  fallback_->removePath (path);
+#endif
+}
+
+void DirWatcher::readEvents ()
+{
+#ifdef Q_OS_LINUX
+  alignas (struct inotify_event) char buffer[16384];
+  forever
+  {
+    const auto size = ::read (inotify_, buffer, sizeof (buffer));
+    if (size <= 0)
+    {
+      return;
+    }
+
+    for (auto *i = buffer; i < buffer + size;)
+    {
+      const auto *event = reinterpret_cast<const struct inotify_event *>(i);
+      i += sizeof (struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        for (auto it = watches_.cbegin (), end = watches_.cend (); it != end; ++it)
+        {
+          addRescan (it.key ());
+        }
+        continue;
+      }
+
+      if (event->mask & IN_IGNORED)
+      {
+        rewatch (event->wd);
+        continue;
+      }
+
+      const auto paths = descriptorPaths_.value (event->wd);
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+      {
+        for (const auto &path: paths)
+        {
+          addRescan (path);
+        }
+        // watch of moved directory follows it, removal leads to rewatch
+        if ((event->mask & IN_MOVE_SELF) && !paths.isEmpty ())
+        {
+          ::inotify_rm_watch (inotify_, event->wd);
+        }
+        continue;
+      }
+
+      if (event->len == 0)
+      {
+        continue;
+      }
+
+      const auto name = QFile::decodeName (event->name);
+      const auto change = (event->mask & (IN_CREATE | IN_MOVED_TO))
+                          ? Change::Added
+                          : (event->mask & (IN_DELETE | IN_MOVED_FROM)) ? Change::Removed
+                                                                        : Change::Modified;
+      for (const auto &path: paths)
+      {
+        addChange (path, name, change);
+      }
+    }
+  }
+#endif
+}
+
+void DirWatcher::addChange (const QString &path, const QString &name, DirWatcher::Change change)
+{
+  auto &changes = pending_[path];
+  auto it = changes.find (name);
+  if (it == changes.end ())
+  {
+    changes.insert (name, change);
+  }
+  else
+  {
+    // combine with the previous change of the same entry
+    const auto previous = it.value ();
+    if (change == Change::Removed)
+    {
+      if (previous == Change::Added)
+      {
+        changes.erase (it);
+      }
+      else
+      {
+        it.value () = Change::Removed;
+      }
+    }
+    else if (previous == Change::Removed)
+    {
+      it.value () = Change::Modified;
+    }
+  }
+
+  if (!flushTimer_->isActive ())
+  {
+    flushTimer_->start ();
+  }
+}
+
+void DirWatcher::addRescan (const QString &path)
+{
+  if (!rescans_.contains (path))
+  {
+    rescans_.append (path);
+  }
+  if (!flushTimer_->isActive ())
+  {
+    flushTimer_->start ();
+  }
+}
+
+//! Kernel dropped the watch of a deleted or moved directory.
+void DirWatcher::rewatch (int descriptor)
+{
+  const auto paths = descriptorPaths_.take (descriptor);
+  for (const auto &path: paths)
+  {
+    auto it = watches_.find (path);
+    if (it != watches_.end () && it.value ().descriptor == descriptor)
+    {
+      startWatching (path, it.value ());
+      addRescan (path);
+    }
+  }
+}
+
+void DirWatcher::poll ()
+{
+  const auto now = QDateTime::currentMSecsSinceEpoch ();
+  auto hasPolled = false;
+  for (auto it = watches_.begin (), end = watches_.end (); it != end; ++it)
+  {
+    auto &watch = it.value ();
+    if (watch.pollIntervalMs == 0)
+    {
+      continue;
+    }
+    if (watch.nextPollMs <= now && watch.isMissing && addWatch (it.key (), watch))
+    {
+      addRescan (it.key ()); // created again
+      continue;
+    }
+    hasPolled = true;
+    if (watch.nextPollMs <= now)
+    {
+      watch.nextPollMs = now + watch.pollIntervalMs;
+      if (!revalidations_.contains (it.key ()))
+      {
+        revalidations_.append (it.key ());
+      }
+      if (!flushTimer_->isActive ())
+      {
+        flushTimer_->start ();
+      }
+    }
+  }
+
+  if (!hasPolled)
+  {
+    pollTimer_->stop ();
+  }
+}
+
+void DirWatcher::flush ()
+{
+  const auto rescans = rescans_;
+  rescans_.clear ();
+  for (const auto &path: rescans)
+  {
+    pending_.remove (path);
+    Changes changes;
+    changes.isRescanNeeded = true;
+    emit changed (path, changes);
+  }
+
+  const auto revalidations = revalidations_;
+  revalidations_.clear ();
+  for (const auto &path: revalidations)
+  {
+    if (!rescans.contains (path))
+    {
+      Changes changes;
+      changes.isRevalidateNeeded = true;
+      emit changed (path, changes);
+    }
+  }
+
+  const auto pending = pending_;
+  pending_.clear ();
+  for (auto it = pending.cbegin (), end = pending.cend (); it != end; ++it)
+  {
+    Changes changes;
+    const auto &names = it.value ();
+    for (auto name = names.cbegin (), namesEnd = names.cend (); name != namesEnd; ++name)
+    {
+      switch (name.value ())
+      {
+        case Change::Added: changes.added << name.key (); break;
+        case Change::Removed: changes.removed << name.key (); break;
+        case Change::Modified: changes.modified << name.key (); break;
+      }
+    }
+    if (!changes.added.isEmpty () || !changes.removed.isEmpty () || !changes.modified.isEmpty ())
+    {
+      emit changed (it.key (), changes);
+    }
+  }
+}
+
+#include "moc_dirwatcher.cpp"
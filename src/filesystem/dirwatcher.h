@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+
+class QTimer;
+class QSocketNotifier;
+class QFileSystemWatcher;
+
+// Watches directories shared by all views. Changes are collected for a short
+// while and reported as one delta per directory. Directories on filesystems
+// that do not deliver change events are polled instead. A deleted or moved
+// directory is polled by path until one is created in its place and watched.
+class DirWatcher : public QObject
+{
+Q_OBJECT
+public:
+  struct Changes
+  {
+    QStringList added;
+    QStringList removed;
+    QStringList modified;
+    bool isRescanNeeded{false}; // names are unknown, directory must be relisted
+    bool isRevalidateNeeded{false}; // polled, relisted and compared with known rows
+  };
+
+  explicit DirWatcher (QObject *parent = nullptr);
+  ~DirWatcher ();
+
+  //! Reference counted.
+  void watch (const QString &path);
+  void unwatch (const QString &path);
+  bool isWatched (const QString &path) const;
+
+signals:
+  void changed (const QString &path, const DirWatcher::Changes &changes);
+
+private:
+  enum class Change
+  {
+    Added, Removed, Modified
+  };
+
+  struct Watch
+  {
+    int count;
+    int descriptor; // -1 if polled
+    int pollIntervalMs;
+    qint64 nextPollMs;
+    bool isMissing; // polled until it can be watched again
+  };
+
+  void startWatching (const QString &path, Watch &watch);
+  //! Inotify watch, false with errno set on failure.
+  bool addWatch (const QString &path, Watch &watch);
+  void stopWatching (const QString &path, const Watch &watch);
+  void readEvents ();
+  void addChange (const QString &path, const QString &name, Change change);
+  void addRescan (const QString &path);
+  void rewatch (int descriptor);
+  void poll ();
+  void flush ();
+
+  QHash<QString, Watch> watches_;
+  QHash<int, QStringList> descriptorPaths_; // same directory may have several paths
+  QHash<QString, QHash<QString, Change> > pending_;
+  QStringList rescans_;
+  QStringList revalidations_;
+  QTimer *flushTimer_;
+  QTimer *pollTimer_;
+  int inotify_;
+  QSocketNotifier *notifier_;
+  QFileSystemWatcher *fallback_;
+};
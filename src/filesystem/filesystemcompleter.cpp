@@ -1,105 +1,300 @@
 #include "filesystemcompleter.h"
 #include "filesystemmodel.h"
-#include "proxymodel.h"
-#include "constants.h"
+#include "dirnametrie.h"
+#include "frecencystore.h"
 #include "debug.h"
 
 #include <QAbstractItemView>
-#include <QApplication>
+#include <QStringListModel>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QTimer>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QDateTime>
+
+struct CompleterProbeState
+{
+  QMutex mutex;
+  FileSystemCompleter *owner;
+};
+
+namespace
+{
+const int maxCandidates = 200;
+const int maxVisitedCandidates = 20;
+const int maxListingAgeMs = 10000;
+const int probeTimeoutMs = 2000;
+const int slowDirRetryMs = 30000;
+const int probeCheckMs = 500;
+const int chunkNames = 200;
+const int chunkMs = 100;
+
+DirNameTrie &trie ()
+{
+  static DirNameTrie instance;
+  return instance;
+}
+
+//! Listings of hung mounts never finish, so the pool is never destroyed.
+QThreadPool *probePool ()
+{
+  static auto pool = [] {
+                       auto result = new QThreadPool;
+                       result->setMaxThreadCount (4);
+                       return result;
+                     } ();
+  return pool;
+}
+
+qint64 now ()
+{
+  return QDateTime::currentMSecsSinceEpoch ();
+}
+
+class ProbeTask : public QRunnable
+{
+public:
+  ProbeTask (const QString &dir, const QSharedPointer<CompleterProbeState> &state) :
+    dir_ (dir),
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  bool post (const QStringList &names, bool isFinished);
+
+  QString dir_;
+  QSharedPointer<CompleterProbeState> state_;
+};
+}
+
 
 FileSystemCompleter::FileSystemCompleter (FileSystemModel *model, QObject *parent) :
   QCompleter (parent),
-  proxy_ (new ProxyModel (model, this))
+  model_ (model),
+  candidates_ (new QStringListModel (this)),
+  state_ (new CompleterProbeState),
+  probeTimer_ (new QTimer (this)),
+  text_ (),
+  dir_ (),
+  prefix_ (),
+  probes_ (),
+  probed_ (),
+  slowDirs_ ()
 {
-  proxy_->setShowFiles (false);
-  proxy_->setShowDotDot (false);
+  state_->owner = this;
 
-  setCompletionRole (FileSystemModel::FileNameRole);
+  setModel (candidates_);
+  setCompletionMode (QCompleter::UnfilteredPopupCompletion);
 #ifdef Q_OS_WIN
   setCaseSensitivity (Qt::CaseInsensitive);
 #endif
-  setModel (proxy_);
-
-  connect (model, &QFileSystemModel::directoryLoaded, this, [this](const QString &path) {
-             if (lastPath_ == path && completionCount () > 0)
-             {
-               QApplication::instance ()->processEvents (QEventLoop::ExcludeUserInputEvents, 100);
-               complete ();
-             }
-           });
+
+  probeTimer_->setInterval (probeCheckMs);
+  connect (probeTimer_, &QTimer::timeout,
+           this, &FileSystemCompleter::checkProbes);
+}
+
+FileSystemCompleter::~FileSystemCompleter ()
+{
+  QMutexLocker locker (&state_->mutex);
+  state_->owner = nullptr;
+}
+
+QStringList FileSystemCompleter::splitPath (const QString &path) const
+{
+  // called for every change of completion prefix, candidates follow it later
+  if (path != text_)
+  {
+    QMetaObject::invokeMethod (const_cast<FileSystemCompleter *>(this), "updateText",
+                               Qt::QueuedConnection, Q_ARG (QString, path));
+  }
+  return QStringList (path);
 }
 
-QString FileSystemCompleter::pathFromIndex (const QModelIndex &index) const
+void FileSystemCompleter::updateText (const QString &text)
 {
-  if (!index.isValid ())
+  if (text == text_)
+  {
+    return;
+  }
+  text_ = text;
+
+  const auto clean = QDir::fromNativeSeparators (text);
+  if (!clean.isEmpty () && QDir::isRelativePath (clean))
   {
-    return {};
+    // parts of a visited path
+    dir_.clear ();
+    prefix_.clear ();
+    QStringList paths;
+    for (const auto &i: FrecencyStore::instance ().find (text, maxVisitedCandidates))
+    {
+      paths << QDir::toNativeSeparators (i);
+    }
+    setCandidates (paths);
+    return;
   }
 
-  const auto source = static_cast<FileSystemModel *>(proxy_->sourceModel ());
-  ASSERT (source);
-  const auto mapped = proxy_->mapToSource (index);
-  const auto path = source->filePath (mapped);
-  return QDir::toNativeSeparators (path);
+  const auto separator = clean.lastIndexOf (QLatin1Char ('/'));
+  if (separator == -1)
+  {
+    dir_.clear ();
+    prefix_.clear ();
+    candidates_->setStringList ({});
+    return;
+  }
+
+  dir_ = clean.left (separator + 1);
+  prefix_ = clean.mid (separator + 1);
+
+  auto &names = trie ();
+  const auto listedAt = names.listedAt (dir_);
+  if (listedAt == 0)
+  {
+    names.add (dir_, model_->loadedDirNames (QDir::cleanPath (dir_)));
+  }
+  updateCandidates ();
+
+  if (now () - listedAt > maxListingAgeMs)
+  {
+    probe (dir_);
+  }
 }
 
-QStringList FileSystemCompleter::splitPath (const QString &path) const
+void FileSystemCompleter::updateCandidates ()
 {
-  auto native = QDir::toNativeSeparators (path);
-#ifdef Q_OS_WIN
-  if (native == QLatin1String ("\\"))
+  QStringList paths;
+  for (const auto &i: trie ().complete (dir_, prefix_, maxCandidates))
   {
-    return {};
+    paths << QDir::toNativeSeparators (dir_ + i);
   }
-  if (native == constants::networkDirStart)
+  setCandidates (paths);
+}
+
+void FileSystemCompleter::setCandidates (const QStringList &paths)
+{
+  if (paths == candidates_->stringList ())
   {
-    return QStringList (native);
+    return;
   }
-  const auto isNetworkDir = native.startsWith (constants::networkDirStart);
-  if (isNetworkDir)
+
+  candidates_->setStringList (paths);
+  auto *editor = widget ();
+  if (!editor || !editor->hasFocus ())
   {
-    native = native.mid (2);
+    return;
   }
-#endif
-  auto parts = native.split (QDir::separator ());
-#ifdef Q_OS_WIN
-  if (isNetworkDir)
+  if (!paths.isEmpty ())
   {
-    parts[0].prepend (constants::networkDirStart);
+    complete ();
   }
-#else
-  if (native[0] == QDir::separator ()) // readd the "/" at the beginning as the split removed it
+  else if (popup ()->isVisible ())
   {
-    parts[0] = QLatin1Char ('/');
+    popup ()->hide ();
   }
-#endif
+}
 
-#ifdef Q_OS_WIN
-  if (isNetworkDir)
+void FileSystemCompleter::probe (const QString &dir)
+{
+  if (probes_.contains (dir))
   {
-    return parts;
+    return;
+  }
+  const auto slowAt = slowDirs_.value (dir, 0);
+  if (slowAt > 0 && now () - slowAt < slowDirRetryMs)
+  {
+    return;
   }
-#endif
 
-  if (!QFileInfo::exists (path))
+  probes_.insert (dir, now ());
+  probed_.remove (dir);
+  probePool ()->start (new ProbeTask (dir, state_));
+  if (!probeTimer_->isActive ())
   {
-    return parts;
+    probeTimer_->start ();
   }
+}
 
-  const auto source = static_cast<FileSystemModel *>(proxy_->sourceModel ());
-  ASSERT (source);
-  auto index = source->index (path);
-  if (index.isValid () && !native.endsWith (QDir::separator ()))
+void FileSystemCompleter::checkProbes ()
+{
+  const auto current = now ();
+  for (auto it = probes_.begin (); it != probes_.end ();)
+  {
+    if (current - it.value () < probeTimeoutMs)
+    {
+      ++it;
+      continue;
+    }
+    LDEBUG () << "Directory listing for completion timed out" << LARG (it.key ());
+    slowDirs_.insert (it.key (), current); // late names are still accepted
+    it = probes_.erase (it);
+  }
+  if (probes_.isEmpty ())
   {
-    index = index.parent ();
+    probeTimer_->stop ();
   }
-  if (index.isValid ())
+}
+
+void FileSystemCompleter::addNames (const QString &dir, const QStringList &names,
+                                    bool isFinished)
+{
+  auto &received = probed_[dir];
+  received += names;
+  trie ().add (dir, names);
+
+  if (isFinished)
   {
-    lastPath_ = source->filePath (index);
-    proxy_->setRootIndex (proxy_->mapFromSource (index));
+    trie ().reset (dir, received);
+    probed_.remove (dir);
+    probes_.remove (dir);
+    slowDirs_.remove (dir);
   }
 
-  return parts;
+  if (dir == dir_)
+  {
+    updateCandidates ();
+  }
+}
+
+void ProbeTask::run ()
+{
+  QDirIterator it (dir_, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+  QStringList names;
+  QElapsedTimer sincePost;
+  sincePost.start ();
+  while (it.hasNext ())
+  {
+    it.next ();
+    names << it.fileName ();
+    if (names.size () >= chunkNames || sincePost.elapsed () >= chunkMs)
+    {
+      if (!post (names, false))
+      {
+        return;
+      }
+      names.clear ();
+      sincePost.restart ();
+    }
+  }
+  post (names, true);
+}
+
+bool ProbeTask::post (const QStringList &names, bool isFinished)
+{
+  QMutexLocker locker (&state_->mutex);
+  if (!state_->owner)
+  {
+    return false;
+  }
+  QMetaObject::invokeMethod (state_->owner, "addNames", Qt::QueuedConnection,
+                             Q_ARG (QString, dir_), Q_ARG (QStringList, names),
+                             Q_ARG (bool, isFinished));
+  return true;
 }
 
 #include "moc_filesystemcompleter.cpp"
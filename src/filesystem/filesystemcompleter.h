@@ -1,21 +1,45 @@
 #pragma once
 
 #include <QCompleter>
+#include <QHash>
+#include <QSharedPointer>
 
 class FileSystemModel;
-class ProxyModel;
+class QStringListModel;
+class QTimer;
+struct CompleterProbeState;
 
+// Completes directory paths from names collected in background. Directories
+// are listed off the GUI thread, names are shown as they arrive, and a
+// directory that does not answer in time is not waited for. Text that is not
+// a path is completed with matching visited directories.
 class FileSystemCompleter : public QCompleter
 {
 Q_OBJECT
 public:
   FileSystemCompleter (FileSystemModel *model, QObject *parent = nullptr);
+  ~FileSystemCompleter ();
 
-public:
-  QString pathFromIndex (const QModelIndex &index) const override;
   QStringList splitPath (const QString &path) const override;
 
+private slots:
+  void updateText (const QString &text);
+  void addNames (const QString &dir, const QStringList &names, bool isFinished);
+
 private:
-  ProxyModel *proxy_;
-  mutable QString lastPath_;
+  void updateCandidates ();
+  void setCandidates (const QStringList &paths);
+  void probe (const QString &dir);
+  void checkProbes ();
+
+  FileSystemModel *model_;
+  QStringListModel *candidates_;
+  QSharedPointer<CompleterProbeState> state_;
+  QTimer *probeTimer_;
+  QString text_;
+  QString dir_; // of text_, with trailing separator
+  QString prefix_; // name part of text_
+  QHash<QString, qint64> probes_; // running, dir -> started at
+  QHash<QString, QStringList> probed_; // dir -> names received so far
+  QHash<QString, qint64> slowDirs_; // dir -> timed out at
 };
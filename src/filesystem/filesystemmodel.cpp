@@ -1,31 +1,232 @@
 #include "filesystemmodel.h"
+#include "direntries.h"
+#include "dirlister.h"
 #include "constants.h"
 #include "debug.h"
+#include "utils.h"
+#include "backport.h"
 #include "fileoperationmodel.h"
+#include "settingsmanager.h"
 
 #include <QMimeData>
 #include <QUrl>
+#include <QDir>
+#include <QDateTime>
+#include <QSet>
+#include <QFileIconProvider>
+
+#include <algorithm>
+
+namespace
+{
+const int maxCachedEntries = 100000;
+const int maxIncrementalChanges = 64; // larger changes are relisted in background
+
+QString childPath (const QString &path, const QString &name)
+{
+  if (path.isEmpty ())
+  {
+    return name;
+  }
+  return path.endsWith (QLatin1Char ('/')) ? path + name : path + QLatin1Char ('/') + name;
+}
+
+QStringList splitPath (const QString &path)
+{
+  auto clean = QDir::cleanPath (QDir::fromNativeSeparators (path));
+  if (QDir::isRelativePath (clean))
+  {
+    clean = QDir::cleanPath (QDir::current ().absoluteFilePath (clean));
+  }
+
+  QStringList parts;
+  if (clean.startsWith (QLatin1String ("//"))) // network share
+  {
+    const auto end = clean.indexOf (QLatin1Char ('/'), 2);
+    parts << clean.left (end);
+    clean = (end != -1 ? clean.mid (end + 1) : QString ());
+  }
+  else if (clean.startsWith (QLatin1Char ('/')))
+  {
+    parts << QString (QLatin1Char ('/'));
+    clean = clean.mid (1);
+  }
+  else if (clean.size () >= 2 && clean.at (1) == QLatin1Char (':')) // drive letter
+  {
+    parts << clean.left (2) + QLatin1Char ('/');
+    clean = clean.mid (3);
+  }
+  parts += clean.split (QLatin1Char ('/'), QString::SkipEmptyParts);
+  return parts;
+}
+}
+
+
+struct FileSystemModel::Node
+{
+  Node (const QString &path, Node *parent, int row);
+  ~Node ();
+
+  void setPath (const QString &newPath);
+
+  QString path;
+  Node *parent;
+  int row;
+  DirEntries entries;
+  QHash<QString, Node *> children;
+  quint64 device;
+  qint64 stamp; // of the last full listing
+  int streamedRows; // appended from listing parts, -1 if not streaming
+  bool isLoaded;
+  bool isLoading;
+  bool isPrefetched;
+  bool isPolled; // revalidated by poll, found changes are reported
+};
+
+FileSystemModel::Node::Node (const QString &path, Node *parent, int row) :
+  path (path),
+  parent (parent),
+  row (row),
+  entries (),
+  children (),
+  device (parent ? parent->entries.devices[row] : 0),
+  stamp (0),
+  streamedRows (-1),
+  isLoaded (false),
+  isLoading (false),
+  isPrefetched (false),
+  isPolled (false)
+{
+}
+
+FileSystemModel::Node::~Node ()
+{
+  qDeleteAll (children);
+}
+
+void FileSystemModel::Node::setPath (const QString &newPath)
+{
+  path = newPath;
+  for (auto i = children.begin (), end = children.end (); i != end; ++i)
+  {
+    i.value ()->setPath (childPath (path, i.key ()));
+  }
+}
+
 
 FileSystemModel::FileSystemModel (FileOperationModel *operations, QObject *parent) :
-  QFileSystemModel (parent),
-  operations_ (operations)
+  QAbstractItemModel (parent),
+  operations_ (operations),
+  lister_ (new DirLister (this)),
+  watcher_ (new DirWatcher (this)),
+  dirSizes_ (new DirSizes (this)),
+  types_ (new FileTypes (this)),
+  showDirSizes_ (false),
+  knownDirSizes_ (),
+  root_ (new Node ({}, nullptr, -1)),
+  loaded_ (),
+  driveIcon_ (),
+  isReadOnly_ (true)
 {
+  connect (lister_, &DirLister::listedPart,
+           this, &FileSystemModel::applyListingPart);
+  connect (lister_, &DirLister::listed,
+           this, &FileSystemModel::applyListing);
+  connect (lister_, &DirLister::pathRead,
+           this, &FileSystemModel::applyPath);
+
+  connect (watcher_, &DirWatcher::changed,
+           this, &FileSystemModel::applyChanges);
+
+  connect (dirSizes_, &DirSizes::computed,
+           this, &FileSystemModel::updateDirSizes);
 
+  connect (types_, &FileTypes::sniffed,
+           this, &FileSystemModel::updateSniffedTypes);
+
+  QFileIconProvider icons;
+  driveIcon_ = icons.icon (QFileIconProvider::Drive);
+
+  for (const auto &i: QDir::drives ())
+  {
+    const auto path = i.absoluteFilePath ();
+    DirEntries::readEntry (path, path, root_->entries);
+  }
+  root_->isLoaded = true;
+
+  SettingsManager::subscribeForUpdates (this);
+  updateSettings ();
 }
 
+FileSystemModel::~FileSystemModel ()
+{
+}
 
-bool FileSystemModel::dropMimeData (const QMimeData *data, Qt::DropAction action, int row,
-                                    int column, const QModelIndex &parent)
+QModelIndex FileSystemModel::index (int row, int column, const QModelIndex &parent) const
 {
-  Q_UNUSED (row);
-  Q_UNUSED (column);
-  if (!parent.isValid () || isReadOnly ())
+  if (row < 0 || column < 0 || column >= Column::ColumnCount)
   {
-    return false;
+    return {};
+  }
+  auto *parentNode = node (parent);
+  if (!parentNode || row >= parentNode->entries.count ())
+  {
+    return {};
   }
+  return createIndex (row, column, parentNode);
+}
 
-  operations_->paste (data->urls (), fileInfo (parent), action);
-  return true;
+QModelIndex FileSystemModel::index (const QString &path, int column) const
+{
+  const auto parts = splitPath (path);
+  auto *current = root_.get ();
+  for (auto i = 0, end = parts.size (); i < end; ++i)
+  {
+    const auto row = current->entries.find (parts[i]);
+    if (row == -1) // not listed yet
+    {
+      return {};
+    }
+
+    if (i == end - 1)
+    {
+      return createIndex (row, column, current);
+    }
+
+    current = childNode (current, row);
+    if (!current)
+    {
+      return {};
+    }
+  }
+  return {};
+}
+
+QModelIndex FileSystemModel::index (const QModelIndex &dir, const QString &name,
+                                    int column) const
+{
+  auto *dirNode = node (dir);
+  const auto row = dirNode ? dirNode->entries.find (name) : -1;
+  return row != -1 ? createIndex (row, column, dirNode) : QModelIndex ();
+}
+
+QModelIndex FileSystemModel::parent (const QModelIndex &child) const
+{
+  if (!child.isValid ())
+  {
+    return {};
+  }
+  return nodeIndex (static_cast<Node *>(child.internalPointer ()));
+}
+
+int FileSystemModel::rowCount (const QModelIndex &parent) const
+{
+  if (parent.column () > 0)
+  {
+    return 0;
+  }
+  const auto *parentNode = node (parent);
+  return parentNode ? parentNode->entries.count () : 0;
 }
 
 int FileSystemModel::columnCount (const QModelIndex & /*parent*/) const
@@ -33,110 +234,163 @@ int FileSystemModel::columnCount (const QModelIndex & /*parent*/) const
   return Column::ColumnCount;
 }
 
+bool FileSystemModel::hasChildren (const QModelIndex &parent) const
+{
+  return !parent.isValid () || (parent.column () == 0 && isDir (parent) && !isDotDot (parent));
+}
+
+bool FileSystemModel::canFetchMore (const QModelIndex &parent) const
+{
+  const auto *parentNode = node (parent);
+  return parentNode && !parentNode->isLoaded && !parentNode->isLoading;
+}
+
+void FileSystemModel::fetchMore (const QModelIndex &parent)
+{
+  if (auto *parentNode = node (parent))
+  {
+    load (parentNode);
+  }
+}
+
 QVariant FileSystemModel::headerData (int section, Qt::Orientation orientation, int role) const
 {
-  if (orientation == Qt::Horizontal && section >= Column::Permissions)
+  if (orientation != Qt::Horizontal)
+  {
+    return QAbstractItemModel::headerData (section, orientation, role);
+  }
+
+  if (role == Qt::TextAlignmentRole)
+  {
+    return int (Qt::AlignLeft);
+  }
+
+  if (role == Qt::DisplayRole)
   {
-    if (role == Qt::DisplayRole)
+    switch (section)
     {
-      switch (section)
-      {
-        case Column::Owner: return tr ("Owner");
-        case Column::Group: return tr ("Group");
-        case Column::Permissions: return tr ("Permissions");
-        case Column::LinkTarget: return tr ("Link target");
-      }
+      case Column::Name: return tr ("Name");
+      case Column::Size: return tr ("Size");
+      case Column::Type: return tr ("Type");
+      case Column::Date: return tr ("Date Modified");
+      case Column::Owner: return tr ("Owner");
+      case Column::Group: return tr ("Group");
+      case Column::Permissions: return tr ("Permissions");
+      case Column::LinkTarget: return tr ("Link target");
     }
-    return {};
   }
-  return QFileSystemModel::headerData (section, orientation, role);
+  return {};
 }
 
 QVariant FileSystemModel::data (const QModelIndex &index, int role) const
 {
-  if (!index.isValid ())
+  if (!isValidEntry (index))
   {
     return {};
   }
 
-  if (index.column () >= Column::Permissions)
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  const auto &entries = dir->entries;
+  const auto row = index.row ();
+
+  switch (role)
+  {
+    case Role::FilePathRole: return filePath (index);
+    case Role::FileNameRole: return entries.names[row];
+    case Role::FilePermissions: return int (entries.permissions[row]);
+  }
+
+  const auto column = index.column ();
+  if (role == Qt::DisplayRole || role == Qt::EditRole)
   {
-    if (role == Qt::DisplayRole || role == Qt::EditRole)
+    const auto isSymLink = entries.has (row, DirEntries::IsSymLink);
+    switch (column)
     {
-      const auto info = fileInfo (index);
-      switch (index.column ())
-      {
-        case Column::Owner: return info.owner ();
-        case Column::Group: return info.group ();
-        case Column::Permissions: return int (info.permissions ());
-        case Column::LinkTarget: return info.isSymLink () ? info.symLinkTarget () : QString ();
-      }
+      case Column::Name:
+        if (role == Qt::DisplayRole && isSymLink)
+        {
+          return entries.names[row] + ' ' + QChar (8594);
+        }
+        return entries.names[row];
+
+      case Column::Size:
+        if (entries.has (row, DirEntries::IsDir))
+        {
+          const auto size = dirSize (index);
+          return size >= 0 ? utils::sizeString (size, 1) : QVariant ();
+        }
+        return utils::sizeString (entries.sizes[row], 1);
+
+      case Column::Type:
+        if (dir == root_.get ())
+        {
+          return tr ("Drive");
+        }
+        return fileType (dir, row, true).name;
+
+      case Column::Date:
+        return QDateTime::fromMSecsSinceEpoch (entries.modified[row])
+               .toString (Qt::SystemLocaleShortDate);
+
+      case Column::Permissions: return int (entries.permissions[row]);
+      case Column::Owner: return entries.owner (row);
+      case Column::Group: return entries.group (row);
+      case Column::LinkTarget: return entries.linkTargets[row];
     }
     return {};
   }
 
-  if (index.column () == Column::Type)
+  if (column != Column::Name)
   {
-    if (role == Qt::DisplayRole)
-    {
-      const auto original = QFileSystemModel::data (index, role);
-      const auto info = fileInfo (index);
-      if (info.isSymLink ())
-      {
-        return original.toString () + tr (", link");
-      }
-      return original;
-    }
+    return {};
   }
 
-  if (index.column () == Column::Name)
+  if (role == Qt::DecorationRole)
   {
-    if (role == Qt::DisplayRole)
+    if (dir == root_.get ())
     {
-      const auto info = fileInfo (index);
-      if (info.isSymLink ())
-      {
-        return info.fileName () + ' ' + QChar (8594);
-      }
-      return info.fileName ();
+      return driveIcon_;
     }
+    return fileType (dir, row, true).icon;
+  }
 
-    if (role == Qt::ToolTipRole)
-    {
-      const auto info = fileInfo (index);
-      if (info.isSymLink ())
-      {
-        return info.symLinkTarget ();
-      }
-      return {};
-    }
+  if (role == Qt::ToolTipRole && entries.has (row, DirEntries::IsSymLink))
+  {
+    return entries.linkTargets[row];
   }
 
-  return QFileSystemModel::data (index, role);
+  return {};
 }
 
 bool FileSystemModel::setData (const QModelIndex &index, const QVariant &value, int role)
 {
-  if (role != Qt::EditRole)
+  if (role != Qt::EditRole || isReadOnly_ || !isValidEntry (index))
   {
     return false;
   }
 
+  auto *dir = static_cast<Node *>(index.internalPointer ());
   const auto column = index.column ();
   if (column == Column::Name)
   {
     const auto name = value.toString ();
-    auto dir = fileInfo (index).absoluteDir ();
-    if (name.isEmpty () || !dir.exists ())
+    QDir qdir (dir->path);
+    if (name.isEmpty () || !qdir.exists ())
     {
       return false;
     }
 
-    const auto old = index.data ().toString ();
-    auto ok = dir.rename (old, name);
+    const auto old = dir->entries.names[index.row ()];
+    if (old == name)
+    {
+      return true;
+    }
+
+    auto ok = qdir.rename (old, name);
     if (ok)
     {
-      emit fileRenamed (dir.absolutePath (), old, name);
+      renameEntry (dir, index.row (), name);
+      emit fileRenamed (qdir.absolutePath (), old, name);
     }
     return ok;
   }
@@ -144,10 +398,15 @@ bool FileSystemModel::setData (const QModelIndex &index, const QVariant &value,
   if (column == Column::Permissions)
   {
     auto permissions = QFile::Permissions (value.toInt ());
-    QFile file (fileInfo (index).absoluteFilePath ());
+    QFile file (filePath (index));
     auto ok = file.setPermissions (permissions);
     LWARNING_IF (!ok) << "Failed to set permissions for" << LARG (file.fileName ())
                       << "to" << LARG (permissions);
+    if (ok)
+    {
+      dir->entries.permissions[index.row ()] = quint16 (file.permissions ());
+      emit dataChanged (index, index);
+    }
     return ok;
   }
 
@@ -156,15 +415,1006 @@ bool FileSystemModel::setData (const QModelIndex &index, const QVariant &value,
 
 Qt::ItemFlags FileSystemModel::flags (const QModelIndex &index) const
 {
-  const auto nameIndex = index.sibling (index.row (), Column::Name);
-  Qt::ItemFlags result = QFileSystemModel::flags (nameIndex);
-  const auto isDotDot = (nameIndex.data ().toString () == constants::dotdot);
-  if (!(index.column () == Column::Name || index.column () == Column::Permissions) ||
-      isDotDot)
+  if (!isValidEntry (index))
+  {
+    return {};
+  }
+
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  const auto &entries = dir->entries;
+  const auto row = index.row ();
+
+  Qt::ItemFlags result = Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled;
+  result |= entries.has (row, DirEntries::IsDir) ? Qt::ItemIsDropEnabled
+                                                 : Qt::ItemNeverHasChildren;
+
+  const auto column = index.column ();
+  if (!isReadOnly_ && dir != root_.get () && !entries.has (row, DirEntries::IsDotDot) &&
+      (column == Column::Name || column == Column::Permissions))
   {
-    result &= ~Qt::ItemIsEditable;
+    result |= Qt::ItemIsEditable;
   }
   return result;
 }
 
+QStringList FileSystemModel::mimeTypes () const
+{
+  return {QLatin1String ("text/uri-list")};
+}
+
+QMimeData * FileSystemModel::mimeData (const QModelIndexList &indexes) const
+{
+  QList<QUrl> urls;
+  for (const auto &i: indexes)
+  {
+    if (i.column () == Column::Name && !isDotDot (i))
+    {
+      urls << QUrl::fromLocalFile (filePath (i));
+    }
+  }
+  auto *data = new QMimeData;
+  data->setUrls (urls);
+  return data;
+}
+
+bool FileSystemModel::dropMimeData (const QMimeData *data, Qt::DropAction action, int row,
+                                    int column, const QModelIndex &parent)
+{
+  Q_UNUSED (row);
+  Q_UNUSED (column);
+  if (!parent.isValid () || isReadOnly ())
+  {
+    return false;
+  }
+
+  operations_->paste (data->urls (), fileInfo (parent), action);
+  return true;
+}
+
+Qt::DropActions FileSystemModel::supportedDropActions () const
+{
+  return Qt::CopyAction | Qt::MoveAction | Qt::LinkAction;
+}
+
+QString FileSystemModel::filePath (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return {};
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return childPath (dir->path, dir->entries.names[index.row ()]);
+}
+
+QString FileSystemModel::fileName (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return {};
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return dir->entries.names[index.row ()];
+}
+
+QFileInfo FileSystemModel::fileInfo (const QModelIndex &index) const
+{
+  return QFileInfo (filePath (index));
+}
+
+bool FileSystemModel::isDir (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return false;
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return dir->entries.has (index.row (), DirEntries::IsDir);
+}
+
+bool FileSystemModel::isDotDot (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return false;
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return dir->entries.has (index.row (), DirEntries::IsDotDot);
+}
+
+bool FileSystemModel::isHidden (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return false;
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return dir->entries.has (index.row (), DirEntries::IsHidden);
+}
+
+bool FileSystemModel::isSymLink (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return false;
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return dir->entries.has (index.row (), DirEntries::IsSymLink);
+}
+
+qint64 FileSystemModel::size (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return 0;
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  if (showDirSizes_ && dir->entries.has (index.row (), DirEntries::IsDir))
+  {
+    return std::max (dirSize (index), qint64 (0));
+  }
+  return dir->entries.sizes[index.row ()];
+}
+
+QString FileSystemModel::type (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return {};
+  }
+
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  const auto row = index.row ();
+  if (dir == root_.get ())
+  {
+    return tr ("Drive");
+  }
+  return fileType (dir, row, false).name;
+}
+
+//! Sorting asks for types of all rows, only shown ones are recognized by content.
+FileTypes::Type FileSystemModel::fileType (const Node *dir, int row, bool isSniffAllowed) const
+{
+  const auto &entries = dir->entries;
+  auto flags = 0;
+  if (entries.has (row, DirEntries::IsDir))
+  {
+    flags |= FileTypes::IsDir;
+  }
+  else if (entries.permissions[row] & QFile::ExeUser)
+  {
+    flags |= FileTypes::IsExecutable;
+  }
+  if (entries.has (row, DirEntries::IsSymLink))
+  {
+    flags |= FileTypes::IsSymLink;
+  }
+  return types_->type (dir->path, entries.names[row], flags, isSniffAllowed);
+}
+
+void FileSystemModel::updateSniffedTypes (const QString &path, const QStringList &names)
+{
+  auto *dir = findNode (path);
+  if (!dir)
+  {
+    return;
+  }
+  // one pass over rows, a batch may hold names of all shown files
+  auto wanted = names.toSet ();
+  const auto &entries = dir->entries;
+  for (auto row = 0, end = entries.count (); row < end && !wanted.isEmpty (); ++row)
+  {
+    if (wanted.remove (entries.names[row]))
+    {
+      emit dataChanged (createIndex (row, Column::Name, dir),
+                        createIndex (row, Column::Type, dir),
+                        {Qt::DisplayRole, Qt::DecorationRole});
+    }
+  }
+}
+
+QDateTime FileSystemModel::lastModified (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return {};
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return QDateTime::fromMSecsSinceEpoch (dir->entries.modified[index.row ()]);
+}
+
+qint64 FileSystemModel::lastModifiedMsecs (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return 0;
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return dir->entries.modified[index.row ()];
+}
+
+QFile::Permissions FileSystemModel::permissions (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return {};
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return QFile::Permissions (dir->entries.permissions[index.row ()]);
+}
+
+int FileSystemModel::colorClass (const QModelIndex &index) const
+{
+  if (!isValidEntry (index))
+  {
+    return DirEntries::Plain;
+  }
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  return dir->entries.colorClasses[index.row ()];
+}
+
+QModelIndex FileSystemModel::mkdir (const QModelIndex &parent, const QString &name)
+{
+  auto *dir = node (parent);
+  if (isReadOnly_ || !dir || dir == root_.get () || !QDir (dir->path).mkdir (name))
+  {
+    return {};
+  }
+
+  auto row = dir->entries.find (name);
+  if (row == -1)
+  {
+    row = addEntry (dir, name);
+  }
+  return row != -1 ? createIndex (row, 0, dir) : QModelIndex ();
+}
+
+bool FileSystemModel::isReadOnly () const
+{
+  return isReadOnly_;
+}
+
+void FileSystemModel::setReadOnly (bool isReadOnly)
+{
+  isReadOnly_ = isReadOnly;
+}
+
+void FileSystemModel::watch (const QString &path)
+{
+  if (path.isEmpty ())
+  {
+    return;
+  }
+
+  const auto wasWatched = watcher_->isWatched (path);
+  watcher_->watch (path);
+
+  const auto pathIndex = index (path);
+  if (auto *dir = pathIndex.isValid () ? node (pathIndex) : nullptr)
+  {
+    dir->isPrefetched = false;
+    touch (dir);
+    if (!dir->isLoaded)
+    {
+      load (dir);
+    }
+    else if (!wasWatched && !dir->isLoading)
+    {
+      // changes were not tracked since it was unwatched, cached rows are
+      // shown now and replaced with the delta if directory has changed
+      dir->isLoading = true;
+      lister_->revalidate (dir->path, dir->device, dir->stamp);
+    }
+  }
+}
+
+void FileSystemModel::prefetch (const QString &path)
+{
+  if (path.isEmpty ())
+  {
+    return;
+  }
+
+  const auto pathIndex = index (path);
+  auto *dir = pathIndex.isValid () ? node (pathIndex) : nullptr;
+  if (!dir || dir->isLoaded || dir->isLoading)
+  {
+    return;
+  }
+  dir->isLoading = true;
+  dir->isPrefetched = true;
+  lister_->prefetch (dir->path, dir->device);
+}
+
+bool FileSystemModel::isStreaming (const QModelIndex &dir) const
+{
+  const auto *n = node (dir);
+  return n && n->streamedRows >= 0;
+}
+
+QStringList FileSystemModel::loadedDirNames (const QString &path) const
+{
+  const auto *dir = findNode (path);
+  if (!dir || !dir->isLoaded)
+  {
+    return {};
+  }
+
+  QStringList result;
+  const auto &entries = dir->entries;
+  for (auto i = 0, end = entries.count (); i < end; ++i)
+  {
+    if (entries.has (i, DirEntries::IsDir) && !entries.has (i, DirEntries::IsDotDot))
+    {
+      result << entries.names[i];
+    }
+  }
+  return result;
+}
+
+void FileSystemModel::fetchPath (const QString &path)
+{
+  const auto parts = splitPath (path);
+  auto *current = root_.get ();
+  for (auto i = 0, end = parts.size (); current && i < end; ++i)
+  {
+    const auto row = current->entries.find (parts[i]);
+    if (row == -1)
+    {
+      lister_->readPath (current->path, parts.mid (i), current->device);
+      return;
+    }
+    current = (i < end - 1 ? childNode (current, row) : nullptr);
+  }
+
+  QString cleanPath;
+  for (const auto &i: parts)
+  {
+    cleanPath = childPath (cleanPath, i);
+  }
+  emit pathFetched (cleanPath);
+}
+
+void FileSystemModel::unwatch (const QString &path)
+{
+  watcher_->unwatch (path);
+  if (watcher_->isWatched (path))
+  {
+    return;
+  }
+
+  if (auto *dir = findNode (path))
+  {
+    touch (dir);
+  }
+  evict ();
+}
+
+FileSystemModel::Node * FileSystemModel::node (const QModelIndex &index) const
+{
+  if (!index.isValid ())
+  {
+    return root_.get ();
+  }
+  if (index.model () != this)
+  {
+    return nullptr;
+  }
+  return childNode (static_cast<Node *>(index.internalPointer ()), index.row ());
+}
+
+FileSystemModel::Node * FileSystemModel::childNode (Node *parent, int row) const
+{
+  const auto &entries = parent->entries;
+  if (row < 0 || row >= entries.count () || !entries.has (row, DirEntries::IsDir) ||
+      entries.has (row, DirEntries::IsDotDot))
+  {
+    return nullptr;
+  }
+
+  const auto &name = entries.names[row];
+  auto &child = parent->children[name];
+  if (!child)
+  {
+    child = new Node (childPath (parent->path, name), parent, row);
+  }
+  return child;
+}
+
+FileSystemModel::Node * FileSystemModel::findNode (const QString &path) const
+{
+  auto *current = root_.get ();
+  for (const auto &part: splitPath (path))
+  {
+    current = current->children.value (part);
+    if (!current)
+    {
+      return nullptr;
+    }
+  }
+  return current != root_.get () ? current : nullptr;
+}
+
+QModelIndex FileSystemModel::nodeIndex (Node *node, int column) const
+{
+  if (!node || node == root_.get ())
+  {
+    return {};
+  }
+  return createIndex (node->row, column, node->parent);
+}
+
+bool FileSystemModel::isValidEntry (const QModelIndex &index) const
+{
+  return index.isValid () && index.model () == this &&
+         index.row () < static_cast<Node *>(index.internalPointer ())->entries.count ();
+}
+
+void FileSystemModel::load (Node *node)
+{
+  if (node == root_.get ())
+  {
+    return;
+  }
+  node->isLoading = true;
+  node->isPrefetched = false;
+  lister_->list (node->path, node->device);
+}
+
+void FileSystemModel::applyListingPart (const QString &path, const DirEntries &entries)
+{
+  auto *dir = findNode (path);
+  if (!dir || dir->isLoaded || !dir->isLoading) // relisting is merged at once
+  {
+    return;
+  }
+
+  if (dir->streamedRows == -1 && dir->entries.count () == 0)
+  {
+    dir->streamedRows = 0;
+  }
+  if (dir->streamedRows != dir->entries.count ()) // rows were added meanwhile
+  {
+    dir->streamedRows = -1;
+    return;
+  }
+
+  dir->device = entries.device;
+  appendEntries (dir, entries, 0);
+  dir->streamedRows = dir->entries.count ();
+}
+
+void FileSystemModel::applyListing (const QString &path, const DirEntries &entries)
+{
+  auto *dir = findNode (path);
+  if (!dir) // evicted or removed meanwhile
+  {
+    return;
+  }
+
+  const auto streamedRows = dir->streamedRows;
+  const auto isPolled = dir->isPolled;
+  dir->streamedRows = -1;
+  dir->isLoading = false;
+  dir->isPolled = false;
+  if (!entries.isValid) // directory does not exist anymore
+  {
+    removeEntries (dir->parent, dir->row, dir->row);
+    return;
+  }
+
+  if (entries.isUnchanged)
+  {
+    if (dir->isLoaded)
+    {
+      emit directoryLoaded (path);
+    }
+    else // evicted meanwhile
+    {
+      load (dir);
+    }
+    return;
+  }
+
+  dir->device = entries.device;
+  dir->stamp = entries.stamp;
+  if (streamedRows >= 0 && streamedRows == dir->entries.count ())
+  {
+    appendEntries (dir, entries, streamedRows); // parts are the head of listing
+  }
+  else if (merge (dir, entries) && isPolled)
+  {
+    emit directoryChanged (path);
+    invalidateDirSizes (dir);
+  }
+  if (!dir->isLoaded)
+  {
+    dir->isLoaded = true;
+    if (dir->isPrefetched)
+    {
+      loaded_.prepend (dir);
+    }
+    else
+    {
+      loaded_.append (dir);
+    }
+  }
+
+  if (watcher_->isWatched (path))
+  {
+    requestDirSizes (dir);
+  }
+
+  emit directoryLoaded (path);
+  evict ();
+}
+
+bool FileSystemModel::merge (Node *node, const DirEntries &fresh)
+{
+  auto &entries = node->entries;
+  if (entries.count () == 0)
+  {
+    if (fresh.count () == 0)
+    {
+      return false;
+    }
+    beginInsertRows (nodeIndex (node), 0, fresh.count () - 1);
+    entries = fresh;
+    endInsertRows ();
+    return true;
+  }
+
+  QHash<QString, int> freshRows;
+  freshRows.reserve (fresh.count ());
+  for (auto i = 0, end = fresh.count (); i < end; ++i)
+  {
+    freshRows.insert (fresh.names[i], i);
+  }
+
+  // removed, by continuous ranges from the end
+  const auto oldCount = entries.count ();
+  for (auto row = entries.count () - 1; row >= 0;)
+  {
+    if (freshRows.contains (entries.names[row]))
+    {
+      --row;
+      continue;
+    }
+    const auto last = row;
+    while (row >= 0 && !freshRows.contains (entries.names[row]))
+    {
+      --row;
+    }
+    removeEntries (node, row + 1, last);
+  }
+
+  // changed
+  auto firstChanged = -1;
+  auto lastChanged = -1;
+  for (auto row = 0, end = entries.count (); row < end; ++row)
+  {
+    const auto freshRow = freshRows.take (entries.names[row]);
+    if (!entries.equals (row, fresh, freshRow))
+    {
+      entries.assign (row, fresh, freshRow);
+      firstChanged = (firstChanged == -1 ? row : firstChanged);
+      lastChanged = row;
+    }
+  }
+  if (firstChanged != -1)
+  {
+    emit dataChanged (createIndex (firstChanged, 0, node),
+                      createIndex (lastChanged, Column::ColumnCount - 1, node));
+  }
+
+  // added, the rest
+  if (!freshRows.isEmpty ())
+  {
+    auto added = freshRows.values ();
+    std::sort (added.begin (), added.end ());
+    const auto first = entries.count ();
+    beginInsertRows (nodeIndex (node), first, first + added.size () - 1);
+    for (const auto i: added)
+    {
+      entries.append (fresh, i);
+    }
+    endInsertRows ();
+  }
+  return firstChanged != -1 || entries.count () != oldCount || !freshRows.isEmpty ();
+}
+
+void FileSystemModel::appendEntries (Node *node, const DirEntries &source, int first)
+{
+  const auto count = source.count () - first;
+  if (count <= 0)
+  {
+    return;
+  }
+  auto &entries = node->entries;
+  const auto row = entries.count ();
+  beginInsertRows (nodeIndex (node), row, row + count - 1);
+  if (row == 0 && first == 0)
+  {
+    entries = source;
+  }
+  else
+  {
+    for (auto i = first, end = source.count (); i < end; ++i)
+    {
+      entries.append (source, i);
+    }
+  }
+  endInsertRows ();
+}
+
+int FileSystemModel::addEntry (Node *node, const QString &name)
+{
+  DirEntries entry;
+  if (!DirEntries::readEntry (childPath (node->path, name), name, entry))
+  {
+    return -1;
+  }
+  return insertEntry (node, entry, 0);
+}
+
+int FileSystemModel::insertEntry (Node *node, const DirEntries &source, int sourceRow)
+{
+  const auto row = node->entries.count ();
+  beginInsertRows (nodeIndex (node), row, row);
+  node->entries.append (source, sourceRow);
+  endInsertRows ();
+  return row;
+}
+
+void FileSystemModel::applyPath (const QString &dir, const QStringList &names,
+                                 const DirEntries &entries)
+{
+  auto path = dir;
+  for (const auto &name: names)
+  {
+    path = childPath (path, name);
+  }
+
+  auto *current = root_.get ();
+  if (!dir.isEmpty ())
+  {
+    const auto dirIndex = index (dir);
+    current = dirIndex.isValid () ? node (dirIndex) : nullptr; // removed meanwhile
+  }
+  for (auto i = 0, end = entries.count (); current && i < end; ++i)
+  {
+    // listing of some part might have been applied meanwhile
+    auto row = current->entries.find (entries.names[i]);
+    if (row == -1)
+    {
+      row = insertEntry (current, entries, i);
+    }
+    current = (i < end - 1 ? childNode (current, row) : nullptr);
+  }
+  emit pathFetched (path);
+}
+
+void FileSystemModel::removeEntries (Node *node, int first, int last)
+{
+  beginRemoveRows (nodeIndex (node), first, last);
+
+  QList<Node *> orphans;
+  for (auto row = first; row <= last; ++row)
+  {
+    if (auto *child = node->children.take (node->entries.names[row]))
+    {
+      orphans << child;
+    }
+  }
+
+  const auto count = last - first + 1;
+  node->entries.remove (first, count);
+  for (auto *child: node->children)
+  {
+    if (child->row > last)
+    {
+      child->row -= count;
+    }
+  }
+
+  endRemoveRows ();
+
+  for (auto *orphan: orphans)
+  {
+    forget (orphan);
+    delete orphan;
+  }
+}
+
+void FileSystemModel::renameEntry (Node *node, int row, const QString &name)
+{
+  const auto old = node->entries.names[row];
+  node->entries.rename (row, name);
+  if (auto *child = node->children.take (old))
+  {
+    node->children.insert (name, child);
+    child->setPath (childPath (node->path, name));
+  }
+  emit dataChanged (createIndex (row, 0, node), createIndex (row, Column::ColumnCount - 1, node));
+}
+
+void FileSystemModel::forget (Node *node)
+{
+  loaded_.removeOne (node);
+  for (auto *child: node->children)
+  {
+    forget (child);
+  }
+}
+
+void FileSystemModel::touch (Node *node)
+{
+  if (loaded_.removeOne (node))
+  {
+    loaded_.append (node);
+  }
+}
+
+void FileSystemModel::evict ()
+{
+  auto cached = 0;
+  for (const auto *i: nonstd::as_const (loaded_))
+  {
+    if (!watcher_->isWatched (i->path))
+    {
+      cached += i->entries.count ();
+    }
+  }
+
+  for (auto i = 0; i < loaded_.size () && cached > maxCachedEntries;)
+  {
+    auto *candidate = loaded_[i];
+    const auto count = candidate->entries.count ();
+    if (watcher_->isWatched (candidate->path) || !unload (candidate))
+    {
+      ++i;
+      continue;
+    }
+    cached -= count;
+  }
+}
+
+bool FileSystemModel::unload (Node *node)
+{
+  // drop empty placeholders, keep directories that lead to loaded ones
+  for (auto it = node->children.begin (); it != node->children.end ();)
+  {
+    const auto *child = it.value ();
+    if (child->isLoaded || child->isLoading || child->entries.count () > 0 ||
+        !child->children.isEmpty () || watcher_->isWatched (child->path))
+    {
+      ++it;
+      continue;
+    }
+    delete child;
+    it = node->children.erase (it);
+  }
+
+  if (!node->children.isEmpty ())
+  {
+    return false;
+  }
+
+  loaded_.removeOne (node);
+  node->isLoaded = false;
+  const auto count = node->entries.count ();
+  if (count > 0)
+  {
+    beginRemoveRows (nodeIndex (node), 0, count - 1);
+    node->entries.clear ();
+    endRemoveRows ();
+  }
+  return true;
+}
+
+void FileSystemModel::applyChanges (const QString &path, const DirWatcher::Changes &changes)
+{
+  auto *dir = findNode (path);
+  if (changes.isRevalidateNeeded)
+  {
+    // polled directory is relisted and compared entry by entry: files changed
+    // on remote filesystems do not touch the stamp of their directory
+    if (dir && dir->isLoaded && !dir->isLoading && dir != root_.get ())
+    {
+      dir->isLoading = true;
+      dir->isPolled = true;
+      lister_->list (dir->path, dir->device);
+    }
+    return;
+  }
+
+  emit directoryChanged (path);
+  if (!dir)
+  {
+    return;
+  }
+  invalidateDirSizes (dir);
+  if (!dir->isLoaded)
+  {
+    if (dir->isLoading) // listing may have missed the change
+    {
+      load (dir);
+    }
+    return;
+  }
+
+  const auto count = changes.added.size () + changes.removed.size () + changes.modified.size ();
+  if (changes.isRescanNeeded || count > maxIncrementalChanges)
+  {
+    load (dir);
+    return;
+  }
+
+  auto &entries = dir->entries;
+  for (const auto &name: changes.removed)
+  {
+    const auto row = entries.find (name);
+    if (row != -1)
+    {
+      removeEntries (dir, row, row);
+    }
+  }
+
+  for (const auto &name: changes.added + changes.modified)
+  {
+    DirEntries fresh;
+    const auto row = entries.find (name);
+    if (!DirEntries::readEntry (childPath (path, name), name, fresh))
+    {
+      if (row != -1) // removed after the change
+      {
+        removeEntries (dir, row, row);
+      }
+      continue;
+    }
+
+    if (row == -1)
+    {
+      const auto last = entries.count ();
+      beginInsertRows (nodeIndex (dir), last, last);
+      entries.append (fresh, 0);
+      endInsertRows ();
+    }
+    else if (!entries.equals (row, fresh, 0))
+    {
+      entries.assign (row, fresh, 0);
+      emit dataChanged (createIndex (row, 0, dir), createIndex (row, Column::ColumnCount - 1, dir));
+    }
+  }
+}
+
+void FileSystemModel::updateSettings ()
+{
+  SettingsManager settings;
+  const auto showDirSizes = settings.get (SettingsManager::ShowDirSizes).toBool ();
+  if (showDirSizes == showDirSizes_)
+  {
+    return;
+  }
+
+  showDirSizes_ = showDirSizes;
+  knownDirSizes_.clear ();
+  for (auto *i: nonstd::as_const (loaded_))
+  {
+    if (showDirSizes_ && watcher_->isWatched (i->path))
+    {
+      DirSizes::invalidate (i->path); // changes were not tracked while hidden
+      requestDirSizes (i);
+    }
+    if (i->entries.count () > 0)
+    {
+      emit dataChanged (createIndex (0, Column::Size, i),
+                        createIndex (i->entries.count () - 1, Column::Size, i));
+    }
+  }
+}
+
+//! Recursive size of directory entry. -1 if unknown yet or not shown.
+qint64 FileSystemModel::dirSize (const QModelIndex &index) const
+{
+  const auto *dir = static_cast<Node *>(index.internalPointer ());
+  if (!showDirSizes_ || dir == root_.get () ||
+      dir->entries.has (index.row (), DirEntries::IsDotDot))
+  {
+    return -1;
+  }
+
+  const auto path = filePath (index);
+  const auto known = knownDirSizes_.constFind (path);
+  if (known != knownDirSizes_.constEnd ())
+  {
+    return known.value ();
+  }
+  dirSizes_->request (path);
+  return -1;
+}
+
+void FileSystemModel::requestDirSizes (Node *node)
+{
+  if (!showDirSizes_)
+  {
+    return;
+  }
+
+  const auto &entries = node->entries;
+  for (auto row = 0, end = entries.count (); row < end; ++row)
+  {
+    if (entries.has (row, DirEntries::IsDir) && !entries.has (row, DirEntries::IsDotDot))
+    {
+      dirSize (createIndex (row, Column::Size, node));
+    }
+  }
+}
+
+void FileSystemModel::updateDirSizes (const QVector<DirSizes::Size> &sizes)
+{
+  if (!showDirSizes_)
+  {
+    return;
+  }
+
+  if (knownDirSizes_.size () + sizes.size () > maxCachedEntries)
+  {
+    knownDirSizes_.clear ();
+  }
+
+  // a batch usually holds subdirectories of few parents, each one is resolved
+  // once and its changed rows are reported as one range
+  QHash<QString, QStringList> names;
+  for (const auto &i: sizes)
+  {
+    knownDirSizes_.insert (i.path, i.size);
+    const QFileInfo info (i.path);
+    names[info.path ()].append (info.fileName ());
+  }
+
+  for (auto it = names.cbegin (), end = names.cend (); it != end; ++it)
+  {
+    auto *dir = findNode (it.key ());
+    if (!dir)
+    {
+      continue;
+    }
+    auto first = -1;
+    auto last = -1;
+    for (const auto &name: it.value ())
+    {
+      const auto row = dir->entries.find (name);
+      if (row != -1)
+      {
+        first = (first == -1 ? row : std::min (first, row));
+        last = std::max (last, row);
+      }
+    }
+    if (first != -1)
+    {
+      emit dataChanged (createIndex (first, Column::Size, dir),
+                        createIndex (last, Column::Size, dir));
+    }
+  }
+}
+
+//! Sizes of node and its ancestors are outdated.
+void FileSystemModel::invalidateDirSizes (Node *node)
+{
+  if (!showDirSizes_)
+  {
+    return;
+  }
+  DirSizes::invalidate (node->path);
+
+  for (auto *i = node; i && i != root_.get (); i = i->parent)
+  {
+    if (knownDirSizes_.remove (i->path) > 0)
+    {
+      const auto index = nodeIndex (i, Column::Size);
+      emit dataChanged (index, index);
+    }
+  }
+}
+
 #include "moc_filesystemmodel.cpp"
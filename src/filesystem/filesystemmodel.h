@@ -1,10 +1,23 @@
 #pragma once
 
-#include <QFileSystemModel>
+#include "dirwatcher.h"
+#include "dirsizes.h"
+#include "filetypes.h"
+
+#include <QAbstractItemModel>
+#include <QFileInfo>
+#include <QIcon>
+#include <QFile>
+#include <QHash>
+
+#include <memory>
 
 class FileOperationModel;
+class DirLister;
+struct DirEntries;
+
 
-class FileSystemModel : public QFileSystemModel
+class FileSystemModel : public QAbstractItemModel
 {
 Q_OBJECT
 public:
@@ -14,15 +27,126 @@ public:
     ColumnCount
   };
 
+  enum Role
+  {
+    FileIconRole = Qt::DecorationRole,
+    FilePathRole = Qt::UserRole + 1,
+    FileNameRole = Qt::UserRole + 2,
+    FilePermissions = Qt::UserRole + 3
+  };
+
   FileSystemModel (FileOperationModel *operations, QObject *parent = nullptr);
-  bool dropMimeData (const QMimeData *data, Qt::DropAction action, int row,
-                     int column, const QModelIndex &parent) override;
-  int columnCount (const QModelIndex &parent) const override;
+  ~FileSystemModel ();
+
+  QModelIndex index (int row, int column, const QModelIndex &parent = {}) const override;
+  //! Invalid if some part of path is not listed yet, see fetchPath ().
+  QModelIndex index (const QString &path, int column = 0) const;
+  //! Entry of dir by name, invalid if it is not listed.
+  QModelIndex index (const QModelIndex &dir, const QString &name, int column = 0) const;
+  QModelIndex parent (const QModelIndex &child) const override;
+  int rowCount (const QModelIndex &parent = {}) const override;
+  int columnCount (const QModelIndex &parent = {}) const override;
+  bool hasChildren (const QModelIndex &parent = {}) const override;
+  bool canFetchMore (const QModelIndex &parent) const override;
+  void fetchMore (const QModelIndex &parent) override;
+
   QVariant headerData (int section, Qt::Orientation orientation, int role) const override;
   QVariant data (const QModelIndex &index, int role) const override;
   bool setData (const QModelIndex &index, const QVariant &value, int role) override;
   Qt::ItemFlags flags (const QModelIndex &index) const override;
 
+  QStringList mimeTypes () const override;
+  QMimeData * mimeData (const QModelIndexList &indexes) const override;
+  bool dropMimeData (const QMimeData *data, Qt::DropAction action, int row,
+                     int column, const QModelIndex &parent) override;
+  Qt::DropActions supportedDropActions () const override;
+
+  QString filePath (const QModelIndex &index) const;
+  QString fileName (const QModelIndex &index) const;
+  QFileInfo fileInfo (const QModelIndex &index) const;
+  bool isDir (const QModelIndex &index) const;
+  bool isDotDot (const QModelIndex &index) const;
+  bool isHidden (const QModelIndex &index) const;
+  bool isSymLink (const QModelIndex &index) const;
+  qint64 size (const QModelIndex &index) const;
+  QString type (const QModelIndex &index) const;
+  QDateTime lastModified (const QModelIndex &index) const;
+  qint64 lastModifiedMsecs (const QModelIndex &index) const;
+  QFile::Permissions permissions (const QModelIndex &index) const;
+  //! DirEntries::ColorClass of the entry.
+  int colorClass (const QModelIndex &index) const;
+
+  QModelIndex mkdir (const QModelIndex &parent, const QString &name);
+
+  bool isReadOnly () const;
+  void setReadOnly (bool isReadOnly);
+
+  //! Keep directory listing loaded and up to date while it is watched.
+  void watch (const QString &path);
+  void unwatch (const QString &path);
+  //! Load listing in background with low priority if it is not cached.
+  //! Prefetched listings are the first to be evicted until they are used.
+  void prefetch (const QString &path);
+  //! First rows of directory are shown while the rest is still being read.
+  bool isStreaming (const QModelIndex &dir) const;
+  //! Subdirectories of already loaded directory. Does not touch filesystem.
+  QStringList loadedDirNames (const QString &path) const;
+  //! Reads parts of path that are not listed yet in background. Emits
+  //! pathFetched when index () of path is valid or path is not found.
+  void fetchPath (const QString &path);
+
+signals:
+  void fileRenamed (const QString &path, const QString &oldName, const QString &newName);
+  void directoryLoaded (const QString &path);
+  //! Watcher reported changes in directory.
+  void directoryChanged (const QString &path);
+  //! Path passed to fetchPath () in its clean form.
+  void pathFetched (const QString &path);
+
+public slots:
+  void updateSettings ();
+
 private:
+  struct Node;
+
+  Node * node (const QModelIndex &index) const;
+  Node * childNode (Node *parent, int row) const;
+  Node * findNode (const QString &path) const;
+  QModelIndex nodeIndex (Node *node, int column = 0) const;
+  bool isValidEntry (const QModelIndex &index) const;
+
+  void load (Node *node);
+  void applyListingPart (const QString &path, const DirEntries &entries);
+  void applyListing (const QString &path, const DirEntries &entries);
+  void appendEntries (Node *node, const DirEntries &source, int first);
+  //! True if rows changed.
+  bool merge (Node *node, const DirEntries &entries);
+  int addEntry (Node *node, const QString &name);
+  int insertEntry (Node *node, const DirEntries &source, int sourceRow);
+  void applyPath (const QString &dir, const QStringList &names, const DirEntries &entries);
+  void removeEntries (Node *node, int first, int last);
+  void renameEntry (Node *node, int row, const QString &name);
+  void forget (Node *node);
+  void touch (Node *node);
+  void evict ();
+  bool unload (Node *node);
+  void applyChanges (const QString &path, const DirWatcher::Changes &changes);
+  FileTypes::Type fileType (const Node *dir, int row, bool isSniffAllowed) const;
+  void updateSniffedTypes (const QString &path, const QStringList &names);
+  qint64 dirSize (const QModelIndex &index) const;
+  void requestDirSizes (Node *node);
+  void updateDirSizes (const QVector<DirSizes::Size> &sizes);
+  void invalidateDirSizes (Node *node);
+
   FileOperationModel *operations_;
+  DirLister *lister_;
+  DirWatcher *watcher_;
+  DirSizes *dirSizes_;
+  FileTypes *types_;
+  bool showDirSizes_;
+  QHash<QString, qint64> knownDirSizes_; // by path, asked from dirSizes_ if missing
+  std::unique_ptr<Node> root_;
+  QList<Node *> loaded_; // least recently used first
+  QIcon driveIcon_;
+  bool isReadOnly_;
 };
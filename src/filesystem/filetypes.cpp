@@ -0,0 +1,257 @@
+#include "filetypes.h"
+#include "debug.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+#include <QMimeDatabase>
+#include <QFileIconProvider>
+
+struct FileTypesState
+{
+  struct Sniffed
+  {
+    QString dir;
+    QString path;
+    QString mimeName;
+  };
+
+  QMutex mutex;
+  FileTypes *owner;
+  QVector<QPair<QString, QString> > queue; // dir, path. Most wanted last
+  QVector<Sniffed> sniffed;
+  int workerCount;
+};
+
+namespace
+{
+const int deliveryDelayMs = 100;
+const int maxSniffers = 2;
+const int maxSniffedFiles = 100000;
+
+QString childPath (const QString &dir, const QString &name)
+{
+  return dir.endsWith (QLatin1Char ('/')) ? dir + name : dir + QLatin1Char ('/') + name;
+}
+
+class SniffTask : public QRunnable
+{
+public:
+  explicit SniffTask (const QSharedPointer<FileTypesState> &state) :
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  QSharedPointer<FileTypesState> state_;
+};
+}
+
+
+FileTypes::FileTypes (QObject *parent) :
+  QObject (parent),
+  bySuffix_ (),
+  byMime_ (),
+  sniffed_ (),
+  requested_ (),
+  dirIcon_ (),
+  fileIcon_ (),
+  state_ (new FileTypesState),
+  pool_ (new QThreadPool),
+  deliveryTimer_ (new QTimer (this))
+{
+  state_->owner = this;
+  state_->workerCount = 0;
+  pool_->setMaxThreadCount (maxSniffers);
+
+  QFileIconProvider icons;
+  dirIcon_ = icons.icon (QFileIconProvider::Folder);
+  fileIcon_ = icons.icon (QFileIconProvider::File);
+
+  deliveryTimer_->setSingleShot (true);
+  deliveryTimer_->setInterval (deliveryDelayMs);
+  connect (deliveryTimer_, &QTimer::timeout,
+           this, &FileTypes::deliver);
+}
+
+FileTypes::~FileTypes ()
+{
+  {
+    QMutexLocker locker (&state_->mutex);
+    state_->owner = nullptr;
+    state_->queue.clear ();
+  }
+
+  if (!pool_->waitForDone (1000))
+  {
+    LWARNING () << "Content type recognition hangs. Leaving its workers";
+    return;
+  }
+  delete pool_;
+}
+
+FileTypes::Type FileTypes::type (const QString &dir, const QString &name, int flags,
+                                 bool isSniffAllowed)
+{
+  auto suffix = QString ();
+  if (!(flags & IsDir))
+  {
+    const auto dot = name.lastIndexOf (QLatin1Char ('.'));
+    suffix = (dot > 0 ? name.mid (dot + 1) : QString ());
+  }
+
+  const Key key (suffix, flags);
+  auto bySuffix = bySuffix_.constFind (key);
+  if (bySuffix == bySuffix_.constEnd ())
+  {
+    bySuffix = bySuffix_.insert (key, resolve (suffix, {}, flags));
+  }
+  if (!bySuffix->isGeneric)
+  {
+    return *bySuffix;
+  }
+
+  const auto path = childPath (dir, name);
+  const auto known = sniffed_.constFind (path);
+  if (known == sniffed_.constEnd ())
+  {
+    if (isSniffAllowed)
+    {
+      sniff (dir, path);
+    }
+    return *bySuffix;
+  }
+
+  const Key mimeKey (known.value (), flags);
+  auto byMime = byMime_.constFind (mimeKey);
+  if (byMime == byMime_.constEnd ())
+  {
+    byMime = byMime_.insert (mimeKey, resolve (suffix, known.value (), flags));
+  }
+  return byMime->isGeneric ? *bySuffix : *byMime;
+}
+
+FileTypes::Type FileTypes::resolve (const QString &suffix, const QString &mimeName,
+                                    int flags) const
+{
+  Type result;
+  result.isGeneric = false;
+  if (flags & IsDir)
+  {
+    result.name = tr ("Folder");
+    result.icon = dirIcon_;
+  }
+  else
+  {
+    QMimeDatabase db;
+    const auto mime = (mimeName.isEmpty ()
+                       ? db.mimeTypeForFile (QLatin1String ("file.") + suffix,
+                                             QMimeDatabase::MatchExtension)
+                       : db.mimeTypeForName (mimeName));
+    result.isGeneric = !mime.isValid () || mime.isDefault ();
+
+    if (result.isGeneric)
+    {
+      result.name = (suffix.isEmpty () ? tr ("File") : tr ("%1 File").arg (suffix));
+      result.icon = ((flags & IsExecutable)
+                     ? QIcon::fromTheme (QLatin1String ("application-x-executable"), fileIcon_)
+                     : fileIcon_);
+    }
+    else
+    {
+      result.name = mime.comment ();
+      result.icon = QIcon::fromTheme (mime.iconName (),
+                                      QIcon::fromTheme (mime.genericIconName (), fileIcon_));
+    }
+  }
+
+  if (flags & IsSymLink)
+  {
+    result.name += tr (", link");
+  }
+  return result;
+}
+
+void FileTypes::sniff (const QString &dir, const QString &path)
+{
+  if (requested_.contains (path))
+  {
+    return;
+  }
+  requested_.insert (path);
+
+  QMutexLocker locker (&state_->mutex);
+  state_->queue.append (qMakePair (dir, path));
+  if (state_->workerCount < pool_->maxThreadCount ())
+  {
+    ++state_->workerCount;
+    pool_->start (new SniffTask (state_));
+  }
+}
+
+void FileTypes::scheduleDelivery ()
+{
+  if (!deliveryTimer_->isActive ())
+  {
+    deliveryTimer_->start ();
+  }
+}
+
+void FileTypes::deliver ()
+{
+  QVector<FileTypesState::Sniffed> results;
+  {
+    QMutexLocker locker (&state_->mutex);
+    results.swap (state_->sniffed);
+  }
+
+  if (sniffed_.size () + results.size () > maxSniffedFiles)
+  {
+    sniffed_.clear ();
+  }
+
+  QHash<QString, QStringList> names; // by dir
+  for (const auto &i: results)
+  {
+    requested_.remove (i.path);
+    sniffed_.insert (i.path, i.mimeName);
+    names[i.dir] << i.path.mid (i.path.lastIndexOf (QLatin1Char ('/')) + 1);
+  }
+  for (auto it = names.cbegin (), end = names.cend (); it != end; ++it)
+  {
+    emit sniffed (it.key (), it.value ());
+  }
+}
+
+void SniffTask::run ()
+{
+  QMimeDatabase db;
+  forever
+  {
+    QPair<QString, QString> request;
+    {
+      QMutexLocker locker (&state_->mutex);
+      if (state_->queue.isEmpty () || !state_->owner)
+      {
+        --state_->workerCount;
+        return;
+      }
+      request = state_->queue.takeLast ();
+    }
+
+    const auto mime = db.mimeTypeForFile (request.second, QMimeDatabase::MatchContent);
+
+    QMutexLocker locker (&state_->mutex);
+    state_->sniffed.append ({request.first, request.second, mime.name ()});
+    if (state_->sniffed.size () == 1 && state_->owner)
+    {
+      QMetaObject::invokeMethod (state_->owner, "scheduleDelivery", Qt::QueuedConnection);
+    }
+  }
+}
+
+#include "moc_filetypes.cpp"
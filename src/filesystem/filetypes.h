@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QObject>
+#include <QIcon>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QSharedPointer>
+
+class QThreadPool;
+class QTimer;
+struct FileTypesState;
+
+// Type names and icons of files. They are resolved once per suffix and kind of
+// entry, so rows of a large directory only look them up. Files whose suffix
+// says nothing are recognized by content in background when they are shown.
+class FileTypes : public QObject
+{
+Q_OBJECT
+public:
+  enum Flag
+  {
+    IsDir = 0x01, IsSymLink = 0x02, IsExecutable = 0x04
+  };
+
+  struct Type
+  {
+    QString name; // with link mark for links
+    QIcon icon;
+    bool isGeneric; // suffix is unknown, content could tell more
+  };
+
+  explicit FileTypes (QObject *parent = nullptr);
+  ~FileTypes ();
+
+  //! Type by name of entry. Content type if it was already recognized.
+  //! Otherwise recognition is requested if isSniffAllowed.
+  Type type (const QString &dir, const QString &name, int flags, bool isSniffAllowed);
+
+signals:
+  //! Content types of named files in directory were recognized.
+  void sniffed (const QString &dir, const QStringList &names);
+
+private slots:
+  void scheduleDelivery ();
+
+private:
+  using Key = QPair<QString, int>; // suffix or mime name, flags
+
+  Type resolve (const QString &suffix, const QString &mimeName, int flags) const;
+  void sniff (const QString &dir, const QString &path);
+  void deliver ();
+
+  QHash<Key, Type> bySuffix_;
+  QHash<Key, Type> byMime_;
+  QHash<QString, QString> sniffed_; // file path -> mime name
+  QSet<QString> requested_;
+  QIcon dirIcon_;
+  QIcon fileIcon_;
+  QSharedPointer<FileTypesState> state_;
+  QThreadPool *pool_;
+  QTimer *deliveryTimer_;
+};
@@ -0,0 +1,186 @@
+#include "namefilter.h"
+
+#include <algorithm>
+
+namespace
+{
+bool isSubsequence (const QString &needle, const QString &haystack)
+{
+  auto position = 0;
+  for (const auto &c: needle)
+  {
+    position = haystack.indexOf (c, position, Qt::CaseInsensitive);
+    if (position == -1)
+    {
+      return false;
+    }
+    ++position;
+  }
+  return true;
+}
+
+bool isWordStart (const QString &name, int index)
+{
+  if (index == 0)
+  {
+    return true;
+  }
+  const auto previous = name.at (index - 1);
+  return !previous.isLetterOrNumber () || (previous.isLower () && name.at (index).isUpper ());
+}
+}
+
+
+NameFilter::NameFilter (const QString &pattern, Mode mode) :
+  pattern_ (pattern),
+  mode_ (mode),
+  kind_ (Kind::Any),
+  text_ (),
+  re_ ()
+{
+  const auto star = QLatin1Char ('*');
+  if (mode_ == Mode::Fuzzy)
+  {
+    text_ = pattern;
+    text_.remove (star).remove (QLatin1Char ('?'));
+    kind_ = text_.isEmpty () ? Kind::Any : Kind::Fuzzy;
+    return;
+  }
+
+  auto first = 0;
+  auto last = pattern.size () - 1;
+  while (first <= last && pattern.at (first) == star)
+  {
+    ++first;
+  }
+  while (last >= first && pattern.at (last) == star)
+  {
+    --last;
+  }
+  const auto core = pattern.mid (first, last - first + 1);
+
+  if (core.contains (star) || core.contains (QLatin1Char ('?')) ||
+      core.contains (QLatin1Char ('[')))
+  {
+    kind_ = Kind::Wildcard;
+    re_ = QRegExp (pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+    return;
+  }
+
+  text_ = core;
+  const auto isLeading = first > 0;
+  const auto isTrailing = last < pattern.size () - 1;
+  if (core.isEmpty ())
+  {
+    kind_ = Kind::Any;
+  }
+  else if (isLeading && isTrailing)
+  {
+    kind_ = Kind::Substring;
+  }
+  else if (isLeading)
+  {
+    kind_ = Kind::Suffix;
+  }
+  else if (isTrailing)
+  {
+    kind_ = Kind::Prefix;
+  }
+  else
+  {
+    kind_ = Kind::Exact;
+  }
+}
+
+const QString &NameFilter::pattern () const
+{
+  return pattern_;
+}
+
+NameFilter::Mode NameFilter::mode () const
+{
+  return mode_;
+}
+
+bool NameFilter::isEmpty () const
+{
+  return kind_ == Kind::Any;
+}
+
+bool NameFilter::matches (const QString &name) const
+{
+  return score (name) >= 0;
+}
+
+int NameFilter::score (const QString &name) const
+{
+  auto isMatched = false;
+  switch (kind_)
+  {
+    case Kind::Any: isMatched = true; break;
+    case Kind::Exact: isMatched = name.compare (text_, Qt::CaseInsensitive) == 0; break;
+    case Kind::Prefix: isMatched = name.startsWith (text_, Qt::CaseInsensitive); break;
+    case Kind::Suffix: isMatched = name.endsWith (text_, Qt::CaseInsensitive); break;
+    case Kind::Substring: isMatched = name.contains (text_, Qt::CaseInsensitive); break;
+    case Kind::Wildcard: isMatched = re_.exactMatch (name); break;
+    case Kind::Fuzzy: return fuzzyScore (name);
+  }
+  return isMatched ? 0 : -1;
+}
+
+bool NameFilter::narrows (const NameFilter &other) const
+{
+  if (other.kind_ == Kind::Any)
+  {
+    return true;
+  }
+
+  const auto &text = other.text_;
+  switch (other.kind_)
+  {
+    case Kind::Fuzzy:
+      return kind_ == Kind::Fuzzy && isSubsequence (text, text_);
+
+    case Kind::Substring:
+      return (kind_ == Kind::Substring || kind_ == Kind::Prefix ||
+              kind_ == Kind::Suffix || kind_ == Kind::Exact) &&
+             text_.contains (text, Qt::CaseInsensitive);
+
+    case Kind::Prefix:
+      return (kind_ == Kind::Prefix || kind_ == Kind::Exact) &&
+             text_.startsWith (text, Qt::CaseInsensitive);
+
+    case Kind::Suffix:
+      return (kind_ == Kind::Suffix || kind_ == Kind::Exact) &&
+             text_.endsWith (text, Qt::CaseInsensitive);
+
+    case Kind::Exact:
+      return kind_ == Kind::Exact && text_.compare (text, Qt::CaseInsensitive) == 0;
+
+    default:
+      return false;
+  }
+}
+
+int NameFilter::fuzzyScore (const QString &name) const
+{
+  // every matched char gives a point, runs and word starts give more
+  auto score = 0;
+  auto position = 0;
+  auto previous = -2;
+  for (const auto &c: text_)
+  {
+    const auto found = name.indexOf (c, position, Qt::CaseInsensitive);
+    if (found == -1)
+    {
+      return -1;
+    }
+    score += 1;
+    score += (found == previous + 1) ? 4 : 0;
+    score += isWordStart (name, found) ? 3 : 0;
+    previous = found;
+    position = found + 1;
+  }
+  // prefer shorter names among equal matches
+  return std::max (0, score * 8 - (name.size () - text_.size ()) / 4);
+}
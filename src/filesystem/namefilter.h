@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QString>
+#include <QRegExp>
+
+// Case insensitive file name filter, compiled once per pattern. Wildcard
+// patterns that are plain prefixes, suffixes or substrings avoid QRegExp.
+class NameFilter
+{
+public:
+  enum class Mode
+  {
+    Wildcard, Fuzzy
+  };
+
+  explicit NameFilter (const QString &pattern = {}, Mode mode = Mode::Wildcard);
+
+  const QString &pattern () const;
+  Mode mode () const;
+  bool isEmpty () const;
+
+  bool matches (const QString &name) const;
+  //! Match quality, higher is better. -1 if not matched.
+  int score (const QString &name) const;
+  //! True if names accepted by this filter are a subset of ones accepted by other.
+  bool narrows (const NameFilter &other) const;
+
+private:
+  enum class Kind
+  {
+    Any, Exact, Prefix, Suffix, Substring, Wildcard, Fuzzy
+  };
+
+  int fuzzyScore (const QString &name) const;
+
+  QString pattern_;
+  Mode mode_;
+  Kind kind_;
+  QString text_;
+  QRegExp re_;
+};
@@ -1,16 +1,52 @@
 #include "proxymodel.h"
 #include "filesystemmodel.h"
+#include "direntries.h"
 #include "constants.h"
-#include "backgroundreader.h"
+#include "thumbnaildecoder.h"
 #include "styleoptionsproxy.h"
 #include "debug.h"
 #include "settingsmanager.h"
 
 #include <QDateTime>
+#include <QItemSelection>
+#include <QColor>
 #include <QPixmapCache>
-#include <QImageReader>
-#include <QThread>
-#include <QRegExp>
+#include <QPixmap>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QCache>
+
+#include <algorithm>
+
+namespace
+{
+const int backgroundSortRows = 10000;
+const int maxSnapshotRows = 1000000;
+
+const qint64 notCounted = -2;
+const qint64 countedDir = -1;
+
+bool hasSortKeys (int column)
+{
+  return column == FileSystemModel::Name || column == FileSystemModel::Size ||
+         column == FileSystemModel::Type || column == FileSystemModel::Date;
+}
+
+//! Ranks do not depend on order and filters, these are applied on top.
+QString snapshotKey (const QString &path, int column, bool isCaseSensitive)
+{
+  return path + QLatin1Char ('\n') + QString::number (column) +
+         (isCaseSensitive ? QLatin1Char ('c') : QLatin1Char ('i'));
+}
+
+//! Whether path is an entry of dir. Compares strings only.
+bool isEntryOf (const QString &path, const QString &dir)
+{
+  const auto slash = path.lastIndexOf (QLatin1Char ('/'));
+  const auto length = dir.endsWith (QLatin1Char ('/')) ? slash + 1 : slash;
+  return slash != -1 && length == dir.size () && path.startsWith (dir);
+}
+}
 
 
 ProxyModel::ProxyModel (FileSystemModel *model, QObject *parent) :
@@ -22,33 +58,47 @@ ProxyModel::ProxyModel (FileSystemModel *model, QObject *parent) :
   showHidden_ (false),
   showThumbnails_ (false),
   caseSensitiveSort_ (false),
+  isFuzzyFilter_ (false),
   nameFilter_ (),
+  nameScores_ (),
+  collator_ (SortKeys::collator (false)),
+  sortRanks_ (),
+  rankedColumn_ (-1),
+  sortKeys_ (),
+  sortWatcher_ (nullptr),
+  pendingSortColumn_ (-1),
+  pendingSortOrder_ (Qt::AscendingOrder),
+  isSortDeferred_ (false),
   rootItem_ (),
+  watchedPath_ (),
+  countedValues_ (),
+  totals_ (),
   currentItem_ (),
-  iconReaderThread_ (new QThread (this)),
   currentColor_ (),
-  dirColor_ (),
-  inaccessibleDirColor_ (),
-  executableColor_ (),
-  unreadableFileColor_ ()
+  colors_ (DirEntries::ColorClassCount)
 {
   setSourceModel (model);
 
+  connect (model, &FileSystemModel::rowsAboutToBeInserted,
+           this, &ProxyModel::deferSort);
+  connect (model, &FileSystemModel::rowsInserted,
+           this, &ProxyModel::resumeSort);
+  connect (model, &FileSystemModel::directoryLoaded,
+           this, &ProxyModel::resumeLoadedSort);
   connect (model, &FileSystemModel::rowsInserted,
            this, &ProxyModel::detectContentsChange);
   connect (model, &FileSystemModel::rowsRemoved,
            this, &ProxyModel::detectContentsChange);
 
-  auto *reader = new BackgroundReader;
-  connect (this, &ProxyModel::iconRequested,
-           reader, &BackgroundReader::readIcon);
-  connect (reader, &BackgroundReader::iconRead,
-           this, &ProxyModel::updateIcon);
+  connect (model, &FileSystemModel::rowsInserted,
+           this, &ProxyModel::countInserted);
+  connect (model, &FileSystemModel::rowsAboutToBeRemoved,
+           this, &ProxyModel::countRemoved);
+  connect (model, &FileSystemModel::dataChanged,
+           this, &ProxyModel::countChanged);
 
-  reader->moveToThread (iconReaderThread_);
-  connect (iconReaderThread_, &QThread::finished,
-           reader, &QObject::deleteLater);
-  iconReaderThread_->start ();
+  connect (&ThumbnailLoader::instance (), &ThumbnailLoader::loaded,
+           this, &ProxyModel::updateIcons);
 
   connect (&StyleOptionsProxy::instance (), &StyleOptionsProxy::changed,
            this, &ProxyModel::updateStyle);
@@ -60,8 +110,11 @@ ProxyModel::ProxyModel (FileSystemModel *model, QObject *parent) :
 
 ProxyModel::~ProxyModel ()
 {
-  iconReaderThread_->quit ();
-  iconReaderThread_->wait (2000);
+  ThumbnailLoader::instance ().prioritize (this, {});
+  if (sourceModel ())
+  {
+    model_->unwatch (watchedPath_);
+  }
 }
 
 bool ProxyModel::showDirs () const
@@ -77,6 +130,7 @@ void ProxyModel::setShowDirs (bool showDirs)
   }
   showDirs_ = showDirs;
   invalidateFilter ();
+  recount ();
   emit contentsChanged ();
 }
 
@@ -93,6 +147,7 @@ void ProxyModel::setShowFiles (bool showFiles)
   }
   showFiles_ = showFiles;
   invalidateFilter ();
+  recount ();
   emit contentsChanged ();
 }
 
@@ -109,6 +164,7 @@ void ProxyModel::setShowDotDot (bool showDotDot)
   }
   showDotDot_ = showDotDot;
   invalidateFilter ();
+  recount ();
   emit contentsChanged ();
 }
 
@@ -125,6 +181,7 @@ void ProxyModel::setShowHidden (bool showHidden)
   }
   showHidden_ = showHidden;
   invalidateFilter ();
+  recount ();
   emit contentsChanged ();
 }
 
@@ -136,33 +193,53 @@ bool ProxyModel::showThumbnails () const
 void ProxyModel::setShowThumbnails (bool isOn)
 {
   showThumbnails_ = isOn;
-  emit dataChanged (index (0, FileSystemModel::Name), index (rowCount () - 1, FileSystemModel::Size),
-                    {Qt::DecorationRole});
-}
-
-bool ProxyModel::isDir (int row) const
-{
-  return model_->isDir (mapToSource (index (row, 0, rootIndex ())));
+  if (!showThumbnails_)
+  {
+    ThumbnailLoader::instance ().prioritize (this, {});
+  }
+  const auto parent = rootIndex ();
+  const auto rows = rowCount (parent);
+  if (rows > 0)
+  {
+    emit dataChanged (index (0, FileSystemModel::Name, parent),
+                      index (rows - 1, FileSystemModel::Name, parent), {Qt::DecorationRole});
+  }
 }
 
-qint64 ProxyModel::fileSize (int row) const
+ProxyModel::Totals ProxyModel::totals () const
 {
-  return model_->size (mapToSource (index (row, 0, rootIndex ())));
+  return totals_;
 }
 
-QString ProxyModel::fileName (int row) const
+ProxyModel::Totals ProxyModel::totals (const QItemSelection &selection) const
 {
-  return model_->fileName (mapToSource (index (row, 0, rootIndex ())));
+  auto result = Totals ();
+  for (const auto &range: selection)
+  {
+    if (range.model () != this || range.parent () != rootIndex ())
+    {
+      continue;
+    }
+    for (auto row = range.top (), end = range.bottom (); row <= end; ++row)
+    {
+      const auto sourceRow = mapToSource (index (row, 0, range.parent ())).row ();
+      if (sourceRow >= 0 && sourceRow < countedValues_.size ())
+      {
+        account (result, countedValues_[sourceRow], 1);
+      }
+    }
+  }
+  return result;
 }
 
-int ProxyModel::count () const
+QString ProxyModel::filePath (const QModelIndex &index) const
 {
-  return rowCount (rootIndex ());
+  return model_->filePath (mapToSource (index));
 }
 
 bool ProxyModel::isDotDot (const QModelIndex &index) const
 {
-  return model_->fileName (mapToSource (index.sibling (index.row (), 0))) == constants::dotdot;
+  return model_->isDotDot (mapToSource (index.sibling (index.row (), 0)));
 }
 
 QFileInfo ProxyModel::currentPath () const
@@ -183,25 +260,76 @@ void ProxyModel::setCurrentIndex (const QModelIndex &index)
 
 void ProxyModel::setNameFilter (const QString &name)
 {
-  if (nameFilter_ == name)
+  if (nameFilter_.pattern () == name)
   {
     return;
   }
-  nameFilter_ = name;
-  invalidateFilter ();
+
+  const NameFilter filter (name, isFuzzyFilter_ ? NameFilter::Mode::Fuzzy
+                                                : NameFilter::Mode::Wildcard);
+  if (filter.narrows (nameFilter_))
+  {
+    // rejected rows stay rejected, re-test only accepted ones
+    for (auto &i: nameScores_)
+    {
+      if (i.score >= 0)
+      {
+        i.name.clear ();
+      }
+    }
+  }
+  else
+  {
+    nameScores_.clear ();
+  }
+  nameFilter_ = filter;
+
+  if (isFuzzyFilter_)
+  {
+    invalidate (); // order depends on scores
+  }
+  else
+  {
+    invalidateFilter ();
+  }
+  recount ();
   emit contentsChanged ();
 }
 
-void ProxyModel::setRootIndex (const QModelIndex &index)
+void ProxyModel::setSourceRoot (const QModelIndex &sourceIndex)
 {
-  const auto mapped = mapToSource (index);
+  const auto mapped = sourceIndex.sibling (sourceIndex.row (), FileSystemModel::Name);
   if (rootItem_ == mapped)
   {
     return;
   }
   rootItem_ = mapped;
+  nameScores_.clear ();
+  sortRanks_.clear ();
+  cancelSort ();
+  ThumbnailLoader::instance ().prioritize (this, {});
+
+  const auto path = model_->filePath (mapped);
+  model_->watch (path);
+  model_->unwatch (watchedPath_);
+  watchedPath_ = path;
+
+  // revisited directory is shown in its last order, changed rows are compared
+  // directly. Large one without snapshot keeps listing order until ranked
+  const auto column = sortColumn ();
+  const auto isRanked = restoreRanks (path);
+  if (!isRanked && hasSortKeys (column) && model_->rowCount (mapped) >= backgroundSortRows)
+  {
+    isSortDeferred_ = true;
+  }
+
   invalidateFilter ();
-  emit currentChanged (index);
+  if (isSortDeferred_)
+  {
+    startSort (column, sortOrder ());
+  }
+  recount ();
+  emit currentChanged (rootIndex ());
   emit contentsChanged ();
 }
 
@@ -222,40 +350,46 @@ bool ProxyModel::filterAcceptsRow (int sourceRow, const QModelIndex &sourceParen
     }
   }
 #endif
-  if (sourceParent == rootItem_)
+  if (sourceParent != rootItem_)
   {
-    const auto canFilter = !showDirs_ || !showFiles_ || !showDotDot_ ||
-                           !showHidden_ || !nameFilter_.isEmpty ();
-    if (canFilter)
+    // outside of root only the way to it is mapped, so the base class drops
+    // signals of unrelated directories without filtering or sorting them
+    for (auto i = QModelIndex (rootItem_); i.isValid (); i = i.parent ())
     {
-      const auto info = model_->fileInfo (model_->index (sourceRow, 0, sourceParent));
-      if (!showDirs_ && info.isDir ())
+      if (i.row () == sourceRow && i.parent () == sourceParent)
       {
-        return false;
-      }
-      if (!showFiles_ && info.isFile ())
-      {
-        return false;
-      }
-      if (!showDotDot_ && info.fileName () == constants::dotdot)
-      {
-        return false;
-      }
-      if (!showHidden_ && info.isHidden () && info.fileName () != constants::dotdot)
-      {
-        return false;
-      }
-      if (!nameFilter_.isEmpty () )
-      {
-        QRegExp re (nameFilter_);
-        re.setPatternSyntax (QRegExp::Wildcard);
-        re.setCaseSensitivity (Qt::CaseInsensitive);
-        if (!re.exactMatch (info.fileName ()))
-        {
-          return false;
-        }
+        return true;
       }
     }
+    return false;
+  }
+
+  const auto canFilter = !showDirs_ || !showFiles_ || !showDotDot_ ||
+                         !showHidden_ || !nameFilter_.isEmpty ();
+  if (canFilter)
+  {
+    const auto index = model_->index (sourceRow, 0, sourceParent);
+    const auto isDir = model_->isDir (index);
+    if (!showDirs_ && isDir)
+    {
+      return false;
+    }
+    if (!showFiles_ && !isDir)
+    {
+      return false;
+    }
+    if (!showDotDot_ && model_->isDotDot (index))
+    {
+      return false;
+    }
+    if (!showHidden_ && model_->isHidden (index))
+    {
+      return false;
+    }
+    if (!nameFilter_.isEmpty () && nameScore (index) < 0)
+    {
+      return false;
+    }
   }
   return true;
 }
@@ -269,37 +403,21 @@ QVariant ProxyModel::data (const QModelIndex &index, int role) const
     {
       return currentColor_;
     }
-    const auto info = model_->fileInfo (mapToSource (index));
-    if (info.isDir ())
-    {
-      if (!info.isExecutable () || !info.isReadable ())
-      {
-        return inaccessibleDirColor_;
-      }
-      return dirColor_;
-    }
-    if (info.isExecutable ())
-    {
-      return executableColor_;
-    }
-    else if (!info.isReadable ())
-    {
-      return unreadableFileColor_;
-    }
-    return {};
+    return colors_[model_->colorClass (mapToSource (index))];
   }
 
   if (showThumbnails_ && role == Qt::DecorationRole && index.column () == FileSystemModel::Name)
   {
-    const auto info = model_->fileInfo (mapToSource (index));
-    if (QImageReader::supportedImageFormats ().contains (info.suffix ().toUtf8 ()))
+    const auto source = mapToSource (index);
+    const auto path = model_->filePath (source);
+    if (ThumbnailDecoder::isSupported (QFileInfo (path).suffix ()))
     {
-      const auto path = info.absoluteFilePath ();
       if (auto cached = QPixmapCache::find (path))
       {
         return QIcon (*cached);
       }
-      emit const_cast<ProxyModel *>(this)->iconRequested (path);
+      ThumbnailLoader::instance ().request (this, path, model_->lastModifiedMsecs (source),
+                                            model_->size (source));
     }
     return QSortFilterProxyModel::data (index, role);
   }
@@ -313,13 +431,42 @@ QVariant ProxyModel::data (const QModelIndex &index, int role) const
 }
 
 
-void ProxyModel::updateIcon (const QString &fileName, const QPixmap &pixmap)
+void ProxyModel::setVisibleRows (const QModelIndex &first, const QModelIndex &last)
 {
-  auto index = mapFromSource (model_->index (fileName));
-  if (index.isValid ())
+  QStringList paths;
+  if (showThumbnails_ && first.isValid () && last.isValid ())
   {
-    QPixmapCache::insert (fileName, pixmap);
-    emit dataChanged (index, index, {Qt::DecorationRole});
+    for (auto row = first.row (), end = last.row (); row <= end; ++row)
+    {
+      paths.append (model_->filePath (mapToSource (first.sibling (row, FileSystemModel::Name))));
+    }
+  }
+  ThumbnailLoader::instance ().prioritize (this, paths);
+}
+
+void ProxyModel::updateIcons (const QStringList &paths)
+{
+  auto first = -1;
+  auto last = -1;
+  for (const auto &i: paths)
+  {
+    if (!isEntryOf (i, watchedPath_)) // loaded for other views
+    {
+      continue;
+    }
+    const auto name = i.mid (i.lastIndexOf (QLatin1Char ('/')) + 1);
+    const auto index = mapFromSource (model_->index (rootItem_, name));
+    if (index.isValid ())
+    {
+      first = (first == -1 ? index.row () : std::min (first, index.row ()));
+      last = std::max (last, index.row ());
+    }
+  }
+  if (first != -1)
+  {
+    const auto parent = rootIndex ();
+    emit dataChanged (index (first, FileSystemModel::Name, parent),
+                      index (last, FileSystemModel::Name, parent), {Qt::DecorationRole});
   }
 }
 
@@ -327,10 +474,10 @@ void ProxyModel::updateStyle ()
 {
   const auto &options = StyleOptionsProxy::instance ();
   currentColor_ = options.currentRowColor ();
-  dirColor_ =  options.dirColor ();
-  inaccessibleDirColor_ =  options.inaccessibleDirColor ();
-  executableColor_ =  options.executableColor ();
-  unreadableFileColor_ =  options.unreadableFileColor ();
+  colors_[DirEntries::Dir] = options.dirColor ();
+  colors_[DirEntries::InaccessibleDir] = options.inaccessibleDirColor ();
+  colors_[DirEntries::Executable] = options.executableColor ();
+  colors_[DirEntries::UnreadableFile] = options.unreadableFileColor ();
 
   if (rootItem_.isValid ())
   {
@@ -346,8 +493,40 @@ void ProxyModel::updateStyle ()
 void ProxyModel::updateSettings ()
 {
   SettingsManager settings;
-  caseSensitiveSort_ = settings.get (SettingsManager::CaseSensitiveSort).toBool ();
-  invalidate ();
+  auto isChanged = false;
+
+  const auto caseSensitiveSort = settings.get (SettingsManager::CaseSensitiveSort).toBool ();
+  if (caseSensitiveSort_ != caseSensitiveSort)
+  {
+    caseSensitiveSort_ = caseSensitiveSort;
+    isChanged = true;
+    // keep old ranks consistent with old collator until new ones are ready
+    if (sortRanks_.isEmpty ())
+    {
+      collator_ = SortKeys::collator (caseSensitiveSort_);
+    }
+    else
+    {
+      startSort (sortColumn (), sortOrder ());
+    }
+  }
+
+  const auto isFuzzyFilter = settings.get (SettingsManager::FuzzyNameFilter).toBool ();
+  if (isFuzzyFilter_ != isFuzzyFilter)
+  {
+    isFuzzyFilter_ = isFuzzyFilter;
+    nameFilter_ = NameFilter (nameFilter_.pattern (), isFuzzyFilter_ ? NameFilter::Mode::Fuzzy
+                                                                     : NameFilter::Mode::Wildcard);
+    nameScores_.clear ();
+    isChanged = true;
+  }
+
+  if (isChanged)
+  {
+    invalidate ();
+    recount ();
+    emit contentsChanged ();
+  }
 }
 
 QVariant ProxyModel::headerData (int section, Qt::Orientation orientation, int role) const
@@ -362,40 +541,302 @@ QVariant ProxyModel::headerData (int section, Qt::Orientation orientation, int r
 bool ProxyModel::lessThan (const QModelIndex &left, const QModelIndex &right) const
 {
   // keep .. on top
-  const auto l = model_->fileInfo (left);
-  if (l.fileName () == constants::dotdot)
+  if (model_->isDotDot (left))
   {
     return sortOrder () == Qt::AscendingOrder;
   }
-  const auto r = model_->fileInfo (right);
-  if (r.fileName () == constants::dotdot)
+  if (model_->isDotDot (right))
   {
     return sortOrder () != Qt::AscendingOrder;
   }
 
+  // best fuzzy matches first
+  if (isFuzzyFilter_ && !nameFilter_.isEmpty ())
+  {
+    const auto leftScore = nameScore (left);
+    const auto rightScore = nameScore (right);
+    if (leftScore != rightScore)
+    {
+      return (sortOrder () == Qt::AscendingOrder) == (leftScore > rightScore);
+    }
+  }
+
   // keep folders on top
-  if (l.isDir () != r.isDir ())
+  const auto isLeftDir = model_->isDir (left);
+  if (isLeftDir != model_->isDir (right))
+  {
+    return (sortOrder () == Qt::AscendingOrder ? isLeftDir : !isLeftDir);
+  }
+
+
+  const auto column = sortColumn ();
+  if (!hasSortKeys (column))
   {
-    return (sortOrder () == Qt::AscendingOrder ? l.isDir () : !l.isDir ());
+    return QSortFilterProxyModel::lessThan (left, right);
   }
 
+  // listing order until background sort is done
+  if (isSortDeferred_)
+  {
+    return left.row () < right.row ();
+  }
 
-  switch (sortColumn ())
+  const auto leftRank = sortRank (left);
+  if (leftRank != -1)
   {
-    case FileSystemModel::Column::Name:
-      return QString::compare (l.fileName (), r.fileName (),
-                               caseSensitiveSort_ ? Qt::CaseSensitive : Qt::CaseInsensitive) < 0;
+    const auto rightRank = sortRank (right);
+    if (rightRank != -1)
+    {
+      return leftRank < rightRank;
+    }
+  }
 
+  // same order as SortKeys::rank
+  switch (column)
+  {
     case FileSystemModel::Column::Size:
-      return model_->size (left) < model_->size (right);
+      {
+        const auto leftSize = model_->size (left);
+        const auto rightSize = model_->size (right);
+        if (leftSize != rightSize)
+        {
+          return leftSize < rightSize;
+        }
+      }
+      break;
+
+    case FileSystemModel::Column::Date:
+      {
+        const auto leftDate = model_->lastModifiedMsecs (left);
+        const auto rightDate = model_->lastModifiedMsecs (right);
+        if (leftDate != rightDate)
+        {
+          return leftDate < rightDate;
+        }
+      }
+      break;
 
     case FileSystemModel::Column::Type:
-      return model_->type (left) < model_->type (right);
+      {
+        const auto result = collator_.compare (model_->type (left), model_->type (right));
+        if (result != 0)
+        {
+          return result < 0;
+        }
+      }
+      break;
+  }
 
-    case FileSystemModel::Column::Date:
-      return model_->lastModified (left) < model_->lastModified (right);
+  const auto leftName = model_->fileName (left);
+  const auto rightName = model_->fileName (right);
+  const auto result = collator_.compare (leftName, rightName);
+  return result != 0 ? result < 0 : leftName < rightName;
+}
+
+void ProxyModel::sort (int column, Qt::SortOrder order)
+{
+  if (!hasSortKeys (column) || model_->rowCount (rootItem_) < backgroundSortRows)
+  {
+    cancelSort ();
+    QSortFilterProxyModel::sort (column, order);
+    return;
+  }
+  startSort (column, order);
+}
+
+QCache<QString, QVector<ProxyModel::SortRank>> &ProxyModel::rankSnapshots ()
+{
+  static QCache<QString, QVector<SortRank>> snapshots (maxSnapshotRows);
+  return snapshots;
+}
+
+bool ProxyModel::restoreRanks (const QString &path)
+{
+  const auto column = sortColumn ();
+  if (!hasSortKeys (column))
+  {
+    return false;
+  }
+  const auto *snapshot = rankSnapshots ().object (snapshotKey (path, column, caseSensitiveSort_));
+  if (!snapshot)
+  {
+    return false;
+  }
+  sortRanks_ = *snapshot;
+  rankedColumn_ = column;
+  collator_ = SortKeys::collator (caseSensitiveSort_);
+  return true;
+}
+
+void ProxyModel::storeRanks ()
+{
+  if (sortRanks_.isEmpty () || watchedPath_.isEmpty ())
+  {
+    return;
+  }
+  const auto isCaseSensitive = collator_.caseSensitivity () == Qt::CaseSensitive;
+  rankSnapshots ().insert (snapshotKey (watchedPath_, rankedColumn_, isCaseSensitive),
+                           new QVector<SortRank>(sortRanks_), sortRanks_.size ());
+}
+
+int ProxyModel::sortRank (const QModelIndex &sourceIndex) const
+{
+  const auto row = sourceIndex.row ();
+  const auto column = sortColumn ();
+  if (column != rankedColumn_ || row >= sortRanks_.size ())
+  {
+    return -1;
+  }
+
+  // rows could be shifted or changed since ranking
+  const auto &cached = sortRanks_[row];
+  if (cached.name != model_->fileName (sourceIndex))
+  {
+    return -1;
+  }
+  if (column == FileSystemModel::Size && cached.value != model_->size (sourceIndex))
+  {
+    return -1;
+  }
+  if (column == FileSystemModel::Date &&
+      cached.value != model_->lastModifiedMsecs (sourceIndex))
+  {
+    return -1;
+  }
+  return cached.rank;
+}
+
+void ProxyModel::startSort (int column, Qt::SortOrder order)
+{
+  const auto isDeferred = isSortDeferred_;
+  cancelSort ();
+  isSortDeferred_ = isDeferred;
+
+  SortKeys keys;
+  keys.column = column;
+  keys.isCaseSensitive = caseSensitiveSort_;
+
+  const auto rows = model_->rowCount (rootItem_);
+  keys.names.reserve (rows);
+  keys.flags.reserve (rows);
+  for (auto row = 0; row < rows; ++row)
+  {
+    const auto index = model_->index (row, 0, rootItem_);
+    keys.names.append (model_->fileName (index));
+    quint8 flags = 0;
+    flags |= model_->isDir (index) ? SortKeys::IsDir : 0;
+    flags |= model_->isDotDot (index) ? SortKeys::IsDotDot : 0;
+    keys.flags.append (flags);
+
+    switch (column)
+    {
+      case FileSystemModel::Column::Size: keys.values.append (model_->size (index)); break;
+      case FileSystemModel::Column::Date: keys.values.append (model_->lastModifiedMsecs (index)); break;
+      case FileSystemModel::Column::Type: keys.types.append (model_->type (index)); break;
+    }
+  }
+
+  sortKeys_ = keys;
+  pendingSortColumn_ = column;
+  pendingSortOrder_ = order;
+
+  sortWatcher_ = new QFutureWatcher<QVector<int>>(this);
+  connect (sortWatcher_, &QFutureWatcher<QVector<int>>::finished,
+           this, &ProxyModel::applySort);
+  sortWatcher_->setFuture (QtConcurrent::run ([keys]() -> QVector<int> {
+                                                return keys.rank ();
+                                              }));
+}
+
+void ProxyModel::cancelSort ()
+{
+  if (sortWatcher_)
+  {
+    sortWatcher_->disconnect (this);
+    sortWatcher_->deleteLater ();
+    sortWatcher_ = nullptr;
+  }
+  sortKeys_ = SortKeys ();
+  isSortDeferred_ = false;
+}
+
+void ProxyModel::applySort ()
+{
+  ASSERT (sortWatcher_);
+  const auto ranks = sortWatcher_->result ();
+  sortWatcher_->deleteLater ();
+  sortWatcher_ = nullptr;
+
+  const auto hasValues = !sortKeys_.values.isEmpty ();
+  sortRanks_.resize (ranks.size ());
+  for (auto i = 0, end = ranks.size (); i < end; ++i)
+  {
+    auto &cached = sortRanks_[i];
+    cached.name = sortKeys_.names[i];
+    cached.value = hasValues ? sortKeys_.values[i] : 0;
+    cached.rank = ranks[i];
+  }
+  rankedColumn_ = sortKeys_.column;
+  collator_ = SortKeys::collator (sortKeys_.isCaseSensitive);
+  sortKeys_ = SortKeys ();
+  isSortDeferred_ = false;
+  storeRanks ();
+
+  // single layout change with ranks in place
+  if (sortColumn () == pendingSortColumn_ && sortOrder () == pendingSortOrder_)
+  {
+    invalidate ();
+  }
+  else
+  {
+    QSortFilterProxyModel::sort (pendingSortColumn_, pendingSortOrder_);
+  }
+}
+
+void ProxyModel::deferSort (const QModelIndex &parent, int first, int last)
+{
+  // streamed parts keep listing order until the whole directory is ranked
+  if (parent == rootItem_ && hasSortKeys (sortColumn ()) &&
+      (last - first + 1 >= backgroundSortRows || model_->isStreaming (rootItem_)))
+  {
+    isSortDeferred_ = true;
   }
-  return QSortFilterProxyModel::lessThan (left, right);
+}
+
+void ProxyModel::resumeSort (const QModelIndex &parent)
+{
+  if (isSortDeferred_ && parent == rootItem_ && !model_->isStreaming (rootItem_))
+  {
+    startSort (sortColumn (), sortOrder ());
+  }
+}
+
+void ProxyModel::resumeLoadedSort (const QString &path)
+{
+  // last part could hold all rows, so no insertion follows
+  if (isSortDeferred_ && !sortWatcher_ && path == watchedPath_)
+  {
+    startSort (sortColumn (), sortOrder ());
+  }
+}
+
+int ProxyModel::nameScore (const QModelIndex &sourceIndex) const
+{
+  const auto row = sourceIndex.row ();
+  if (row >= nameScores_.size ())
+  {
+    nameScores_.resize (std::max (row + 1, model_->rowCount (sourceIndex.parent ())));
+  }
+
+  // name check also catches renames and shifted rows
+  auto &cached = nameScores_[row];
+  const auto name = model_->fileName (sourceIndex);
+  if (cached.name != name)
+  {
+    cached.name = name;
+    cached.score = nameFilter_.score (name);
+  }
+  return cached.score;
 }
 
 void ProxyModel::detectContentsChange (const QModelIndex &parent)
@@ -406,4 +847,100 @@ void ProxyModel::detectContentsChange (const QModelIndex &parent)
   }
 }
 
+//! Size of shown file, countedDir for shown directory, notCounted otherwise.
+qint64 ProxyModel::countedValue (int sourceRow) const
+{
+  if (!filterAcceptsRow (sourceRow, rootItem_))
+  {
+    return notCounted;
+  }
+  const auto index = model_->index (sourceRow, 0, rootItem_);
+  if (model_->isDotDot (index))
+  {
+    return notCounted;
+  }
+  return model_->isDir (index) ? countedDir : model_->size (index);
+}
+
+void ProxyModel::account (Totals &totals, qint64 value, int sign)
+{
+  if (value == countedDir)
+  {
+    totals.dirs += sign;
+  }
+  else if (value != notCounted)
+  {
+    totals.files += sign;
+    totals.size += sign * value;
+  }
+}
+
+void ProxyModel::recount ()
+{
+  totals_ = Totals ();
+  countedValues_.clear ();
+  if (!rootItem_.isValid ())
+  {
+    return;
+  }
+  const auto rows = model_->rowCount (rootItem_);
+  countedValues_.reserve (rows);
+  for (auto row = 0; row < rows; ++row)
+  {
+    countedValues_.append (countedValue (row));
+    account (totals_, countedValues_.last (), 1);
+  }
+}
+
+void ProxyModel::countInserted (const QModelIndex &parent, int first, int last)
+{
+  if (parent != rootItem_ || first > countedValues_.size ())
+  {
+    return;
+  }
+  countedValues_.insert (first, last - first + 1, notCounted);
+  for (auto row = first; row <= last; ++row)
+  {
+    countedValues_[row] = countedValue (row);
+    account (totals_, countedValues_[row], 1);
+  }
+}
+
+void ProxyModel::countRemoved (const QModelIndex &parent, int first, int last)
+{
+  if (parent != rootItem_ || last >= countedValues_.size ())
+  {
+    return;
+  }
+  for (auto row = first; row <= last; ++row)
+  {
+    account (totals_, countedValues_[row], -1);
+  }
+  countedValues_.remove (first, last - first + 1);
+}
+
+void ProxyModel::countChanged (const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+  if (topLeft.parent () != rootItem_ || bottomRight.row () >= countedValues_.size ())
+  {
+    return;
+  }
+  auto isChanged = false;
+  for (auto row = topLeft.row (), end = bottomRight.row (); row <= end; ++row)
+  {
+    const auto value = countedValue (row);
+    if (value != countedValues_[row])
+    {
+      account (totals_, countedValues_[row], -1);
+      account (totals_, value, 1);
+      countedValues_[row] = value;
+      isChanged = true;
+    }
+  }
+  if (isChanged)
+  {
+    emit contentsChanged ();
+  }
+}
+
 #include "moc_proxymodel.cpp"
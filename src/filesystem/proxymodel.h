@@ -1,11 +1,18 @@
 #pragma once
 
+#include "namefilter.h"
+#include "sortkeys.h"
+#include "thumbnailloader.h"
+
 #include <QSortFilterProxyModel>
 #include <QFileInfo>
-#include <QColor>
+#include <QCollator>
 
 class FileSystemModel;
 
+template <typename T> class QFutureWatcher;
+template <class Key, class T> class QCache;
+
 class ProxyModel : public QSortFilterProxyModel
 {
 Q_OBJECT
@@ -27,31 +34,43 @@ public:
 
   void setNameFilter (const QString &name);
 
-  void setRootIndex (const QModelIndex &index);
+  //! Only the given directory and the way to it are mapped.
+  void setSourceRoot (const QModelIndex &sourceIndex);
   QModelIndex rootIndex () const;
 
   QVariant data (const QModelIndex &index, int role) const override;
   QVariant headerData (int section, Qt::Orientation orientation,
                        int role = Qt::DisplayRole) const override;
 
+  void sort (int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
   bool showThumbnails () const;
   void setShowThumbnails (bool isOn);
 
 
-  bool isDir (int row) const;
-  qint64 fileSize (int row) const;
-  QString fileName (int row) const;
-  int count () const;
+  struct Totals
+  {
+    int files;
+    int dirs;
+    qint64 size; // of files
+  };
+
+  //! Of shown entries of the current directory except "..". Kept up to date.
+  Totals totals () const;
+  //! Of given rows of the current directory except "..". Uses cached sizes.
+  Totals totals (const QItemSelection &selection) const;
+  QString filePath (const QModelIndex &index) const;
   bool isDotDot (const QModelIndex &index) const;
 
   QFileInfo currentPath () const;
 
   void setCurrentIndex (const QModelIndex &index);
+  //! Thumbnails of these rows are loaded first, others are not loaded.
+  void setVisibleRows (const QModelIndex &first, const QModelIndex &last);
 
 signals:
   void contentsChanged ();
   void currentChanged (const QModelIndex &index);
-  void iconRequested (const QString &fileName);
 
 public slots:
   void updateSettings ();
@@ -61,8 +80,40 @@ protected:
   bool lessThan (const QModelIndex &left, const QModelIndex &right) const override;
 
 private:
+  struct NameScore
+  {
+    QString name;
+    int score{-1};
+  };
+
+  struct SortRank
+  {
+    QString name;
+    qint64 value;
+    int rank;
+  };
+
+  //! Orders of recently sorted large directories, shared by all views.
+  static QCache<QString, QVector<SortRank>> &rankSnapshots ();
+  bool restoreRanks (const QString &path);
+  void storeRanks ();
+
+  int nameScore (const QModelIndex &sourceIndex) const;
+  int sortRank (const QModelIndex &sourceIndex) const;
+  void startSort (int column, Qt::SortOrder order);
+  void cancelSort ();
+  void applySort ();
+  void deferSort (const QModelIndex &parent, int first, int last);
+  void resumeSort (const QModelIndex &parent);
+  void resumeLoadedSort (const QString &path);
   void detectContentsChange (const QModelIndex &parent);
-  void updateIcon (const QString &fileName, const QPixmap &pixmap);
+  qint64 countedValue (int sourceRow) const;
+  static void account (Totals &totals, qint64 value, int sign);
+  void recount ();
+  void countInserted (const QModelIndex &parent, int first, int last);
+  void countRemoved (const QModelIndex &parent, int first, int last);
+  void countChanged (const QModelIndex &topLeft, const QModelIndex &bottomRight);
+  void updateIcons (const QStringList &paths);
   void updateStyle ();
 
   FileSystemModel *model_;
@@ -72,13 +123,22 @@ private:
   bool showHidden_;
   bool showThumbnails_;
   bool caseSensitiveSort_;
-  QString nameFilter_;
+  bool isFuzzyFilter_;
+  NameFilter nameFilter_;
+  mutable QVector<NameScore> nameScores_; // by source row, reused while filter narrows
+  QCollator collator_;
+  QVector<SortRank> sortRanks_; // by source row, from the last background sort
+  int rankedColumn_;
+  SortKeys sortKeys_;
+  QFutureWatcher<QVector<int>> *sortWatcher_;
+  int pendingSortColumn_;
+  Qt::SortOrder pendingSortOrder_;
+  bool isSortDeferred_;
   QPersistentModelIndex rootItem_;
+  QString watchedPath_;
+  QVector<qint64> countedValues_; // by source row of root, see countedValue ()
+  Totals totals_;
   QPersistentModelIndex currentItem_;
-  QThread *iconReaderThread_;
-  QColor currentColor_;
-  QColor dirColor_;
-  QColor inaccessibleDirColor_;
-  QColor executableColor_;
-  QColor unreadableFileColor_;
+  QVariant currentColor_;
+  QVector<QVariant> colors_; // by DirEntries::ColorClass
 };
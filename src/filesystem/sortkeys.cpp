@@ -0,0 +1,130 @@
+#include "sortkeys.h"
+#include "filesystemmodel.h"
+
+#include <QCollator>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+const int minChunkSize = 4096;
+
+struct Chunk
+{
+  int begin;
+  int end;
+  std::vector<QCollatorSortKey> names;
+  std::vector<QCollatorSortKey> types;
+};
+}
+
+
+QCollator SortKeys::collator (bool isCaseSensitive)
+{
+  QCollator result;
+  result.setNumericMode (true);
+  result.setCaseSensitivity (isCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+  return result;
+}
+
+QVector<int> SortKeys::rank () const
+{
+  const auto count = names.size ();
+  if (count == 0)
+  {
+    return {};
+  }
+
+  const auto chunkCount = std::max (1, std::min (QThread::idealThreadCount (),
+                                                 count / minChunkSize));
+  const auto chunkSize = (count + chunkCount - 1) / chunkCount;
+  std::vector<Chunk> chunks;
+  for (auto begin = 0; begin < count; begin += chunkSize)
+  {
+    chunks.push_back ({begin, std::min (begin + chunkSize, count), {}, {}});
+  }
+
+  QVector<int> order (count);
+  std::iota (order.begin (), order.end (), 0);
+  auto *sorted = order.data ();
+
+  const auto isType = (column == FileSystemModel::Type);
+  const auto hasValues = (column == FileSystemModel::Size || column == FileSystemModel::Date);
+  const auto less = [&](int left, int right) -> bool {
+                      const auto &leftChunk = chunks[left / chunkSize];
+                      const auto &rightChunk = chunks[right / chunkSize];
+                      const auto leftOffset = left - leftChunk.begin;
+                      const auto rightOffset = right - rightChunk.begin;
+
+                      const auto leftFlags = flags[left];
+                      const auto rightFlags = flags[right];
+                      if ((leftFlags & IsDotDot) != (rightFlags & IsDotDot))
+                      {
+                        return (leftFlags & IsDotDot) != 0;
+                      }
+                      if ((leftFlags & IsDir) != (rightFlags & IsDir))
+                      {
+                        return (leftFlags & IsDir) != 0;
+                      }
+                      if (hasValues && values[left] != values[right])
+                      {
+                        return values[left] < values[right];
+                      }
+                      if (isType)
+                      {
+                        const auto result = leftChunk.types[leftOffset].compare (
+                          rightChunk.types[rightOffset]);
+                        if (result != 0)
+                        {
+                          return result < 0;
+                        }
+                      }
+                      const auto result = leftChunk.names[leftOffset].compare (
+                        rightChunk.names[rightOffset]);
+                      if (result != 0)
+                      {
+                        return result < 0;
+                      }
+                      return names[left] < names[right];
+                    };
+
+  // collator is not thread safe so every chunk gets its own
+  QtConcurrent::blockingMap (chunks, [&](Chunk &chunk) {
+                               auto collator = SortKeys::collator (isCaseSensitive);
+                               chunk.names.reserve (chunk.end - chunk.begin);
+                               for (auto i = chunk.begin; i < chunk.end; ++i)
+                               {
+                                 chunk.names.push_back (collator.sortKey (names[i]));
+                                 if (isType)
+                                 {
+                                   chunk.types.push_back (collator.sortKey (types[i]));
+                                 }
+                               }
+                               std::sort (sorted + chunk.begin, sorted + chunk.end, less);
+                             });
+
+  for (auto width = chunkSize; width < count; width *= 2)
+  {
+    QVector<int> starts;
+    for (auto start = 0; start + width < count; start += 2 * width)
+    {
+      starts.append (start);
+    }
+    QtConcurrent::blockingMap (starts, [&](int start) {
+                                 std::inplace_merge (sorted + start, sorted + start + width,
+                                                     sorted + std::min (start + 2 * width, count),
+                                                     less);
+                               });
+  }
+
+  QVector<int> result (count);
+  for (auto i = 0; i < count; ++i)
+  {
+    result[sorted[i]] = i;
+  }
+  return result;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QVector>
+#include <QString>
+
+class QCollator;
+
+// Sort keys of one directory level, gathered once on the GUI thread so rows
+// can be ordered in background without touching the model.
+struct SortKeys
+{
+  enum Flag : quint8
+  {
+    IsDir = 0x01, IsDotDot = 0x02
+  };
+
+  static QCollator collator (bool isCaseSensitive);
+
+  //! Position of every row in ascending order. Sorts chunks in parallel.
+  QVector<int> rank () const;
+
+  int column{0};
+  bool isCaseSensitive{false};
+  QVector<QString> names;
+  QVector<QString> types; // only for type column
+  QVector<qint64> values; // size or modification time
+  QVector<quint8> flags;
+};
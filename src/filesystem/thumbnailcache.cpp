@@ -0,0 +1,117 @@
+#include "thumbnailcache.h"
+#include "debug.h"
+
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QImageReader>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QUrl>
+
+namespace
+{
+const QString uriKey = "Thumb::URI";
+const QString mtimeKey = "Thumb::MTime";
+const QString normalDir = "normal";
+const QString largeDir = "large";
+
+QString cacheRoot ()
+{
+  static const auto root = QStandardPaths::writableLocation (QStandardPaths::GenericCacheLocation) +
+                           QLatin1String ("/thumbnails/");
+  return root;
+}
+
+QByteArray uri (const QString &path)
+{
+  return QUrl::fromLocalFile (QFileInfo (path).absoluteFilePath ()).toEncoded ();
+}
+
+QString fileName (const QByteArray &uri)
+{
+  return QString::fromLatin1 (QCryptographicHash::hash (uri, QCryptographicHash::Md5).toHex ()) +
+         QLatin1String (".png");
+}
+
+QString modificationTime (const QString &path)
+{
+  const QFileInfo info (path);
+  return info.exists () ? QString::number (info.lastModified ().toMSecsSinceEpoch () / 1000)
+                        : QString ();
+}
+}
+
+
+QImage ThumbnailCache::load (const QString &path)
+{
+  const auto mtime = modificationTime (path);
+  if (mtime.isEmpty ())
+  {
+    return {};
+  }
+
+  const auto name = fileName (uri (path));
+  for (const auto &dir: {normalDir, largeDir})
+  {
+    QImageReader reader (cacheRoot () + dir + QLatin1Char ('/') + name);
+    if (!reader.canRead () || reader.text (mtimeKey) != mtime)
+    {
+      continue;
+    }
+    const auto image = reader.read ();
+    if (!image.isNull ())
+    {
+      return image;
+    }
+  }
+  return {};
+}
+
+void ThumbnailCache::store (const QString &path, const QImage &thumbnail)
+{
+  const auto mtime = modificationTime (path);
+  if (mtime.isEmpty () || thumbnail.isNull ())
+  {
+    return;
+  }
+
+  // thumbnails of thumbnails are not stored
+  const auto root = cacheRoot ();
+  if (QFileInfo (path).absoluteFilePath ().startsWith (root))
+  {
+    return;
+  }
+
+  const auto dir = root + normalDir;
+  if (!QDir (dir).exists ())
+  {
+    if (!QDir ().mkpath (dir))
+    {
+      LWARNING () << "Failed to create thumbnail dir" << LARG (dir);
+      return;
+    }
+    const auto permissions = QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner;
+    QFile::setPermissions (root, permissions);
+    QFile::setPermissions (dir, permissions);
+  }
+
+  const auto fileUri = uri (path);
+  auto image = thumbnail;
+  image.setText (uriKey, QString::fromLatin1 (fileUri));
+  image.setText (mtimeKey, mtime);
+
+  // written to temporary file and renamed so readers never get partial one
+  QSaveFile file (dir + QLatin1Char ('/') + fileName (fileUri));
+  if (!file.open (QFile::WriteOnly) || !image.save (&file, "PNG") ||
+      !file.setPermissions (QFile::ReadOwner | QFile::WriteOwner) || !file.commit ())
+  {
+    LWARNING () << "Failed to store thumbnail" << LARG (path) << LARG (file.errorString ());
+  }
+}
+
+int ThumbnailCache::normalSize ()
+{
+  return 128;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QImage>
+
+// Persistent thumbnails shared with other desktop tools. Follows the
+// freedesktop.org thumbnail managing standard.
+class ThumbnailCache
+{
+public:
+  //! Stored thumbnail if it is up to date with the file, null otherwise.
+  static QImage load (const QString &path);
+  static void store (const QString &path, const QImage &thumbnail);
+  //! Largest side of thumbnails stored in the normal size directory.
+  static int normalSize ();
+};
@@ -0,0 +1,170 @@
+#include "thumbnaildecoder.h"
+#include "debug.h"
+
+#include <QImageReader>
+#include <QFile>
+#include <QSet>
+
+#include <algorithm>
+
+namespace
+{
+// jpeg handler switches to fast integer DCT without fancy upsampling below 50
+const int fastQuality = 25;
+
+quint16 readUInt16 (const uchar *data, bool isBigEndian)
+{
+  return isBigEndian ? quint16 ((data[0] << 8) | data[1])
+                     : quint16 ((data[1] << 8) | data[0]);
+}
+
+quint32 readUInt32 (const uchar *data, bool isBigEndian)
+{
+  return isBigEndian
+         ? (quint32 (data[0]) << 24) | (quint32 (data[1]) << 16) | (quint32 (data[2]) << 8) | data[3]
+         : (quint32 (data[3]) << 24) | (quint32 (data[2]) << 16) | (quint32 (data[1]) << 8) | data[0];
+}
+
+//! Thumbnail of the second IFD of TIFF structure inside EXIF segment.
+QByteArray tiffThumbnail (const QByteArray &tiff)
+{
+  const auto *data = reinterpret_cast<const uchar *>(tiff.constData ());
+  const auto size = quint32 (tiff.size ());
+  if (size < 8 || (tiff.left (2) != "II" && tiff.left (2) != "MM"))
+  {
+    return {};
+  }
+  const auto isBigEndian = tiff.at (0) == 'M';
+
+  const auto entriesEnd = [&](quint32 ifd) -> quint32 {
+                            if (ifd >= size || size - ifd < 2)
+                            {
+                              return 0;
+                            }
+                            const auto end = ifd + 2 + 12 * quint32 (readUInt16 (data + ifd, isBigEndian));
+                            return end + 4 <= size ? end : 0;
+                          };
+
+  const auto firstIfd = readUInt32 (data + 4, isBigEndian);
+  const auto firstEnd = entriesEnd (firstIfd);
+  if (firstEnd == 0)
+  {
+    return {};
+  }
+  const auto secondIfd = readUInt32 (data + firstEnd, isBigEndian);
+  const auto secondEnd = entriesEnd (secondIfd);
+  if (secondIfd == 0 || secondEnd == 0)
+  {
+    return {};
+  }
+
+  quint32 offset = 0;
+  quint32 length = 0;
+  for (auto entry = secondIfd + 2; entry < secondEnd; entry += 12)
+  {
+    const auto tag = readUInt16 (data + entry, isBigEndian);
+    const auto value = readUInt32 (data + entry + 8, isBigEndian);
+    if (tag == 0x0201) // JPEGInterchangeFormat
+    {
+      offset = value;
+    }
+    else if (tag == 0x0202) // JPEGInterchangeFormatLength
+    {
+      length = value;
+    }
+  }
+  if (offset == 0 || length == 0 || offset >= size || length > size - offset)
+  {
+    return {};
+  }
+  return tiff.mid (int (offset), int (length));
+}
+}
+
+
+bool ThumbnailDecoder::isSupported (const QString &suffix)
+{
+  static const auto formats = [] {
+                                QSet<QString> result;
+                                for (const auto &i: QImageReader::supportedImageFormats ())
+                                {
+                                  result.insert (QString::fromLatin1 (i).toLower ());
+                                }
+                                return result;
+                              } ();
+  return formats.contains (suffix.toLower ());
+}
+
+QImage ThumbnailDecoder::decode (const QString &path, int size)
+{
+  QFile file (path);
+  if (!file.open (QFile::ReadOnly))
+  {
+    LWARNING () << "Icon read error" << LARG (path) << LARG (file.errorString ());
+    return {};
+  }
+
+  const auto embedded = exifThumbnail (file);
+  if (!embedded.isEmpty ())
+  {
+    const auto image = QImage::fromData (embedded, "JPEG");
+    if (std::max (image.width (), image.height ()) >= size)
+    {
+      return image.scaled (size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+  }
+
+  file.seek (0);
+  QImageReader reader (&file);
+  auto scaled = reader.size ();
+  if (scaled.width () > size || scaled.height () > size)
+  {
+    // jpeg handler decodes directly at reduced resolution
+    scaled.scale (size, size, Qt::KeepAspectRatio);
+    reader.setScaledSize (scaled);
+  }
+  reader.setQuality (fastQuality);
+  const auto image = reader.read ();
+  if (image.isNull ())
+  {
+    LWARNING () << "Icon read error" << LARG (path) << LARG (reader.errorString ());
+  }
+  return image;
+}
+
+QByteArray ThumbnailDecoder::exifThumbnail (QIODevice &device)
+{
+  if (device.read (2) != "\xff\xd8")
+  {
+    return {};
+  }
+
+  // EXIF goes right after SOI, possibly preceded by JFIF
+  forever
+  {
+    const auto header = device.read (4);
+    if (header.size () < 4 || uchar (header.at (0)) != 0xff)
+    {
+      return {};
+    }
+    const auto marker = uchar (header.at (1));
+    const auto length = (uchar (header.at (2)) << 8) | uchar (header.at (3));
+    if (length < 2)
+    {
+      return {};
+    }
+    if (marker == 0xe1)
+    {
+      const auto segment = device.read (length - 2);
+      if (segment.startsWith (QByteArray ("Exif\0\0", 6)))
+      {
+        return tiffThumbnail (segment.mid (6));
+      }
+      continue;
+    }
+    if (marker < 0xe0 || marker > 0xef || !device.seek (device.pos () + length - 2))
+    {
+      return {}; // image data starts, no more application segments
+    }
+  }
+}
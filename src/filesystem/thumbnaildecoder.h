@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QImage>
+
+class QIODevice;
+
+// Decodes images at thumbnail size taking the cheapest way available.
+class ThumbnailDecoder
+{
+public:
+  static bool isSupported (const QString &suffix);
+  //! Image with the largest side at most (and preferably exactly) size.
+  static QImage decode (const QString &path, int size);
+  //! JPEG stream embedded into EXIF data of JPEG file. Empty if none.
+  static QByteArray exifThumbnail (QIODevice &device);
+};
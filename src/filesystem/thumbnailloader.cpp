@@ -0,0 +1,244 @@
+#include "thumbnailloader.h"
+#include "thumbnailcache.h"
+#include "thumbnaildecoder.h"
+#include "constants.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QTimer>
+#include <QImage>
+#include <QPixmap>
+#include <QPixmapCache>
+#include <QFileInfo>
+#include <QDateTime>
+
+struct ThumbnailLoaderState
+{
+  struct Decoded
+  {
+    QString path;
+    QImage image;
+    qint64 modified; // of failed file, it is decoded again once they differ
+    qint64 size;
+  };
+
+  QMutex mutex;
+  ThumbnailLoader *loader;
+  QStringList queue; // most wanted first
+  QVector<Decoded> decoded;
+  int workerCount;
+};
+
+namespace
+{
+const int deliveryDelayMs = 50;
+
+ThumbnailLoader *instance_ = nullptr;
+
+class DecodeTask : public QRunnable
+{
+public:
+  explicit DecodeTask (const QSharedPointer<ThumbnailLoaderState> &state) :
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  QSharedPointer<ThumbnailLoaderState> state_;
+};
+
+QImage decode (const QString &path)
+{
+  auto thumbnail = ThumbnailCache::load (path);
+  if (thumbnail.isNull ())
+  {
+    thumbnail = ThumbnailDecoder::decode (path, ThumbnailCache::normalSize ());
+    if (thumbnail.isNull ())
+    {
+      return {};
+    }
+    ThumbnailCache::store (path, thumbnail);
+  }
+  return thumbnail.scaled (constants::iconSize, constants::iconSize, Qt::KeepAspectRatio,
+                           Qt::SmoothTransformation);
+}
+}
+
+
+ThumbnailLoader &ThumbnailLoader::instance ()
+{
+  if (!instance_)
+  {
+    instance_ = new ThumbnailLoader;
+  }
+  return *instance_;
+}
+
+ThumbnailLoader::ThumbnailLoader (QObject *parent) :
+  QObject (parent),
+  state_ (new ThumbnailLoaderState),
+  pool_ (new QThreadPool), // not owned: decoders may hang on dead mounts
+  deliveryTimer_ (new QTimer (this)),
+  requested_ (),
+  failed_ ()
+{
+  state_->loader = this;
+  state_->workerCount = 0;
+
+  deliveryTimer_->setSingleShot (true);
+  deliveryTimer_->setInterval (deliveryDelayMs);
+  connect (deliveryTimer_, &QTimer::timeout,
+           this, &ThumbnailLoader::deliver);
+}
+
+ThumbnailLoader::~ThumbnailLoader ()
+{
+  {
+    QMutexLocker locker (&state_->mutex);
+    state_->loader = nullptr;
+    state_->queue.clear ();
+  }
+}
+
+void ThumbnailLoader::request (const QObject *client, const QString &path, qint64 modified,
+                               qint64 size)
+{
+  const auto failed = failed_.find (path);
+  if (failed != failed_.end ())
+  {
+    if (failed.value () == qMakePair (modified, size))
+    {
+      return;
+    }
+    failed_.erase (failed);
+  }
+  auto &clients = requested_[path];
+  const auto isQueued = !clients.isEmpty ();
+  clients.insert (client);
+  if (isQueued)
+  {
+    return;
+  }
+
+  QMutexLocker locker (&state_->mutex);
+  state_->queue.append (path);
+  if (state_->workerCount < pool_->maxThreadCount ())
+  {
+    ++state_->workerCount;
+    pool_->start (new DecodeTask (state_));
+  }
+}
+
+void ThumbnailLoader::prioritize (const QObject *client, const QStringList &paths)
+{
+  QMutexLocker locker (&state_->mutex);
+  auto &queue = state_->queue;
+  if (queue.isEmpty ())
+  {
+    return;
+  }
+
+  const auto wanted = paths.toSet ();
+  QStringList prioritized;
+  QStringList rest;
+  QSet<QString> queued;
+  for (const auto &i: queue)
+  {
+    if (wanted.contains (i))
+    {
+      queued.insert (i);
+      continue;
+    }
+    auto &clients = requested_[i];
+    clients.remove (client);
+    if (clients.isEmpty ())
+    {
+      requested_.remove (i);
+      continue;
+    }
+    rest.append (i);
+  }
+  for (const auto &i: paths)
+  {
+    if (queued.remove (i))
+    {
+      prioritized.append (i);
+    }
+  }
+  queue = prioritized + rest;
+}
+
+void ThumbnailLoader::scheduleDelivery ()
+{
+  if (!deliveryTimer_->isActive ())
+  {
+    deliveryTimer_->start ();
+  }
+}
+
+void ThumbnailLoader::deliver ()
+{
+  QVector<ThumbnailLoaderState::Decoded> decoded;
+  {
+    QMutexLocker locker (&state_->mutex);
+    decoded.swap (state_->decoded);
+  }
+
+  // converted once for all views
+  QStringList paths;
+  paths.reserve (decoded.size ());
+  for (const auto &i: decoded)
+  {
+    requested_.remove (i.path);
+    if (i.image.isNull ())
+    {
+      failed_.insert (i.path, qMakePair (i.modified, i.size));
+    }
+    else
+    {
+      QPixmapCache::insert (i.path, QPixmap::fromImage (i.image));
+      paths.append (i.path);
+    }
+  }
+  if (!paths.isEmpty ())
+  {
+    emit loaded (paths);
+  }
+}
+
+void DecodeTask::run ()
+{
+  forever
+  {
+    QString path;
+    {
+      QMutexLocker locker (&state_->mutex);
+      if (state_->queue.isEmpty () || !state_->loader)
+      {
+        --state_->workerCount;
+        return;
+      }
+      path = state_->queue.takeFirst ();
+    }
+
+    ThumbnailLoaderState::Decoded decoded {path, decode (path), 0, 0};
+    if (decoded.image.isNull ())
+    {
+      const QFileInfo info (path);
+      decoded.modified = info.lastModified ().toMSecsSinceEpoch ();
+      decoded.size = info.size ();
+    }
+
+    QMutexLocker locker (&state_->mutex);
+    state_->decoded.append (decoded);
+    if (state_->decoded.size () == 1 && state_->loader)
+    {
+      QMetaObject::invokeMethod (state_->loader, "scheduleDelivery", Qt::QueuedConnection);
+    }
+  }
+}
+
+#include "moc_thumbnailloader.cpp"
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+
+class QThreadPool;
+class QTimer;
+struct ThumbnailLoaderState;
+
+// Decodes thumbnails on a pool of threads shared by the whole process. Every
+// file is queued once whatever number of views request it, files shown in
+// viewports go first and the ones scrolled away from all of them are dropped.
+class ThumbnailLoader : public QObject
+{
+Q_OBJECT
+public:
+  //! Created on first use, never deleted.
+  static ThumbnailLoader &instance ();
+
+  //! Client only tells requests apart and is never dereferenced. File that
+  //! failed to decode is requested again once its modification time or size
+  //! differ.
+  void request (const QObject *client, const QString &path, qint64 modified, qint64 size);
+  //! Drops files queued by client only that are not in paths, puts queued ones
+  //! of paths first in their order. Empty paths forget the client.
+  void prioritize (const QObject *client, const QStringList &paths);
+
+signals:
+  //! Thumbnails of paths are put to QPixmapCache with paths as keys.
+  void loaded (const QStringList &paths);
+
+private slots:
+  void scheduleDelivery ();
+
+private:
+  explicit ThumbnailLoader (QObject *parent = nullptr);
+  ~ThumbnailLoader ();
+
+  void deliver ();
+
+  QSharedPointer<ThumbnailLoaderState> state_;
+  QThreadPool *pool_;
+  QTimer *deliveryTimer_;
+  QHash<QString, QSet<const QObject *> > requested_; // queued or being decoded
+  QHash<QString, QPair<qint64, qint64> > failed_; // path -> modified, size
+};
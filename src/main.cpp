@@ -5,6 +5,10 @@
 #include "settingsmanager.h"
 #include "constants.h"
 #include "styleoptionsproxy.h"
+#include "storagemanager.h"
+#include "pathindex.h"
+#include "frecencystore.h"
+#include "trigramindex.h"
 
 #include <QApplication>
 #include <QDir>
@@ -48,6 +52,10 @@ int main (int argc, char *argv[])
   OpenWith::init ();
   SettingsEditor::initOrphanSettings ();
   StyleOptionsProxy::init ();
+  StorageManager::init ();
+  PathIndex::init ();
+  FrecencyStore::init ();
+  TrigramIndex::init ();
 
   MainWindow window;
   return a.exec ();
@@ -19,6 +19,23 @@ mac{
   LIBS += -framework Carbon
 }
 
+# optional decompression of searched files
+unix{
+  CONFIG += link_pkgconfig
+  packagesExist(zlib){
+    PKGCONFIG += zlib
+    DEFINES += WITH_ZLIB
+  }
+  packagesExist(liblzma){
+    PKGCONFIG += liblzma
+    DEFINES += WITH_LZMA
+  }
+  packagesExist(libzstd){
+    PKGCONFIG += libzstd
+    DEFINES += WITH_ZSTD
+  }
+}
+
 TARGET = multidir
 TEMPLATE = app
 
@@ -68,13 +85,23 @@ SOURCES += \
     fileoperation/fileoperation.cpp \
     fileoperation/fileoperationdelegate.cpp \
     fileoperation/fileoperationmodel.cpp \
-    filesystem/backgroundreader.cpp \
+    filesystem/direntries.cpp \
+    filesystem/dirlister.cpp \
+    filesystem/dirnametrie.cpp \
+    filesystem/dirsizes.cpp \
+    filesystem/dirwatcher.cpp \
     filesystem/filedelegate.cpp \
     filesystem/filepermissiondelegate.cpp \
     filesystem/filepermissions.cpp \
     filesystem/filesystemcompleter.cpp \
     filesystem/filesystemmodel.cpp \
+    filesystem/filetypes.cpp \
+    filesystem/namefilter.cpp \
     filesystem/proxymodel.cpp \
+    filesystem/sortkeys.cpp \
+    filesystem/thumbnailcache.cpp \
+    filesystem/thumbnaildecoder.cpp \
+    filesystem/thumbnailloader.cpp \
     groupview/groupsmenu.cpp \
     groupview/groupsview.cpp \
     groupview/groupwidget.cpp \
@@ -84,6 +111,7 @@ SOURCES += \
     shellcommand/shellcommandwidget.cpp \
     utility/copypaste.cpp \
     utility/debug.cpp \
+    utility/frecencystore.cpp \
     utility/globalaction.cpp \
     utility/notifier.cpp \
     utility/openwith.cpp \
@@ -102,9 +130,14 @@ SOURCES += \
     widgets/transferdialog.cpp \
     main.cpp \
     utils.cpp \
+    search/decompressingdevice.cpp \
+    search/ignorerules.cpp \
+    search/pathindex.cpp \
+    search/quickjumpdialog.cpp \
     search/searchwidget.cpp \
     search/searcher.cpp \
-    search/searchresultsmodel.cpp
+    search/searchresultsmodel.cpp \
+    search/trigramindex.cpp
 
 HEADERS  += \
     dirview/dirstatuswidget.h \
@@ -117,13 +150,23 @@ HEADERS  += \
     fileoperation/fileoperation.h \
     fileoperation/fileoperationdelegate.h \
     fileoperation/fileoperationmodel.h \
-    filesystem/backgroundreader.h \
+    filesystem/direntries.h \
+    filesystem/dirlister.h \
+    filesystem/dirnametrie.h \
+    filesystem/dirsizes.h \
+    filesystem/dirwatcher.h \
     filesystem/filedelegate.h \
     filesystem/filepermissiondelegate.h \
     filesystem/filepermissions.h \
     filesystem/filesystemcompleter.h \
     filesystem/filesystemmodel.h \
+    filesystem/filetypes.h \
+    filesystem/namefilter.h \
     filesystem/proxymodel.h \
+    filesystem/sortkeys.h \
+    filesystem/thumbnailcache.h \
+    filesystem/thumbnaildecoder.h \
+    filesystem/thumbnailloader.h \
     groupview/groupsmenu.h \
     groupview/groupsview.h \
     groupview/groupwidget.h \
@@ -133,6 +176,7 @@ HEADERS  += \
     shellcommand/shellcommandwidget.h \
     utility/copypaste.h \
     utility/debug.h \
+    utility/frecencystore.h \
     utility/globalaction.h \
     utility/notifier.h \
     utility/openwith.h \
@@ -152,9 +196,14 @@ HEADERS  += \
     backport.h \
     constants.h \
     utils.h \
+    search/decompressingdevice.h \
+    search/ignorerules.h \
+    search/pathindex.h \
+    search/quickjumpdialog.h \
     search/searchwidget.h \
     search/searcher.h \
-    search/searchresultsmodel.h
+    search/searchresultsmodel.h \
+    search/trigramindex.h
 
 RESOURCES += \
     $$PWD/../resources.qrc
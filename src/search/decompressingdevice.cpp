@@ -0,0 +1,348 @@
+#include "decompressingdevice.h"
+#include "debug.h"
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WITH_LZMA
+#include <lzma.h>
+#endif
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cstring>
+
+namespace
+{
+const int inputBlockSize = 64 * 1024;
+const char gzipMagic[] = {'\x1f', '\x8b'};
+const char xzMagic[] = {'\xfd', '7', 'z', 'X', 'Z', '\0'};
+const char zstdMagic[] = {'\x28', '\xb5', '\x2f', '\xfd'};
+
+template <size_t size>
+bool startsWith (const QByteArray &data, const char (&magic)[size])
+{
+  return data.size () >= int (size) && std::memcmp (data.constData (), magic, size) == 0;
+}
+}
+
+
+class DecompressingDevice::Decoder
+{
+public:
+  enum class Result
+  {
+    Ok, End, Error
+  };
+
+  // Decoders advance pointers and decrease sizes by consumed and written bytes.
+  struct Buffers
+  {
+    const char *input;
+    size_t inputSize;
+    char *output;
+    size_t outputSize;
+    bool isLastInput;
+  };
+
+  virtual ~Decoder () = default;
+
+  virtual Result decode (Buffers &buffers) = 0;
+  //! Prepares for next concatenated stream.
+  virtual void reset () = 0;
+};
+
+
+namespace
+{
+using Decoder = DecompressingDevice::Decoder;
+
+#ifdef WITH_ZLIB
+class GzipDecoder : public Decoder
+{
+public:
+  GzipDecoder () :
+    stream_ ()
+  {
+    inflateInit2 (&stream_, 16 + MAX_WBITS); // gzip header only
+  }
+
+  ~GzipDecoder () override
+  {
+    inflateEnd (&stream_);
+  }
+
+  Result decode (Buffers &buffers) override
+  {
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(buffers.input));
+    stream_.avail_in = uInt (buffers.inputSize);
+    stream_.next_out = reinterpret_cast<Bytef *>(buffers.output);
+    stream_.avail_out = uInt (buffers.outputSize);
+
+    const auto result = inflate (&stream_, Z_NO_FLUSH);
+
+    buffers.input = reinterpret_cast<const char *>(stream_.next_in);
+    buffers.inputSize = stream_.avail_in;
+    buffers.output = reinterpret_cast<char *>(stream_.next_out);
+    buffers.outputSize = stream_.avail_out;
+    if (result == Z_STREAM_END)
+    {
+      return Result::End;
+    }
+    return (result == Z_OK || result == Z_BUF_ERROR) ? Result::Ok : Result::Error;
+  }
+
+  void reset () override
+  {
+    inflateReset (&stream_);
+  }
+
+private:
+  z_stream stream_;
+};
+#endif
+
+
+#ifdef WITH_LZMA
+class XzDecoder : public Decoder
+{
+public:
+  XzDecoder () :
+    stream_ ()
+  {
+    init ();
+  }
+
+  ~XzDecoder () override
+  {
+    lzma_end (&stream_);
+  }
+
+  Result decode (Buffers &buffers) override
+  {
+    stream_.next_in = reinterpret_cast<const uint8_t *>(buffers.input);
+    stream_.avail_in = buffers.inputSize;
+    stream_.next_out = reinterpret_cast<uint8_t *>(buffers.output);
+    stream_.avail_out = buffers.outputSize;
+
+    const auto result = lzma_code (&stream_, buffers.isLastInput ? LZMA_FINISH : LZMA_RUN);
+
+    buffers.input = reinterpret_cast<const char *>(stream_.next_in);
+    buffers.inputSize = stream_.avail_in;
+    buffers.output = reinterpret_cast<char *>(stream_.next_out);
+    buffers.outputSize = stream_.avail_out;
+    if (result == LZMA_STREAM_END)
+    {
+      return Result::End;
+    }
+    return (result == LZMA_OK || result == LZMA_BUF_ERROR) ? Result::Ok : Result::Error;
+  }
+
+  void reset () override
+  {
+    lzma_end (&stream_);
+    init ();
+  }
+
+private:
+  void init ()
+  {
+    stream_ = lzma_stream ();
+    lzma_stream_decoder (&stream_, UINT64_MAX, LZMA_CONCATENATED);
+  }
+
+  lzma_stream stream_;
+};
+#endif
+
+
+#ifdef WITH_ZSTD
+class ZstdDecoder : public Decoder
+{
+public:
+  ZstdDecoder () :
+    stream_ (ZSTD_createDStream ())
+  {
+    ZSTD_initDStream (stream_);
+  }
+
+  ~ZstdDecoder () override
+  {
+    ZSTD_freeDStream (stream_);
+  }
+
+  Result decode (Buffers &buffers) override
+  {
+    ZSTD_inBuffer input {buffers.input, buffers.inputSize, 0};
+    ZSTD_outBuffer output {buffers.output, buffers.outputSize, 0};
+
+    const auto result = ZSTD_decompressStream (stream_, &output, &input);
+
+    buffers.input += input.pos;
+    buffers.inputSize -= input.pos;
+    buffers.output += output.pos;
+    buffers.outputSize -= output.pos;
+    if (ZSTD_isError (result))
+    {
+      return Result::Error;
+    }
+    return result == 0 ? Result::End : Result::Ok;
+  }
+
+  void reset () override
+  {
+    ZSTD_initDStream (stream_);
+  }
+
+private:
+  ZSTD_DStream *stream_;
+};
+#endif
+
+std::unique_ptr<Decoder> makeDecoder (DecompressingDevice::Format format)
+{
+  using Format = DecompressingDevice::Format;
+  switch (format)
+  {
+#ifdef WITH_ZLIB
+    case Format::Gzip: return std::unique_ptr<Decoder> (new GzipDecoder);
+#endif
+#ifdef WITH_LZMA
+    case Format::Xz: return std::unique_ptr<Decoder> (new XzDecoder);
+#endif
+#ifdef WITH_ZSTD
+    case Format::Zstd: return std::unique_ptr<Decoder> (new ZstdDecoder);
+#endif
+    default: return {};
+  }
+}
+}
+
+
+DecompressingDevice::Format DecompressingDevice::format (const QByteArray &header)
+{
+  if (startsWith (header, gzipMagic))
+  {
+    return Format::Gzip;
+  }
+  if (startsWith (header, xzMagic))
+  {
+    return Format::Xz;
+  }
+  if (startsWith (header, zstdMagic))
+  {
+    return Format::Zstd;
+  }
+  return Format::None;
+}
+
+bool DecompressingDevice::isSupported (Format format)
+{
+  switch (format)
+  {
+#ifdef WITH_ZLIB
+    case Format::Gzip: return true;
+#endif
+#ifdef WITH_LZMA
+    case Format::Xz: return true;
+#endif
+#ifdef WITH_ZSTD
+    case Format::Zstd: return true;
+#endif
+    default: return false;
+  }
+}
+
+DecompressingDevice::DecompressingDevice (QIODevice *source, Format format, QObject *parent) :
+  QIODevice (parent),
+  source_ (source),
+  format_ (format),
+  decoder_ (),
+  input_ (),
+  inputOffset_ (0),
+  isFinished_ (false)
+{
+}
+
+DecompressingDevice::~DecompressingDevice () = default;
+
+bool DecompressingDevice::open (OpenMode mode)
+{
+  if ((mode & WriteOnly) || !source_ || !source_->isReadable ())
+  {
+    return false;
+  }
+  decoder_ = makeDecoder (format_);
+  if (!decoder_)
+  {
+    LWARNING () << "Unsupported compression format" << int (format_);
+    return false;
+  }
+  input_.clear ();
+  inputOffset_ = 0;
+  isFinished_ = false;
+  return QIODevice::open (mode);
+}
+
+void DecompressingDevice::close ()
+{
+  decoder_.reset ();
+  input_.clear ();
+  QIODevice::close ();
+}
+
+bool DecompressingDevice::isSequential () const
+{
+  return true;
+}
+
+bool DecompressingDevice::atEnd () const
+{
+  return isFinished_ && QIODevice::bytesAvailable () == 0;
+}
+
+qint64 DecompressingDevice::readData (char *data, qint64 maxSize)
+{
+  Decoder::Buffers buffers {nullptr, 0, data, size_t (maxSize), false};
+  while (!isFinished_ && buffers.outputSize == size_t (maxSize))
+  {
+    if (inputOffset_ == input_.size ())
+    {
+      input_ = source_->read (inputBlockSize);
+      inputOffset_ = 0;
+    }
+    buffers.input = input_.constData () + inputOffset_;
+    buffers.inputSize = size_t (input_.size () - inputOffset_);
+    buffers.isLastInput = (source_->atEnd () || inputOffset_ == input_.size ());
+
+    const auto result = decoder_->decode (buffers);
+    const auto isStalled = (buffers.inputSize == size_t (input_.size () - inputOffset_) &&
+                            buffers.outputSize == size_t (maxSize));
+    inputOffset_ = input_.size () - int (buffers.inputSize);
+
+    if (result == Decoder::Result::End)
+    {
+      if (inputOffset_ < input_.size () || !source_->atEnd ())
+      {
+        decoder_->reset ();
+        continue;
+      }
+      isFinished_ = true;
+    }
+    else if (result == Decoder::Result::Error ||
+             (isStalled && (buffers.isLastInput || inputOffset_ < input_.size ())))
+    {
+      LWARNING_IF (result == Decoder::Result::Error) << "Failed to decompress data";
+      isFinished_ = true;
+    }
+  }
+
+  const auto written = qint64 (size_t (maxSize) - buffers.outputSize);
+  return (written == 0 && isFinished_) ? -1 : written;
+}
+
+qint64 DecompressingDevice::writeData (const char * /*data*/, qint64 /*maxSize*/)
+{
+  return -1;
+}
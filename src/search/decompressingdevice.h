@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QIODevice>
+
+#include <memory>
+
+// Read only sequential device with decompressed contents of source. Formats
+// are detected by magic bytes, ones without library at build time are not
+// supported. Concatenated streams are decoded one after another.
+class DecompressingDevice : public QIODevice
+{
+public:
+  enum class Format
+  {
+    None, Gzip, Xz, Zstd
+  };
+  static const int headerSize = 6;
+
+  //! Format of data that starts with header.
+  static Format format (const QByteArray &header);
+  static bool isSupported (Format format);
+
+  DecompressingDevice (QIODevice *source, Format format, QObject *parent = nullptr);
+  ~DecompressingDevice ();
+
+  bool open (OpenMode mode) override;
+  void close () override;
+  bool isSequential () const override;
+  bool atEnd () const override;
+
+  class Decoder;
+
+protected:
+  qint64 readData (char *data, qint64 maxSize) override;
+  qint64 writeData (const char *data, qint64 maxSize) override;
+
+private:
+  QIODevice *source_;
+  Format format_;
+  std::unique_ptr<Decoder> decoder_;
+  QByteArray input_;
+  int inputOffset_;
+  bool isFinished_;
+};
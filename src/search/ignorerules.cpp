@@ -0,0 +1,232 @@
+#include "ignorerules.h"
+#include "debug.h"
+
+#include <QFile>
+#include <QDir>
+
+namespace
+{
+const qint64 maxIgnoreFileSize = 1024 * 1024;
+const char *const ignoreFiles[] = {".gitignore", ".ignore"};
+
+enum Match
+{
+  NoMatch = -1, Included, Ignored
+};
+
+//! Pattern of ignore file without leading slash to regular expression.
+QString toRegExp (const QString &glob)
+{
+  QString result;
+  for (auto i = 0, end = glob.size (); i < end; ++i)
+  {
+    const auto c = glob.at (i);
+    if (c == QLatin1Char ('*'))
+    {
+      const auto isWholePart = (i + 1 < end && glob.at (i + 1) == QLatin1Char ('*') &&
+                                (i == 0 || glob.at (i - 1) == QLatin1Char ('/')) &&
+                                (i + 2 == end || glob.at (i + 2) == QLatin1Char ('/')));
+      if (isWholePart)
+      {
+        // trailing "**" matches everything inside, "**/" zero or more dirs
+        result += (i + 2 == end ? QLatin1String (".*") : QLatin1String ("(?:.*/)?"));
+        i += 2;
+        continue;
+      }
+      result += QLatin1String ("[^/]*");
+    }
+    else if (c == QLatin1Char ('?'))
+    {
+      result += QLatin1String ("[^/]");
+    }
+    else if (c == QLatin1Char ('['))
+    {
+      const auto close = glob.indexOf (QLatin1Char (']'), i + 2);
+      if (close == -1)
+      {
+        result += QLatin1String ("\\[");
+        continue;
+      }
+      auto set = glob.mid (i + 1, close - i - 1);
+      if (set.startsWith (QLatin1Char ('!')))
+      {
+        set[0] = QLatin1Char ('^');
+      }
+      result += QLatin1Char ('[') + set + QLatin1Char (']');
+      i = close;
+    }
+    else if (c == QLatin1Char ('\\') && i + 1 < end)
+    {
+      result += QRegExp::escape (glob.at (++i));
+    }
+    else
+    {
+      result += QRegExp::escape (c);
+    }
+  }
+  return result;
+}
+
+QString withSlash (const QString &dir)
+{
+  return dir.endsWith (QLatin1Char ('/')) ? dir : dir + QLatin1Char ('/');
+}
+}
+
+
+IgnoreRules::IgnoreRules () :
+  excludes_ (),
+  rules_ (),
+  useIgnoreFiles_ (false)
+{
+}
+
+IgnoreRules::IgnoreRules (const QString &root, const QStringList &excludes,
+                          bool useIgnoreFiles) :
+  excludes_ (),
+  rules_ (),
+  useIgnoreFiles_ (useIgnoreFiles)
+{
+  for (const auto &i: excludes)
+  {
+    add (excludes_, root, i.trimmed ());
+  }
+
+  if (!useIgnoreFiles_)
+  {
+    return;
+  }
+
+  // rules of the nearest repository apply to its nested dirs, ignore files of
+  // root itself are read by forDir
+  QStringList parents;
+  QDir dir (root);
+  forever
+  {
+    if (dir.exists (QLatin1String (".git")))
+    {
+      addFile (dir.absolutePath (), QLatin1String (".git/info/exclude"));
+      for (const auto &i: parents)
+      {
+        for (const auto *name: ignoreFiles)
+        {
+          addFile (i, QLatin1String (name));
+        }
+      }
+      return;
+    }
+    if (!dir.cdUp ())
+    {
+      return;
+    }
+    parents.prepend (dir.absolutePath ());
+  }
+}
+
+IgnoreRules IgnoreRules::forDir (const QString &dir) const
+{
+  auto result = *this;
+  if (useIgnoreFiles_)
+  {
+    for (const auto *name: ignoreFiles)
+    {
+      result.addFile (dir, QLatin1String (name));
+    }
+  }
+  return result;
+}
+
+void IgnoreRules::add (const QString &dir, const QStringList &lines)
+{
+  for (const auto &i: lines)
+  {
+    add (rules_, dir, i);
+  }
+}
+
+bool IgnoreRules::isIgnored (const QString &path, bool isDir) const
+{
+  auto result = match (excludes_, path, isDir);
+  if (result == NoMatch)
+  {
+    result = match (rules_, path, isDir);
+  }
+  return result == Ignored;
+}
+
+void IgnoreRules::add (QVector<Rule> &rules, const QString &dir, const QString &line)
+{
+  auto text = line;
+  while (text.endsWith (QLatin1Char ('\r')) ||
+         (text.endsWith (QLatin1Char (' ')) && !text.endsWith (QLatin1String ("\\ "))))
+  {
+    text.chop (1);
+  }
+  if (text.isEmpty () || text.startsWith (QLatin1Char ('#')))
+  {
+    return;
+  }
+
+  Rule rule {withSlash (dir), {}, false, false, false};
+  if (text.startsWith (QLatin1Char ('!')))
+  {
+    rule.isNegated = true;
+    text.remove (0, 1);
+  }
+  else if (text.startsWith (QLatin1String ("\\!")) || text.startsWith (QLatin1String ("\\#")))
+  {
+    text.remove (0, 1);
+  }
+
+  while (text.endsWith (QLatin1Char ('/')))
+  {
+    rule.isDirOnly = true;
+    text.chop (1);
+  }
+  rule.isPath = text.contains (QLatin1Char ('/'));
+  if (text.startsWith (QLatin1Char ('/')))
+  {
+    text.remove (0, 1);
+  }
+  if (text.isEmpty ())
+  {
+    return;
+  }
+
+  rule.pattern = QRegExp (toRegExp (text), Qt::CaseSensitive, QRegExp::RegExp2);
+  if (!rule.pattern.isValid ())
+  {
+    LWARNING () << "Invalid ignore rule" << LARG (line) << LARG (dir);
+    return;
+  }
+  rules.append (rule);
+}
+
+int IgnoreRules::match (const QVector<Rule> &rules, const QString &path, bool isDir)
+{
+  for (auto i = rules.size () - 1; i >= 0; --i)
+  {
+    const auto &rule = rules[i];
+    if ((rule.isDirOnly && !isDir) || !path.startsWith (rule.base))
+    {
+      continue;
+    }
+    const auto subject = (rule.isPath ? path.mid (rule.base.size ())
+                          : path.mid (path.lastIndexOf (QLatin1Char ('/')) + 1));
+    if (rule.pattern.exactMatch (subject))
+    {
+      return rule.isNegated ? Included : Ignored;
+    }
+  }
+  return NoMatch;
+}
+
+void IgnoreRules::addFile (const QString &dir, const QString &name)
+{
+  QFile file (withSlash (dir) + name);
+  if (!file.exists () || file.size () > maxIgnoreFileSize || !file.open (QFile::ReadOnly))
+  {
+    return;
+  }
+  add (dir, QString::fromUtf8 (file.readAll ()).split (QLatin1Char ('\n')));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QRegExp>
+#include <QVector>
+#include <QStringList>
+
+// Rules of .gitignore syntax that exclude entries from search. Rules of every
+// directory are compiled once and inherited by its subdirectories, so a walk
+// checks names of entries before opening them. Later rules win, exclude globs
+// win over ignore files.
+class IgnoreRules
+{
+public:
+  IgnoreRules ();
+  //! Excludes are relative to root. Ignore files of parents of root are read up
+  //! to the nearest git repository, root included.
+  IgnoreRules (const QString &root, const QStringList &excludes, bool useIgnoreFiles);
+
+  //! Rules for entries of dir: own ones and ones of ignore files in dir.
+  IgnoreRules forDir (const QString &dir) const;
+  //! Adds lines of ignore file in dir.
+  void add (const QString &dir, const QStringList &lines);
+
+  bool isIgnored (const QString &path, bool isDir) const;
+
+private:
+  struct Rule
+  {
+    QString base; // dir of rule ending with '/'
+    QRegExp pattern;
+    bool isNegated;
+    bool isDirOnly;
+    bool isPath; // matched with path relative to base, not just with name
+  };
+
+  static void add (QVector<Rule> &rules, const QString &dir, const QString &line);
+  static int match (const QVector<Rule> &rules, const QString &path, bool isDir);
+  void addFile (const QString &dir, const QString &name);
+
+  QVector<Rule> excludes_;
+  QVector<Rule> rules_;
+  bool useIgnoreFiles_;
+};
@@ -0,0 +1,1119 @@
+#include "pathindex.h"
+#include "namefilter.h"
+#include "settingsmanager.h"
+#include "debug.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QRegExp>
+#include <QByteArrayMatcher>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+#ifdef Q_OS_UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#endif
+
+struct PathIndexState
+{
+  QMutex mutex;
+  PathIndex *owner;
+  int generation; // of wanted table, results of older crawls are dropped
+  std::unique_ptr<PathIndex::Table> loaded; // written table, ready for owner
+};
+
+namespace
+{
+const quint32 noParent = 0xffffffff;
+const char magic[8] = {'M', 'D', 'P', 'A', 'T', 'H', 'S', '\0'};
+const quint32 version = 1;
+const quint32 maxEntries = 20000000;
+const int rescanIntervalMs = 4 * 60 * 60 * 1000;
+const int relistDelayMs = 1000;
+const int abortCheckDirs = 256;
+const int maxCandidates = 20000; // trimmed to the best ones when reached
+
+PathIndex *instance_ = nullptr;
+
+// File layout: header, records, names, case folded names. Names are zero
+// terminated UTF-8 components, paths are restored by parent links, so common
+// prefixes are stored once. Records go in path order and every subtree is
+// contiguous.
+struct Header
+{
+  char magic[8];
+  quint32 version;
+  quint32 count;
+  quint32 namesSize;
+  quint32 foldedSize;
+  qint64 builtAt; // msecs since epoch
+};
+
+enum Flag : quint32
+{
+  IsDir = 0x01
+};
+
+struct Record
+{
+  quint32 parent; // noParent for roots, their names are full paths
+  quint32 next; // first record after the subtree
+  quint32 name; // offset in names
+  quint32 folded; // offset in folded names
+  quint32 flags;
+};
+
+QString tablePath ()
+{
+  return QStandardPaths::writableLocation (QStandardPaths::CacheLocation) +
+         QLatin1String ("/paths.idx");
+}
+
+QString childPath (const QString &dir, const QString &name)
+{
+  return dir.endsWith (QLatin1Char ('/')) ? dir + name : dir + QLatin1Char ('/') + name;
+}
+
+QByteArray fold (const QString &text)
+{
+  return text.toCaseFolded ().toUtf8 ();
+}
+
+bool isUnder (const QString &path, const QString &root)
+{
+  if (!path.startsWith (root))
+  {
+    return false;
+  }
+  return path.size () == root.size () || root.endsWith (QLatin1Char ('/')) ||
+         path.at (root.size ()) == QLatin1Char ('/');
+}
+
+struct Listing
+{
+  QStringList dirs;
+  QStringList files;
+};
+
+//! Symbolic links are not followed so the walk can not loop.
+Listing list (const QString &path)
+{
+  Listing result;
+#ifdef Q_OS_UNIX
+  auto dir = ::opendir (QFile::encodeName (path).constData ());
+  if (!dir)
+  {
+    return result;
+  }
+  const auto fd = ::dirfd (dir);
+  while (auto entry = ::readdir (dir))
+  {
+    const auto *name = entry->d_name;
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+    {
+      continue;
+    }
+    auto isDir = (entry->d_type == DT_DIR);
+    if (entry->d_type == DT_UNKNOWN)
+    {
+      struct stat st;
+      isDir = (::fstatat (fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR (st.st_mode));
+    }
+    (isDir ? result.dirs : result.files) << QFile::decodeName (name);
+  }
+  ::closedir (dir);
+#else
+  QDirIterator it (path, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+  while (it.hasNext ())
+  {
+    it.next ();
+    const auto info = it.fileInfo ();
+    (info.isDir () && !info.isSymLink () ? result.dirs : result.files) << it.fileName ();
+  }
+#endif
+  return result;
+}
+
+bool isSubsequence (const char *name, const QByteArray &key)
+{
+  auto k = key.constData ();
+  for (; *name && *k; ++name)
+  {
+    if (*name == *k)
+    {
+      ++k;
+    }
+  }
+  return !*k;
+}
+
+//! Longest part of wildcard without special chars.
+QString longestLiteral (const QString &pattern)
+{
+  QString result;
+  for (const auto &i: pattern.split (QRegExp (QLatin1String ("[*?\\[\\]]")),
+                                     QString::SkipEmptyParts))
+  {
+    if (i.size () > result.size ())
+    {
+      result = i;
+    }
+  }
+  return result;
+}
+
+
+class TableBuilder
+{
+public:
+  quint32 count () const
+  {
+    return quint32 (records_.size ());
+  }
+
+  quint32 begin (quint32 parent, const QString &name, bool isDir)
+  {
+    Record record;
+    record.parent = parent;
+    record.next = count () + 1;
+    record.name = quint32 (names_.size ());
+    record.folded = quint32 (folded_.size ());
+    record.flags = (isDir ? Flag::IsDir : 0);
+    names_ += name.toUtf8 ();
+    names_ += '\0';
+    folded_ += fold (name);
+    folded_ += '\0';
+    records_.append (record);
+    return count () - 1;
+  }
+
+  void end (quint32 entry)
+  {
+    records_[int (entry)].next = count ();
+  }
+
+  QByteArray table () const
+  {
+    Header header;
+    std::memcpy (header.magic, magic, sizeof (magic));
+    header.version = version;
+    header.count = count ();
+    header.namesSize = quint32 (names_.size ());
+    header.foldedSize = quint32 (folded_.size ());
+    header.builtAt = QDateTime::currentMSecsSinceEpoch ();
+
+    const auto recordsSize = records_.size () * int (sizeof (Record));
+    QByteArray result;
+    result.reserve (int (sizeof (header)) + recordsSize + names_.size () + folded_.size ());
+    result.append (reinterpret_cast<const char *>(&header), int (sizeof (header)));
+    result.append (reinterpret_cast<const char *>(records_.constData ()), recordsSize);
+    result.append (names_);
+    result.append (folded_);
+    return result;
+  }
+
+private:
+  QVector<Record> records_;
+  QByteArray names_;
+  QByteArray folded_;
+};
+
+
+class CrawlTask : public QRunnable
+{
+public:
+  CrawlTask (const QStringList &roots, int generation,
+             const QSharedPointer<PathIndexState> &state) :
+    roots_ (roots),
+    generation_ (generation),
+    state_ (state),
+    builder_ (),
+    listed_ (0),
+    isTruncated_ (false)
+  {
+  }
+
+  void run () override;
+
+private:
+  bool isWanted () const;
+  bool add (const QString &path, quint32 parent);
+
+  QStringList roots_;
+  int generation_;
+  QSharedPointer<PathIndexState> state_;
+  TableBuilder builder_;
+  int listed_;
+  bool isTruncated_;
+};
+
+void CrawlTask::run ()
+{
+  QThread::currentThread ()->setPriority (QThread::IdlePriority);
+
+  QElapsedTimer timer;
+  timer.start ();
+  for (const auto &root: roots_)
+  {
+    const auto entry = builder_.begin (noParent, root, true);
+    if (!add (root, entry))
+    {
+      return;
+    }
+    builder_.end (entry);
+  }
+  LDEBUG () << "Indexed" << builder_.count () << "paths in" << timer.elapsed () << "ms";
+  LWARNING_IF (isTruncated_) << "Path index is truncated to" << maxEntries << "entries";
+
+  const auto table = builder_.table ();
+  QMutexLocker locker (&state_->mutex);
+  if (state_->owner && state_->generation == generation_)
+  {
+    QMetaObject::invokeMethod (state_->owner, "setTable", Qt::QueuedConnection,
+                               Q_ARG (QByteArray, table), Q_ARG (int, generation_));
+  }
+}
+
+bool CrawlTask::isWanted () const
+{
+  QMutexLocker locker (&state_->mutex);
+  return state_->owner && state_->generation == generation_;
+}
+
+bool CrawlTask::add (const QString &path, quint32 parent)
+{
+  if (++listed_ % abortCheckDirs == 0 && !isWanted ())
+  {
+    return false;
+  }
+
+  const auto listing = list (path);
+  QVector<QPair<QString, bool> > children;
+  children.reserve (listing.dirs.size () + listing.files.size ());
+  for (const auto &i: listing.dirs)
+  {
+    children.append ({i, true});
+  }
+  for (const auto &i: listing.files)
+  {
+    children.append ({i, false});
+  }
+  std::sort (children.begin (), children.end ());
+
+  for (const auto &i: children)
+  {
+    if (builder_.count () >= maxEntries)
+    {
+      isTruncated_ = true;
+      return true;
+    }
+    const auto entry = builder_.begin (parent, i.first, i.second);
+    if (!i.second)
+    {
+      continue;
+    }
+    if (!add (childPath (path, i.first), entry))
+    {
+      return false;
+    }
+    builder_.end (entry);
+  }
+  return true;
+}
+
+
+class ListTask : public QRunnable
+{
+public:
+  ListTask (const QString &path, const QSharedPointer<PathIndexState> &state) :
+    path_ (path),
+    state_ (state)
+  {
+  }
+
+  void run () override
+  {
+    const auto listing = list (path_);
+    QMutexLocker locker (&state_->mutex);
+    if (state_->owner)
+    {
+      QMetaObject::invokeMethod (state_->owner, "updateDir", Qt::QueuedConnection,
+                                 Q_ARG (QString, path_), Q_ARG (QStringList, listing.dirs),
+                                 Q_ARG (QStringList, listing.files));
+    }
+  }
+
+private:
+  QString path_;
+  QSharedPointer<PathIndexState> state_;
+};
+
+
+class LoadTask : public QRunnable
+{
+public:
+  LoadTask (const QString &path, const QSharedPointer<PathIndexState> &state) :
+    path_ (path),
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  QString path_;
+  QSharedPointer<PathIndexState> state_;
+};
+
+
+class WriteTask : public QRunnable
+{
+public:
+  WriteTask (const QString &path, const QByteArray &table) :
+    path_ (path),
+    table_ (table)
+  {
+  }
+
+  void run () override
+  {
+    QDir ().mkpath (QFileInfo (path_).absolutePath ());
+    QSaveFile file (path_);
+    if (!file.open (QSaveFile::WriteOnly) || file.write (table_) != table_.size () ||
+        !file.commit ())
+    {
+      LWARNING () << "Failed to write path index" << LARG (path_) << file.errorString ();
+    }
+  }
+
+private:
+  QString path_;
+  QByteArray table_;
+};
+
+
+struct Candidate
+{
+  int score;
+  int depth;
+  quint32 entry; // noParent for names of relisted directories
+  QString path;
+  bool isDir;
+};
+
+bool operator< (const Candidate &l, const Candidate &r)
+{
+  if (l.score != r.score)
+  {
+    return l.score > r.score;
+  }
+  if (l.depth != r.depth)
+  {
+    return l.depth < r.depth;
+  }
+  if (l.entry != r.entry)
+  {
+    return l.entry < r.entry;
+  }
+  return l.path < r.path;
+}
+
+}
+
+
+struct PathIndex::Table
+{
+  static bool parse (const char *data, qint64 size, Table &target);
+
+  QString name (quint32 entry) const
+  {
+    return QString::fromUtf8 (names + records[entry].name);
+  }
+
+  bool isDir (quint32 entry) const
+  {
+    return records[entry].flags & Flag::IsDir;
+  }
+
+  int depth (quint32 entry) const
+  {
+    auto result = 0;
+    for (auto i = records[entry].parent; i != noParent; i = records[i].parent)
+    {
+      ++result;
+    }
+    return result;
+  }
+
+  QString path (quint32 entry) const;
+  //! Record of name that contains folded offset.
+  quint32 entryAt (quint32 offset) const;
+  //! noParent if not found.
+  quint32 find (const QString &path) const;
+
+  QFile file; // mapped written table
+  QByteArray memory; // built table that is not written yet
+  const Header *header;
+  const Record *records;
+  const char *names;
+  const char *folded;
+  quint32 count;
+};
+
+bool PathIndex::Table::parse (const char *data, qint64 size, Table &target)
+{
+  if (size < qint64 (sizeof (Header)))
+  {
+    return false;
+  }
+  const auto *header = reinterpret_cast<const Header *>(data);
+  if (std::memcmp (header->magic, magic, sizeof (magic)) != 0 || header->version != version)
+  {
+    return false;
+  }
+  const auto expected = qint64 (sizeof (Header)) + qint64 (header->count) * qint64 (sizeof (Record)) +
+                        header->namesSize + header->foldedSize;
+  if (size != expected)
+  {
+    return false;
+  }
+
+  target.header = header;
+  target.records = reinterpret_cast<const Record *>(data + sizeof (Header));
+  target.names = reinterpret_cast<const char *>(target.records + header->count);
+  target.folded = target.names + header->namesSize;
+  target.count = header->count;
+
+  // names must not run past their blocks
+  if ((header->namesSize != 0 && target.names[header->namesSize - 1] != '\0') ||
+      (header->foldedSize != 0 && target.folded[header->foldedSize - 1] != '\0'))
+  {
+    return false;
+  }
+
+  // links go forward only so walks end, folded names go in record order
+  for (quint32 i = 0; i < target.count; ++i)
+  {
+    const auto &record = target.records[i];
+    if ((record.parent != noParent && record.parent >= i) ||
+        record.next <= i || record.next > target.count ||
+        (record.parent != noParent && record.next > target.records[record.parent].next) ||
+        record.name >= header->namesSize || record.folded >= header->foldedSize ||
+        (i == 0 ? record.folded != 0 : record.folded <= target.records[i - 1].folded))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+QString PathIndex::Table::path (quint32 entry) const
+{
+  QVector<quint32> chain;
+  for (auto i = entry; i != noParent; i = records[i].parent)
+  {
+    chain.append (i);
+  }
+
+  auto result = name (chain.last ());
+  for (auto i = chain.size () - 2; i >= 0; --i)
+  {
+    result = childPath (result, name (chain[i]));
+  }
+  return result;
+}
+
+quint32 PathIndex::Table::entryAt (quint32 offset) const
+{
+  const auto *end = records + count;
+  const auto it = std::upper_bound (records, end, offset,
+                                    [](quint32 l, const Record &r) {return l < r.folded;});
+  return quint32 (it - records) - 1;
+}
+
+quint32 PathIndex::Table::find (const QString &path) const
+{
+  for (quint32 root = 0; root < count; root = records[root].next)
+  {
+    const auto rootName = name (root);
+    if (!isUnder (path, rootName))
+    {
+      continue;
+    }
+
+    auto entry = root;
+    for (const auto &part: path.mid (rootName.size ()).split (QLatin1Char ('/'),
+                                                             QString::SkipEmptyParts))
+    {
+      const auto key = part.toUtf8 ();
+      auto found = noParent;
+      for (auto i = entry + 1, end = records[entry].next; i < end; i = records[i].next)
+      {
+        if (std::strcmp (names + records[i].name, key.constData ()) == 0)
+        {
+          found = i;
+          break;
+        }
+      }
+      if (found == noParent)
+      {
+        return noParent;
+      }
+      entry = found;
+    }
+    return entry;
+  }
+  return noParent;
+}
+
+
+void LoadTask::run ()
+{
+  std::unique_ptr<PathIndex::Table> table (new PathIndex::Table);
+  table->file.setFileName (path_);
+  if (table->file.open (QFile::ReadOnly))
+  {
+    const auto size = table->file.size ();
+    const auto *data = reinterpret_cast<const char *>(table->file.map (0, size));
+    if (data && PathIndex::Table::parse (data, size, *table))
+    {
+      LDEBUG () << "Loaded path index of" << table->count << "entries";
+    }
+    else
+    {
+      LWARNING () << "Path index is not usable" << LARG (path_);
+      table.reset ();
+    }
+  }
+  else
+  {
+    table.reset ();
+  }
+
+  QMutexLocker locker (&state_->mutex);
+  if (state_->owner)
+  {
+    state_->loaded = std::move (table);
+    QMetaObject::invokeMethod (state_->owner, "takeLoaded", Qt::QueuedConnection);
+  }
+}
+
+
+void PathIndex::init ()
+{
+  instance_ = new PathIndex (tablePath ());
+  SettingsManager::subscribeForUpdates (instance_);
+  instance_->updateSettings ();
+}
+
+PathIndex &PathIndex::instance ()
+{
+  return *instance_;
+}
+
+PathIndex::PathIndex (const QString &tablePath, QObject *parent) :
+  QObject (parent),
+  state_ (new PathIndexState),
+  crawlPool_ (new QThreadPool), // not owned: workers may hang on dead mounts
+  listPool_ (new QThreadPool),
+  rescanTimer_ (new QTimer (this)),
+  relistTimer_ (new QTimer (this)),
+  roots_ (),
+  tablePath_ (tablePath),
+  table_ (),
+  isLoading_ (false),
+  overrides_ (),
+  overridden_ (),
+  changed_ (),
+  isCrawling_ (false)
+{
+  state_->owner = this;
+  state_->generation = 0;
+  crawlPool_->setMaxThreadCount (1);
+  listPool_->setMaxThreadCount (2);
+
+  rescanTimer_->setInterval (rescanIntervalMs);
+  connect (rescanTimer_, &QTimer::timeout,
+           this, [this] {if (!isCrawling_) {rescan ();}});
+
+  relistTimer_->setSingleShot (true);
+  relistTimer_->setInterval (relistDelayMs);
+  connect (relistTimer_, &QTimer::timeout,
+           this, &PathIndex::relistChanged);
+
+  load ();
+}
+
+PathIndex::~PathIndex ()
+{
+  QMutexLocker locker (&state_->mutex);
+  state_->owner = nullptr;
+}
+
+void PathIndex::updateSettings ()
+{
+  SettingsManager settings;
+  QStringList roots;
+  for (const auto &i: settings.get (SettingsManager::IndexedRoots).toString ().split (QLatin1Char (',')))
+  {
+    const auto root = QDir::cleanPath (QDir::fromNativeSeparators (i.trimmed ()));
+    if (!i.trimmed ().isEmpty () && !roots.contains (root))
+    {
+      roots << root;
+    }
+  }
+  setRoots (roots);
+}
+
+void PathIndex::setRoots (const QStringList &roots)
+{
+  if (roots == roots_)
+  {
+    return;
+  }
+  roots_ = roots;
+
+  if (roots_.isEmpty ())
+  {
+    {
+      QMutexLocker locker (&state_->mutex);
+      ++state_->generation;
+    }
+    isCrawling_ = false;
+    isLoading_ = false;
+    rescanTimer_->stop ();
+    table_.reset ();
+    overrides_.clear ();
+    overridden_.clear ();
+    changed_.clear ();
+    QFile::remove (tablePath_);
+    emit updated ();
+    return;
+  }
+
+  rescanTimer_->start ();
+  if (!isLoading_) // checked once written table is loaded otherwise
+  {
+    rescanIfOutdated ();
+  }
+}
+
+bool PathIndex::isEnabled () const
+{
+  return !roots_.isEmpty ();
+}
+
+bool PathIndex::isReady () const
+{
+  return table_ && tableRoots () == roots_;
+}
+
+bool PathIndex::contains (const QString &path) const
+{
+  for (const auto &i: roots_)
+  {
+    if (isUnder (path, i))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+QVector<PathIndex::Match> PathIndex::find (const QString &query, int limit) const
+{
+  auto text = QDir::fromNativeSeparators (query.trimmed ());
+  const auto isDirsOnly = text.endsWith (QLatin1Char ('/'));
+  if (isDirsOnly)
+  {
+    text.chop (1);
+  }
+  const auto separator = text.lastIndexOf (QLatin1Char ('/'));
+  const auto pathPart = (separator > 0 ? text.left (separator) : QString ());
+  const auto namePart = text.mid (separator + 1);
+  if (namePart.isEmpty () || limit < 1)
+  {
+    return {};
+  }
+
+  const auto isWildcard = namePart.contains (QRegExp (QLatin1String ("[*?\\[]")));
+  const QRegExp wildcard (namePart, Qt::CaseInsensitive, QRegExp::Wildcard);
+  const NameFilter fuzzy (namePart, NameFilter::Mode::Fuzzy);
+
+  const auto substringScore = [&namePart](const QString &name) {
+                                if (name.compare (namePart, Qt::CaseInsensitive) == 0)
+                                {
+                                  return 3;
+                                }
+                                if (name.startsWith (namePart, Qt::CaseInsensitive))
+                                {
+                                  return 2;
+                                }
+                                return name.contains (namePart, Qt::CaseInsensitive) ? 1 : -1;
+                              };
+  const auto wildcardScore = [&wildcard](const QString &name) {
+                               return wildcard.exactMatch (name) ? 1 : -1;
+                             };
+  const auto fuzzyScore = [&fuzzy, &substringScore](const QString &name) {
+                            // names containing the text are found without fuzziness
+                            return substringScore (name) < 0 ? fuzzy.score (name) : -1;
+                          };
+
+  // names that are gone or whose path does not match are skipped
+  const auto isStale = [this](quint32 entry) {
+                         const auto &table = *table_;
+                         for (auto child = entry, parent = table.records[entry].parent;
+                              parent != noParent; child = parent, parent = table.records[parent].parent)
+                         {
+                           const auto it = overridden_.find (parent);
+                           if (it != overridden_.end () && !it->contains (table.name (child)))
+                           {
+                             return true;
+                           }
+                         }
+                         return false;
+                       };
+  const auto isPathMatched = [&pathPart](const QString &path) {
+                               return pathPart.isEmpty () ||
+                                      path.contains (pathPart, Qt::CaseInsensitive);
+                             };
+
+  // only the best ones are kept, so matches late in the table are not lost
+  QVector<Candidate> candidates;
+  const auto kept = std::max (1, std::min (limit, maxCandidates / 2));
+  const auto addCandidate = [&](const Candidate &candidate) {
+                              candidates.append (candidate);
+                              if (candidates.size () >= maxCandidates)
+                              {
+                                std::nth_element (candidates.begin (), candidates.begin () + kept,
+                                                  candidates.end ());
+                                candidates.resize (kept);
+                              }
+                            };
+  const auto addEntry = [&](quint32 entry, int score) {
+                          if (score < 0 || (isDirsOnly && !table_->isDir (entry)) ||
+                              (!overridden_.isEmpty () && isStale (entry)))
+                          {
+                            return;
+                          }
+                          QString path;
+                          if (!pathPart.isEmpty ())
+                          {
+                            path = table_->path (entry);
+                            if (!isPathMatched (path))
+                            {
+                              return;
+                            }
+                          }
+                          addCandidate ({score, table_->depth (entry), entry, path,
+                                         table_->isDir (entry)});
+                        };
+  const auto addOverrides = [&](const std::function<int(const QString &)> &score) {
+                              for (auto it = overrides_.cbegin (), end = overrides_.cend (); it != end; ++it)
+                              {
+                                const auto depth = it.key ().count (QLatin1Char ('/')) + 1;
+                                for (auto isDir: {true, false})
+                                {
+                                  if (isDirsOnly && !isDir)
+                                  {
+                                    continue;
+                                  }
+                                  for (const auto &name: (isDir ? it->dirs : it->files))
+                                  {
+                                    const auto value = score (name);
+                                    const auto path = childPath (it.key (), name);
+                                    if (value >= 0 && isPathMatched (path))
+                                    {
+                                      addCandidate ({value, depth, noParent, path, isDir});
+                                    }
+                                  }
+                                }
+                              }
+                            };
+  // every name is matched at most once, by found offset in folded names
+  const auto scanFolded = [&](const QString &literal,
+                              const std::function<int(const QString &)> &score) {
+                            const auto &table = *table_;
+                            const auto key = fold (literal);
+                            const QByteArrayMatcher matcher (key);
+                            const auto size = int (table.header->foldedSize);
+                            for (auto from = matcher.indexIn (table.folded, size, 0);
+                                 from != -1;
+                                 from = matcher.indexIn (table.folded, size, from))
+                            {
+                              const auto entry = table.entryAt (quint32 (from));
+                              addEntry (entry, score (table.name (entry)));
+                              if (entry + 1 >= table.count)
+                              {
+                                break;
+                              }
+                              from = int (table.records[entry + 1].folded);
+                            }
+                          };
+  const auto scanAll = [&](const std::function<bool(const char *)> &isCandidate,
+                           const std::function<int(const QString &)> &score) {
+                         const auto &table = *table_;
+                         for (quint32 i = 0; i < table.count; ++i)
+                         {
+                           if (isCandidate (table.folded + table.records[i].folded))
+                           {
+                             addEntry (i, score (table.name (i)));
+                           }
+                         }
+                       };
+
+  QVector<Match> result;
+  const auto take = [&] {
+                      const auto count = std::min (candidates.size (), limit - result.size ());
+                      std::partial_sort (candidates.begin (), candidates.begin () + count,
+                                         candidates.end ());
+                      for (auto i = 0; i < count; ++i)
+                      {
+                        const auto &c = candidates[i];
+                        auto path = c.path;
+                        if (path.isEmpty ())
+                        {
+                          path = table_->path (c.entry);
+                        }
+                        result.append ({QDir::toNativeSeparators (path), c.isDir});
+                      }
+                      candidates.clear ();
+                    };
+
+  if (isWildcard)
+  {
+    const auto literal = longestLiteral (namePart);
+    if (table_ && !literal.isEmpty ())
+    {
+      scanFolded (literal, wildcardScore);
+    }
+    else if (table_)
+    {
+      scanAll ([](const char *) {return true;}, wildcardScore);
+    }
+    addOverrides (wildcardScore);
+    take ();
+    return result;
+  }
+
+  if (table_)
+  {
+    scanFolded (namePart, substringScore);
+  }
+  addOverrides (substringScore);
+  take ();
+  if (result.size () >= limit)
+  {
+    return result;
+  }
+
+  if (table_)
+  {
+    const auto key = fold (namePart);
+    scanAll ([&key](const char *name) {return isSubsequence (name, key);}, fuzzyScore);
+  }
+  addOverrides (fuzzyScore);
+  take ();
+  return result;
+}
+
+void PathIndex::refresh (const QString &path)
+{
+  if (!contains (path))
+  {
+    return;
+  }
+  changed_.insert (path);
+  if (!relistTimer_->isActive ())
+  {
+    relistTimer_->start ();
+  }
+}
+
+void PathIndex::relistChanged ()
+{
+  for (const auto &i: changed_)
+  {
+    listPool_->start (new ListTask (i, state_));
+  }
+  changed_.clear ();
+}
+
+void PathIndex::load ()
+{
+  isLoading_ = true;
+  crawlPool_->start (new LoadTask (tablePath_, state_));
+}
+
+void PathIndex::takeLoaded ()
+{
+  std::unique_ptr<Table> loaded;
+  {
+    QMutexLocker locker (&state_->mutex);
+    loaded = std::move (state_->loaded);
+  }
+  if (!isLoading_) // disabled or rebuilt meanwhile
+  {
+    return;
+  }
+  isLoading_ = false;
+  if (loaded)
+  {
+    table_ = std::move (loaded);
+    emit updated ();
+  }
+  if (!roots_.isEmpty ())
+  {
+    rescanIfOutdated ();
+  }
+}
+
+void PathIndex::rescanIfOutdated ()
+{
+  const auto isOutdated = !table_ ||
+                          QDateTime::currentMSecsSinceEpoch () - table_->header->builtAt > rescanIntervalMs;
+  if (isOutdated || tableRoots () != roots_)
+  {
+    rescan ();
+  }
+}
+
+void PathIndex::rescan ()
+{
+  int generation = 0;
+  {
+    QMutexLocker locker (&state_->mutex);
+    generation = ++state_->generation;
+  }
+  isCrawling_ = true;
+  crawlPool_->start (new CrawlTask (roots_, generation, state_));
+}
+
+void PathIndex::setTable (const QByteArray &table, int generation)
+{
+  {
+    QMutexLocker locker (&state_->mutex);
+    if (generation != state_->generation)
+    {
+      return;
+    }
+  }
+  isCrawling_ = false;
+  isLoading_ = false; // written table is older
+
+  // relisted directories are matched against the new table
+  auto relisted = overrides_.keys ();
+  for (auto it = overridden_.cbegin (), end = overridden_.cend (); it != end; ++it)
+  {
+    relisted << table_->path (it.key ());
+  }
+  overrides_.clear ();
+  overridden_.clear ();
+
+  // mapped file is replaced so it must be released first
+  table_.reset ();
+  std::unique_ptr<Table> parsed (new Table);
+  parsed->memory = table;
+  if (Table::parse (parsed->memory.constData (), parsed->memory.size (), *parsed))
+  {
+    crawlPool_->start (new WriteTask (tablePath_, parsed->memory));
+    table_ = std::move (parsed);
+  }
+  else
+  {
+    LWARNING () << "Built path index is not usable";
+  }
+
+  for (const auto &i: relisted)
+  {
+    refresh (i);
+  }
+
+  emit updated ();
+}
+
+void PathIndex::updateDir (const QString &path, const QStringList &dirs, const QStringList &files)
+{
+  if (!contains (path))
+  {
+    return;
+  }
+
+  const auto entry = (table_ ? table_->find (path) : noParent);
+  QSet<QString> known;
+  if (entry != noParent)
+  {
+    const auto &table = *table_;
+    for (auto i = entry + 1, end = table.records[entry].next; i < end; i = table.records[i].next)
+    {
+      known.insert (table.name (i));
+    }
+  }
+
+  Override added;
+  QSet<QString> names;
+  for (const auto &i: dirs)
+  {
+    names.insert (i);
+    if (!known.contains (i))
+    {
+      added.dirs << i;
+    }
+  }
+  for (const auto &i: files)
+  {
+    names.insert (i);
+    if (!known.contains (i))
+    {
+      added.files << i;
+    }
+  }
+
+  if (entry != noParent)
+  {
+    overridden_.insert (entry, names);
+  }
+  if (added.dirs.isEmpty () && added.files.isEmpty ())
+  {
+    overrides_.remove (path);
+  }
+  else
+  {
+    overrides_.insert (path, added);
+  }
+  emit updated ();
+}
+
+QStringList PathIndex::tableRoots () const
+{
+  QStringList result;
+  if (!table_)
+  {
+    return result;
+  }
+  const auto &table = *table_;
+  for (quint32 i = 0; i < table.count; i = table.records[i].next)
+  {
+    result << table.name (i);
+  }
+  return result;
+}
+
+#include "moc_pathindex.cpp"
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+class QTimer;
+class QThreadPool;
+struct PathIndexState;
+
+// Names of all files under configured roots, for instant lookup by name. The
+// table is built by a low priority crawler and kept on disk in a form that is
+// mapped and searched in place, so it is ready soon after start. Mapping and
+// validation of the written table happen in background too. Directories
+// reported as changed are relisted and override the table until the next
+// periodic rescan.
+class PathIndex : public QObject
+{
+Q_OBJECT
+public:
+  struct Match
+  {
+    QString path;
+    bool isDir;
+  };
+  struct Table;
+
+  //! Application index follows settings.
+  static void init ();
+  static PathIndex &instance ();
+
+  //! Table is kept in tablePath.
+  explicit PathIndex (const QString &tablePath, QObject *parent = nullptr);
+  ~PathIndex ();
+
+  //! Cleaned absolute paths.
+  void setRoots (const QStringList &roots);
+
+  bool isEnabled () const;
+  bool isReady () const;
+  bool contains (const QString &path) const;
+
+  //! Query is matched against names: '*' and '?' make it a wildcard, otherwise
+  //! names containing it come first and fuzzy matched ones follow. A part
+  //! before the last '/' must be contained in the path.
+  QVector<Match> find (const QString &query, int limit) const;
+
+  //! Relists directory later if it is indexed.
+  void refresh (const QString &path);
+
+signals:
+  void updated ();
+
+public slots:
+  void updateSettings ();
+
+private slots:
+  void setTable (const QByteArray &table, int generation);
+  void takeLoaded ();
+  void updateDir (const QString &path, const QStringList &dirs, const QStringList &files);
+
+private:
+  struct Override
+  {
+    QStringList dirs;
+    QStringList files;
+  };
+
+  void load ();
+  void rescanIfOutdated ();
+  void rescan ();
+  void relistChanged ();
+  QStringList tableRoots () const;
+
+  QSharedPointer<PathIndexState> state_;
+  QThreadPool *crawlPool_;
+  QThreadPool *listPool_;
+  QTimer *rescanTimer_;
+  QTimer *relistTimer_;
+  QStringList roots_;
+  QString tablePath_;
+  std::unique_ptr<Table> table_;
+  bool isLoading_; // written table is mapped in background
+  QHash<QString, Override> overrides_; // by directory path
+  QHash<quint32, QSet<QString> > overridden_; // table entry of directory -> names
+  QSet<QString> changed_;
+  bool isCrawling_;
+};
@@ -0,0 +1,126 @@
+#include "quickjumpdialog.h"
+#include "pathindex.h"
+
+#include <QLineEdit>
+#include <QListWidget>
+#include <QLabel>
+#include <QBoxLayout>
+#include <QKeyEvent>
+#include <QApplication>
+#include <QStyle>
+#include <QSettings>
+#include <QElapsedTimer>
+
+namespace
+{
+const QString qs_geometry = "quickJump/geometry";
+const int maxResults = 200;
+}
+
+QuickJumpDialog::QuickJumpDialog (QWidget *parent) :
+  QDialog (parent),
+  query_ (new QLineEdit (this)),
+  results_ (new QListWidget (this)),
+  status_ (new QLabel (this))
+{
+  setObjectName ("quickJump");
+  setWindowTitle (tr ("Go to"));
+
+  query_->setPlaceholderText (tr ("Name, wildcard or path part"));
+  query_->installEventFilter (this);
+  connect (query_, &QLineEdit::textChanged,
+           this, &QuickJumpDialog::updateResults);
+  connect (query_, &QLineEdit::returnPressed,
+           this, &QDialog::accept);
+
+  results_->setUniformItemSizes (true);
+  results_->setFocusPolicy (Qt::NoFocus);
+  connect (results_, &QListWidget::itemActivated,
+           this, &QDialog::accept);
+
+  auto &index = PathIndex::instance ();
+  connect (&index, &PathIndex::updated,
+           this, &QuickJumpDialog::updateResults);
+
+  auto layout = new QVBoxLayout (this);
+  layout->addWidget (query_);
+  layout->addWidget (results_);
+  layout->addWidget (status_);
+
+  QSettings settings;
+  restoreState (settings);
+
+  updateResults ();
+}
+
+QuickJumpDialog::~QuickJumpDialog ()
+{
+  QSettings settings;
+  saveState (settings);
+}
+
+void QuickJumpDialog::saveState (QSettings &settings) const
+{
+  settings.setValue (qs_geometry, saveGeometry ());
+}
+
+void QuickJumpDialog::restoreState (QSettings &settings)
+{
+  restoreGeometry (settings.value (qs_geometry).toByteArray ());
+}
+
+QString QuickJumpDialog::path () const
+{
+  const auto *item = results_->currentItem ();
+  return item ? item->text () : QString ();
+}
+
+bool QuickJumpDialog::eventFilter (QObject *watched, QEvent *event)
+{
+  if (watched != query_ || event->type () != QEvent::KeyPress)
+  {
+    return false;
+  }
+  switch (static_cast<QKeyEvent *>(event)->key ())
+  {
+    case Qt::Key_Up:
+    case Qt::Key_Down:
+    case Qt::Key_PageUp:
+    case Qt::Key_PageDown:
+      QApplication::sendEvent (results_, event);
+      return true;
+  }
+  return false;
+}
+
+void QuickJumpDialog::updateResults ()
+{
+  const auto &index = PathIndex::instance ();
+  if (!index.isEnabled ())
+  {
+    results_->clear ();
+    status_->setText (tr ("No folders are indexed, add them in settings"));
+    return;
+  }
+
+  QElapsedTimer timer;
+  timer.start ();
+  const auto matches = index.find (query_->text (), maxResults);
+  const auto elapsed = timer.elapsed ();
+
+  const auto dirIcon = style ()->standardIcon (QStyle::SP_DirIcon);
+  const auto fileIcon = style ()->standardIcon (QStyle::SP_FileIcon);
+  results_->setUpdatesEnabled (false);
+  results_->clear ();
+  for (const auto &i: matches)
+  {
+    results_->addItem (new QListWidgetItem (i.isDir ? dirIcon : fileIcon, i.path));
+  }
+  results_->setCurrentRow (0);
+  results_->setUpdatesEnabled (true);
+
+  const auto found = tr ("Found: %1 (%2 ms)").arg (matches.size ()).arg (elapsed);
+  status_->setText (index.isReady () ? found : found + tr (", index is being built"));
+}
+
+#include "moc_quickjumpdialog.cpp"
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QDialog>
+
+class QLineEdit;
+class QListWidget;
+class QLabel;
+class QSettings;
+
+// Finds files and directories by name in path index while typing.
+class QuickJumpDialog : public QDialog
+{
+Q_OBJECT
+public:
+  explicit QuickJumpDialog (QWidget *parent = nullptr);
+  ~QuickJumpDialog ();
+
+  //! Chosen file or directory, empty if none.
+  QString path () const;
+
+  bool eventFilter (QObject *watched, QEvent *event) override;
+
+private:
+  void saveState (QSettings &settings) const;
+  void restoreState (QSettings &settings);
+
+  void updateResults ();
+
+  QLineEdit *query_;
+  QListWidget *results_;
+  QLabel *status_;
+};
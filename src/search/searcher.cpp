@@ -9,6 +9,8 @@
 #include <QByteArrayMatcher>
 #include <QTextCodec>
 
+#include <memory>
+
 Searcher::Searcher (QObject *parent) :
   QObject (parent),
   isAborted_ (false),
@@ -53,13 +55,23 @@ void Searcher::setText (const QString &text, Qt::CaseSensitivity caseSeisitivity
   options_.maxOccurenceLength = options_.sideContextLength * 2 + textLength;
 
   auto *codec = QTextCodec::codecForLocale ();
-  options_.textDecoder = codec->makeDecoder (QTextCodec::ConvertInvalidToNull);
+  options_.codec = codec;
+  options_.encodedText = codec->fromUnicode (text);
+}
+
+void Searcher::setIgnoreRules (bool isOn, const QStringList &excludes)
+{
+  options_.useIgnoreRules = isOn;
+  options_.excludes = excludes;
 }
 
 void Searcher::startAsync (const QStringList &dirs)
 {
   isAborted_ = false;
 
+  options_.contentTables = (options_.text.pattern ().isEmpty ()
+                            ? TrigramIndex::Tables () : TrigramIndex::instance ().tables ());
+
   QtConcurrent::run (this, &Searcher::searchFiles, dirs, options_, 0);
 }
 
@@ -70,6 +82,11 @@ void Searcher::abort ()
 
 void Searcher::searchFiles (QStringList dirs, Options options, int depth)
 {
+  if (!depth && !options.contentTables.isEmpty ())
+  {
+    options.contentFilter = TrigramIndex::Filter (options.contentTables, options.encodedText);
+  }
+
   for (const auto &dir: dirs)
   {
     if (isAborted_)
@@ -79,26 +96,45 @@ void Searcher::searchFiles (QStringList dirs, Options options, int depth)
 
     QDir d (dir);
 
+    auto rules = options.ignoreRules;
+    if (options.useIgnoreRules)
+    {
+      const auto path = d.absolutePath ();
+      rules = (depth ? rules : IgnoreRules (path, options.excludes, true)).forDir (path);
+    }
+
     if (options.recursive)
     {
       QStringList subdirs;
-      for (const auto &subdir: d.entryList (QDir::Dirs | QDir::NoDotAndDotDot))
+      for (const auto &info: d.entryInfoList (QDir::Dirs | QDir::NoDotAndDotDot))
       {
-        subdirs.append (d.absoluteFilePath (subdir));
+        const auto path = info.absoluteFilePath ();
+        if (!options.useIgnoreRules || !rules.isIgnored (path, true))
+        {
+          subdirs.append (path);
+        }
       }
       if (!subdirs.isEmpty ())
       {
-        searchFiles (subdirs, options, depth + 1);
+        auto subdirOptions = options;
+        subdirOptions.ignoreRules = rules;
+        searchFiles (subdirs, subdirOptions, depth + 1);
       }
     }
 
-    for (const auto &fileName: d.entryList (QDir::Files | QDir::Hidden | QDir::System))
+    for (const auto &info: d.entryInfoList (QDir::Files | QDir::Hidden | QDir::System))
     {
       if (isAborted_)
       {
         break;
       }
 
+      const auto fileName = info.fileName ();
+      if (options.useIgnoreRules && rules.isIgnored (info.absoluteFilePath (), false))
+      {
+        continue;
+      }
+
       auto passPattern = options.filePatterns.isEmpty ();
       for (const auto &filter: options.filePatterns)
       {
@@ -117,7 +153,10 @@ void Searcher::searchFiles (QStringList dirs, Options options, int depth)
       const auto fullName = d.absoluteFilePath (fileName);
       if (!options.text.pattern ().isEmpty ())
       {
-        searchText (fullName, options);
+        if (options.contentFilter.mayContain (info))
+        {
+          searchText (fullName, options);
+        }
       }
       else
       {
@@ -128,6 +167,11 @@ void Searcher::searchFiles (QStringList dirs, Options options, int depth)
 
   if (!depth)
   {
+    for (auto &i: compressedSearches_)
+    {
+      i.waitForFinished ();
+    }
+    compressedSearches_.clear ();
     emit finished ();
   }
 }
@@ -140,13 +184,49 @@ void Searcher::searchText (const QString &fileName, Searcher::Options options)
     return;
   }
 
+  const auto format = DecompressingDevice::format (f.peek (DecompressingDevice::headerSize));
+  if (format == DecompressingDevice::Format::None)
+  {
+    searchLines (fileName, f, options);
+    return;
+  }
+
+  // contents of unsupported formats are not text
+  if (DecompressingDevice::isSupported (format))
+  {
+    compressedSearches_.append (QtConcurrent::run (this, &Searcher::searchCompressed,
+                                                   fileName, format, options));
+  }
+}
+
+void Searcher::searchCompressed (const QString &fileName, DecompressingDevice::Format format,
+                                 Searcher::Options options)
+{
+  QFile f (fileName);
+  if (!f.open (QFile::ReadOnly))
+  {
+    return;
+  }
+
+  DecompressingDevice device (&f, format);
+  if (device.open (QIODevice::ReadOnly))
+  {
+    searchLines (fileName, device, options);
+  }
+}
+
+void Searcher::searchLines (const QString &fileName, QIODevice &device,
+                            const Searcher::Options &options)
+{
   auto offset = 0;
   auto lineNumber = 0;
   QVector<SearchOccurence> occurrences;
-  ASSERT (options.textDecoder);
-  while (!f.atEnd ())
+  ASSERT (options.codec);
+  // decoders keep state between lines, so every file has its own
+  std::unique_ptr<QTextDecoder> decoder (options.codec->makeDecoder (QTextCodec::ConvertInvalidToNull));
+  while (!device.atEnd () && !isAborted_)
   {
-    const auto line = options.textDecoder->toUnicode (f.readLine ());
+    const auto line = decoder->toUnicode (device.readLine ());
     ++lineNumber;
     auto start = 0;
 
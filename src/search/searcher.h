@@ -1,12 +1,17 @@
 #pragma once
 
+#include "trigramindex.h"
+#include "ignorerules.h"
+#include "decompressingdevice.h"
+
 #include <QObject>
 #include <QVector>
 #include <QStringMatcher>
+#include <QFuture>
 
 #include <atomic>
 
-class QTextDecoder;
+class QTextCodec;
 
 struct SearchOccurence
 {
@@ -27,6 +32,8 @@ public:
   void setFilePatterns (const QStringList &filePatterns);
   void setText (const QString &text, Qt::CaseSensitivity caseSeisitivity,
                 bool wordOnly);
+  //! Nothing is skipped if off.
+  void setIgnoreRules (bool isOn, const QStringList &excludes);
 
   void startAsync (const QStringList &dirs);
   void abort ();
@@ -45,14 +52,24 @@ private:
     int textLength{0};
     int sideContextLength{50};
     int maxOccurenceLength{0};
-    QTextDecoder *textDecoder{nullptr};
+    QTextCodec *codec{nullptr};
+    QByteArray encodedText;
+    TrigramIndex::Tables contentTables;
+    TrigramIndex::Filter contentFilter;
+    bool useIgnoreRules{false};
+    QStringList excludes;
+    IgnoreRules ignoreRules; // of parent of searched dirs
   };
 
   void searchFiles (QStringList dirs, Options options, int depth);
   void searchText (const QString &fileName, Options options);
+  void searchCompressed (const QString &fileName, DecompressingDevice::Format format,
+                         Options options);
+  void searchLines (const QString &fileName, QIODevice &device, const Options &options);
 
   std::atomic_bool isAborted_;
   Options options_;
+  QVector<QFuture<void> > compressedSearches_; // used by walking thread
 };
 
 Q_DECLARE_METATYPE (QVector<SearchOccurence>)
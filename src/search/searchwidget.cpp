@@ -27,6 +27,9 @@ const QString qs_text = "search/text";
 const QString qs_recursive = "search/recursive";
 const QString qs_caseSensitive = "search/caseSensitive";
 const QString qs_wordOnly = "search/wordOnly";
+const QString qs_skipIgnored = "search/skipIgnored";
+const QString qs_excludes = "search/excludes";
+const QString defaultExcludes = "node_modules,build,__pycache__,venv";
 const QString qs_header = "search/header";
 }
 
@@ -36,9 +39,11 @@ SearchWidget::SearchWidget (ShellCommandModel *commanRunner, QWidget *parent) :
   dir_ (new QLineEdit (this)),
   filePattern_ (new QLineEdit (this)),
   text_ (new QLineEdit (this)),
+  excludes_ (new QLineEdit (this)),
   recursive_ (new QCheckBox (tr ("Recursive"), this)),
   caseSensitive_ (new QCheckBox (tr ("Case sensitive"), this)),
   wordOnly_ (new QCheckBox (tr ("Word only"), this)),
+  skipIgnored_ (new QCheckBox (tr ("Skip ignored"), this)),
   buttons_ (new QDialogButtonBox (QDialogButtonBox::Apply |
                                   QDialogButtonBox::Abort, this)),
   results_ (new QTreeView (this)),
@@ -57,6 +62,12 @@ SearchWidget::SearchWidget (ShellCommandModel *commanRunner, QWidget *parent) :
 
   filePattern_->setText (QLatin1String ("*"));
 
+  skipIgnored_->setToolTip (tr ("Do not search in excluded folders and files "
+                                "listed in .gitignore and .ignore"));
+  excludes_->setToolTip (tr ("Comma separated patterns of .gitignore syntax"));
+  connect (skipIgnored_, &QCheckBox::toggled,
+           excludes_, &QLineEdit::setEnabled);
+
   results_->setModel (model_);
   results_->hideColumn (SearchResultsModel::Offset);
 
@@ -91,12 +102,17 @@ SearchWidget::SearchWidget (ShellCommandModel *commanRunner, QWidget *parent) :
     layout->addWidget (new QLabel (tr ("Search text:")), row, 0);
     layout->addWidget (text_, row, 1);
 
+    ++row;
+    layout->addWidget (new QLabel (tr ("Exclude:")), row, 0);
+    layout->addWidget (excludes_, row, 1);
+
     ++row;
     auto options = new QHBoxLayout;
     layout->addLayout (options, row, 0, 1, 2);
     options->addWidget (recursive_);
     options->addWidget (caseSensitive_);
     options->addWidget (wordOnly_);
+    options->addWidget (skipIgnored_);
 
     ++row;
     layout->addWidget (buttons_, row, 0, 1, 2);
@@ -111,6 +127,7 @@ SearchWidget::SearchWidget (ShellCommandModel *commanRunner, QWidget *parent) :
 
   QSettings settings;
   restoreState (settings);
+  excludes_->setEnabled (skipIgnored_->isChecked ());
 }
 
 SearchWidget::~SearchWidget ()
@@ -128,6 +145,8 @@ void SearchWidget::saveState (QSettings &settings) const
   settings.setValue (qs_recursive, recursive_->isChecked ());
   settings.setValue (qs_caseSensitive, caseSensitive_->isChecked ());
   settings.setValue (qs_wordOnly, wordOnly_->isChecked ());
+  settings.setValue (qs_skipIgnored, skipIgnored_->isChecked ());
+  settings.setValue (qs_excludes, excludes_->text ());
 }
 
 void SearchWidget::restoreState (QSettings &settings)
@@ -139,6 +158,8 @@ void SearchWidget::restoreState (QSettings &settings)
   recursive_->setChecked (settings.value (qs_recursive, true).toBool ());
   caseSensitive_->setChecked (settings.value (qs_caseSensitive, false).toBool ());
   wordOnly_->setChecked (settings.value (qs_wordOnly, false).toBool ());
+  skipIgnored_->setChecked (settings.value (qs_skipIgnored, true).toBool ());
+  excludes_->setText (settings.value (qs_excludes, defaultExcludes).toString ());
 }
 
 void SearchWidget::setRunning (bool isRunning)
@@ -167,6 +188,8 @@ void SearchWidget::start ()
   const auto caseSence = caseSensitive_->isChecked () ? Qt::CaseSensitive
                                                       : Qt::CaseInsensitive;
   searcher_->setText (text_->text (), caseSence, wordOnly_->isChecked ());
+  searcher_->setIgnoreRules (skipIgnored_->isChecked (),
+                             excludes_->text ().split (',', QString::SkipEmptyParts));
 
   searcher_->startAsync (dirs);
 
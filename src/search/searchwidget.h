@@ -39,9 +39,11 @@ private:
   QLineEdit *dir_;
   QLineEdit *filePattern_;
   QLineEdit *text_;
+  QLineEdit *excludes_;
   QCheckBox *recursive_;
   QCheckBox *caseSensitive_;
   QCheckBox *wordOnly_;
+  QCheckBox *skipIgnored_;
   QDialogButtonBox *buttons_;
   QTreeView *results_;
 
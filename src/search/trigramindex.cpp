@@ -0,0 +1,892 @@
+#include "trigramindex.h"
+#include "settingsmanager.h"
+#include "decompressingdevice.h"
+#include "debug.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+struct TrigramIndexState
+{
+  QMutex mutex;
+  TrigramIndex *owner;
+  QStringList roots; // wanted ones, updates of others are aborted
+  QHash<QString, QSharedPointer<const TrigramIndex::Table> > tables; // ready for owner
+  QStringList finished; // roots with ended updates
+};
+
+namespace
+{
+const char magic[8] = {'M', 'D', 'T', 'R', 'I', 'G', 'R', '\0'};
+const quint32 version = 1;
+const quint32 trigramLimit = 1 << 21; // 7 bits per ascii byte
+const quint32 noFile = 0xffffffff;
+const qint64 maxIndexedSize = 8 * 1024 * 1024;
+const int maxPostings = 128 * 1024 * 1024;
+const int readBlockSize = 64 * 1024;
+const int abortCheckFiles = 256;
+const int updateIntervalMs = 60 * 60 * 1000;
+const int changeDelayMs = 30000;
+
+TrigramIndex *instance_ = nullptr;
+
+// File layout: header, files, trigrams, postings, paths, root. Files are
+// sorted by their zero terminated UTF-8 paths relative to root, trigrams by
+// key, postings of every trigram are sorted ids of files.
+struct Header
+{
+  char magic[8];
+  quint32 version;
+  quint32 fileCount;
+  quint32 trigramCount;
+  quint32 postingCount;
+  quint32 pathsSize;
+  quint32 rootSize;
+  qint64 builtAt; // msecs since epoch
+};
+
+enum FileFlag : quint32
+{
+  IsUnindexed = 0x01 // too big or unreadable, always searched
+};
+
+struct FileRecord
+{
+  qint64 modified; // msecs since epoch
+  qint64 size;
+  quint32 path; // offset in paths
+  quint32 flags;
+};
+
+struct TrigramRecord
+{
+  quint32 key;
+  quint32 first; // offset in postings
+  quint32 count;
+};
+
+QString contentDir ()
+{
+  return QStandardPaths::writableLocation (QStandardPaths::CacheLocation) +
+         QLatin1String ("/content");
+}
+
+QString tableName (const QString &root)
+{
+  return QString::fromLatin1 (QCryptographicHash::hash (root.toUtf8 (),
+                                                        QCryptographicHash::Md5).toHex ()) +
+         QLatin1String (".idx");
+}
+
+QString tablePath (const QString &dir, const QString &root)
+{
+  return dir + QLatin1Char ('/') + tableName (root);
+}
+
+QString childPath (const QString &dir, const QString &name)
+{
+  return dir.endsWith (QLatin1Char ('/')) ? dir + name : dir + QLatin1Char ('/') + name;
+}
+
+bool isUnder (const QString &path, const QString &root)
+{
+  if (!path.startsWith (root))
+  {
+    return false;
+  }
+  return path.size () == root.size () || root.endsWith (QLatin1Char ('/')) ||
+         path.at (root.size ()) == QLatin1Char ('/');
+}
+
+//! Path must be under root.
+QByteArray relativePath (const QString &path, const QString &root)
+{
+  const auto start = root.size () + (root.endsWith (QLatin1Char ('/')) ? 0 : 1);
+  return path.mid (start).toUtf8 ();
+}
+
+// Keys of sequences of three ascii bytes, lowercased so both case sensitive and
+// insensitive searches can use them. Sequences with other bytes are skipped:
+// case of non ascii text depends on encoding.
+class TrigramReader
+{
+public:
+  template <class Handler>
+  void add (const char *data, int size, Handler handler)
+  {
+    for (auto i = 0; i < size; ++i)
+    {
+      auto c = quint8 (data[i]);
+      if (c >= 0x80)
+      {
+        valid_ = 0;
+        continue;
+      }
+      if (c >= 'A' && c <= 'Z')
+      {
+        c += 'a' - 'A';
+      }
+      key_ = ((key_ << 7) | c) & (trigramLimit - 1);
+      if (++valid_ >= 3)
+      {
+        handler (key_);
+      }
+    }
+  }
+
+private:
+  quint32 key_{0};
+  int valid_{0};
+};
+}
+
+
+class TrigramIndex::Table
+{
+public:
+  Table ();
+  bool parse (const char *data, qint64 size);
+
+  //! Index of file or -1.
+  int findFile (const QByteArray &path) const;
+  const TrigramRecord *findTrigram (quint32 key) const;
+
+  QFile file;
+  QByteArray memory;
+  QString root;
+  const Header *header;
+  const FileRecord *files;
+  const TrigramRecord *trigrams;
+  const quint32 *postings;
+  const char *paths;
+};
+
+TrigramIndex::Table::Table () :
+  file (),
+  memory (),
+  root (),
+  header (nullptr),
+  files (nullptr),
+  trigrams (nullptr),
+  postings (nullptr),
+  paths (nullptr)
+{
+}
+
+bool TrigramIndex::Table::parse (const char *data, qint64 size)
+{
+  if (size < qint64 (sizeof (Header)))
+  {
+    return false;
+  }
+  const auto *h = reinterpret_cast<const Header *>(data);
+  if (std::memcmp (h->magic, magic, sizeof (magic)) != 0 || h->version != version)
+  {
+    return false;
+  }
+  const auto expected = qint64 (sizeof (Header)) +
+                        qint64 (h->fileCount) * qint64 (sizeof (FileRecord)) +
+                        qint64 (h->trigramCount) * qint64 (sizeof (TrigramRecord)) +
+                        qint64 (h->postingCount) * qint64 (sizeof (quint32)) +
+                        h->pathsSize + h->rootSize;
+  if (size != expected || (h->pathsSize && data[size - h->rootSize - 1] != '\0'))
+  {
+    return false;
+  }
+
+  auto offset = qint64 (sizeof (Header));
+  const auto *f = reinterpret_cast<const FileRecord *>(data + offset);
+  offset += qint64 (h->fileCount) * qint64 (sizeof (FileRecord));
+  const auto *t = reinterpret_cast<const TrigramRecord *>(data + offset);
+  offset += qint64 (h->trigramCount) * qint64 (sizeof (TrigramRecord));
+  const auto *p = reinterpret_cast<const quint32 *>(data + offset);
+  offset += qint64 (h->postingCount) * qint64 (sizeof (quint32));
+  const auto *names = data + offset;
+  offset += h->pathsSize;
+
+  for (quint32 i = 0; i < h->fileCount; ++i)
+  {
+    if (f[i].path >= h->pathsSize)
+    {
+      return false;
+    }
+  }
+  for (quint32 i = 0; i < h->trigramCount; ++i)
+  {
+    if (qint64 (t[i].first) + t[i].count > h->postingCount)
+    {
+      return false;
+    }
+  }
+  for (quint32 i = 0; i < h->postingCount; ++i)
+  {
+    if (p[i] >= h->fileCount)
+    {
+      return false;
+    }
+  }
+
+  header = h;
+  files = f;
+  trigrams = t;
+  postings = p;
+  paths = names;
+  root = QString::fromUtf8 (data + offset, int (h->rootSize));
+  return true;
+}
+
+int TrigramIndex::Table::findFile (const QByteArray &path) const
+{
+  const auto *end = files + header->fileCount;
+  const auto *names = paths;
+  const auto it = std::lower_bound (files, end, path.constData (),
+                                    [names](const FileRecord &l, const char *r) {
+                                      return std::strcmp (names + l.path, r) < 0;
+                                    });
+  if (it == end || std::strcmp (names + it->path, path.constData ()) != 0)
+  {
+    return -1;
+  }
+  return int (it - files);
+}
+
+const TrigramRecord *TrigramIndex::Table::findTrigram (quint32 key) const
+{
+  const auto *end = trigrams + header->trigramCount;
+  const auto it = std::lower_bound (trigrams, end, key,
+                                    [](const TrigramRecord &l, quint32 r) {return l.key < r;});
+  return (it != end && it->key == key) ? it : nullptr;
+}
+
+
+namespace
+{
+using Table = TrigramIndex::Table;
+
+//! Table of root written to path, null if missing or damaged.
+QSharedPointer<const Table> mapTable (const QString &path, const QString &root)
+{
+  QSharedPointer<Table> table (new Table);
+  table->file.setFileName (path);
+  if (!table->file.open (QFile::ReadOnly))
+  {
+    return {};
+  }
+
+  const auto size = table->file.size ();
+  const auto *data = reinterpret_cast<const char *>(table->file.map (0, size));
+  if (!data || !table->parse (data, size) || table->root != root)
+  {
+    LWARNING () << "Content index is not usable" << LARG (table->file.fileName ());
+    return {};
+  }
+  LDEBUG () << "Loaded content index of" << table->header->fileCount << "files" << LARG (root);
+  return table;
+}
+
+class IndexTask : public QRunnable
+{
+public:
+  IndexTask (const QString &root, const QString &path,
+             const QSharedPointer<const Table> &previous,
+             const QSharedPointer<TrigramIndexState> &state) :
+    root_ (root),
+    path_ (path),
+    previous_ (previous),
+    state_ (state),
+    seen_ (int (trigramLimit)),
+    touched_ ()
+  {
+  }
+
+  void run () override;
+
+private:
+  struct File
+  {
+    QByteArray path;
+    qint64 modified;
+    qint64 size;
+  };
+
+  bool isWanted () const;
+  QByteArray build ();
+  QSharedPointer<const Table> store (const QByteArray &data) const;
+  void deliver (const QSharedPointer<const Table> &table, bool isFinished) const;
+  bool read (const QString &path, quint32 id, QHash<quint32, QVector<quint32> > &postings);
+
+  QString root_;
+  QString path_; // of written table
+  QSharedPointer<const Table> previous_;
+  QSharedPointer<TrigramIndexState> state_;
+  QBitArray seen_; // trigrams of current file
+  QVector<quint32> touched_;
+};
+
+void IndexTask::run ()
+{
+  QThread::currentThread ()->setPriority (QThread::IdlePriority);
+
+  // written table is checked here, not at start, and serves while updating
+  if (!previous_ && isWanted ())
+  {
+    previous_ = mapTable (path_, root_);
+    if (previous_)
+    {
+      deliver (previous_, false);
+    }
+  }
+
+  const auto data = build ();
+  deliver (data.isEmpty () ? QSharedPointer<const Table> () : store (data), true);
+}
+
+//! Written and mapped table, the built one if writing fails.
+QSharedPointer<const Table> IndexTask::store (const QByteArray &data) const
+{
+  QDir ().mkpath (QFileInfo (path_).absolutePath ());
+  QSaveFile file (path_);
+  if (!file.open (QSaveFile::WriteOnly) || file.write (data) != data.size () ||
+      !file.commit ())
+  {
+    LWARNING () << "Failed to write content index" << LARG (path_) << file.errorString ();
+  }
+  else if (const auto mapped = mapTable (path_, root_))
+  {
+    return mapped;
+  }
+
+  QSharedPointer<Table> table (new Table);
+  table->memory = data;
+  if (!table->parse (table->memory.constData (), table->memory.size ()))
+  {
+    LWARNING () << "Built content index is not usable" << LARG (root_);
+    return {};
+  }
+  return table;
+}
+
+void IndexTask::deliver (const QSharedPointer<const Table> &table, bool isFinished) const
+{
+  QMutexLocker locker (&state_->mutex);
+  if (!state_->owner)
+  {
+    return;
+  }
+  if (table)
+  {
+    state_->tables.insert (root_, table);
+  }
+  if (isFinished)
+  {
+    state_->finished.append (root_);
+  }
+  QMetaObject::invokeMethod (state_->owner, "takeTables", Qt::QueuedConnection);
+}
+
+bool IndexTask::isWanted () const
+{
+  QMutexLocker locker (&state_->mutex);
+  return state_->owner && state_->roots.contains (root_);
+}
+
+QByteArray IndexTask::build ()
+{
+  QElapsedTimer timer;
+  timer.start ();
+
+  // symbolic links are not followed so the walk can not loop
+  QVector<File> files;
+  QDirIterator it (root_, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+  while (it.hasNext ())
+  {
+    it.next ();
+    if (files.size () % abortCheckFiles == 0 && !isWanted ())
+    {
+      return {};
+    }
+    const auto info = it.fileInfo ();
+    files.append ({relativePath (it.filePath (), root_),
+                   info.lastModified ().toMSecsSinceEpoch (), info.size ()});
+  }
+  std::sort (files.begin (), files.end (), [](const File &l, const File &r) {
+    return std::strcmp (l.path.constData (), r.path.constData ()) < 0;
+  });
+
+  // new ids of unchanged files keep order of old ones, because both are sorted
+  const auto oldCount = previous_ ? previous_->header->fileCount : 0;
+  QVector<quint32> remap (int (oldCount), noFile);
+  QVector<quint32> flags (files.size (), 0);
+  QHash<quint32, QVector<quint32> > fresh; // postings of read files
+  auto readCount = 0;
+  for (auto id = 0, end = files.size (); id < end; ++id)
+  {
+    const auto &file = files[id];
+    const auto old = previous_ ? previous_->findFile (file.path) : -1;
+    if (old != -1)
+    {
+      const auto &record = previous_->files[old];
+      if (!(record.flags & IsUnindexed) && record.modified == file.modified &&
+          record.size == file.size)
+      {
+        remap[old] = quint32 (id);
+        continue;
+      }
+    }
+
+    if (++readCount % abortCheckFiles == 0 && !isWanted ())
+    {
+      return {};
+    }
+    if (file.size > maxIndexedSize ||
+        !read (childPath (root_, QString::fromUtf8 (file.path)), quint32 (id), fresh))
+    {
+      flags[id] = IsUnindexed;
+    }
+  }
+
+  auto freshKeys = fresh.keys ();
+  std::sort (freshKeys.begin (), freshKeys.end ());
+
+  QVector<TrigramRecord> trigrams;
+  QVector<quint32> postings;
+  QVector<quint32> kept;
+  const auto oldTrigrams = previous_ ? previous_->header->trigramCount : 0;
+  quint32 oldIndex = 0;
+  auto freshIndex = 0;
+  while (oldIndex < oldTrigrams || freshIndex < freshKeys.size ())
+  {
+    const auto *old = (oldIndex < oldTrigrams ? previous_->trigrams + oldIndex : nullptr);
+    const auto key = (!old ? freshKeys[freshIndex]
+                      : freshIndex == freshKeys.size () ? old->key
+                      : std::min (old->key, freshKeys[freshIndex]));
+
+    kept.clear ();
+    if (old && old->key == key)
+    {
+      for (auto i = old->first, end = old->first + old->count; i < end; ++i)
+      {
+        const auto id = remap[int (previous_->postings[i])];
+        if (id != noFile)
+        {
+          kept.append (id);
+        }
+      }
+      ++oldIndex;
+    }
+    QVector<quint32> added;
+    if (freshIndex < freshKeys.size () && freshKeys[freshIndex] == key)
+    {
+      added = fresh.value (key);
+      ++freshIndex;
+    }
+
+    const auto first = postings.size ();
+    if (first + kept.size () + added.size () > maxPostings)
+    {
+      LWARNING () << "Content index is too big" << LARG (root_);
+      return {};
+    }
+    std::merge (kept.cbegin (), kept.cend (), added.cbegin (), added.cend (),
+                std::back_inserter (postings));
+    if (postings.size () > first)
+    {
+      trigrams.append ({key, quint32 (first), quint32 (postings.size () - first)});
+    }
+  }
+
+  QByteArray paths;
+  QVector<FileRecord> records;
+  records.reserve (files.size ());
+  for (auto id = 0, end = files.size (); id < end; ++id)
+  {
+    const auto &file = files[id];
+    records.append ({file.modified, file.size, quint32 (paths.size ()), flags[id]});
+    paths.append (file.path).append ('\0');
+  }
+  const auto root = root_.toUtf8 ();
+
+  Header header;
+  std::memcpy (header.magic, magic, sizeof (magic));
+  header.version = version;
+  header.fileCount = quint32 (records.size ());
+  header.trigramCount = quint32 (trigrams.size ());
+  header.postingCount = quint32 (postings.size ());
+  header.pathsSize = quint32 (paths.size ());
+  header.rootSize = quint32 (root.size ());
+  header.builtAt = QDateTime::currentMSecsSinceEpoch ();
+
+  QByteArray result;
+  result.reserve (int (sizeof (header)) + records.size () * int (sizeof (FileRecord)) +
+                  trigrams.size () * int (sizeof (TrigramRecord)) +
+                  postings.size () * int (sizeof (quint32)) + paths.size () + root.size ());
+  result.append (reinterpret_cast<const char *>(&header), sizeof (header));
+  result.append (reinterpret_cast<const char *>(records.constData ()),
+                 records.size () * int (sizeof (FileRecord)));
+  result.append (reinterpret_cast<const char *>(trigrams.constData ()),
+                 trigrams.size () * int (sizeof (TrigramRecord)));
+  result.append (reinterpret_cast<const char *>(postings.constData ()),
+                 postings.size () * int (sizeof (quint32)));
+  result.append (paths).append (root);
+
+  LDEBUG () << "Indexed contents of" << files.size () << "files in" << LARG (root_)
+            << "read" << readCount << "in" << timer.elapsed () << "ms";
+  return result;
+}
+
+bool IndexTask::read (const QString &path, quint32 id,
+                      QHash<quint32, QVector<quint32> > &postings)
+{
+  QFile file (path);
+  if (!file.open (QFile::ReadOnly))
+  {
+    return false;
+  }
+  // searcher matches decompressed contents
+  if (DecompressingDevice::format (file.peek (DecompressingDevice::headerSize)) !=
+      DecompressingDevice::Format::None)
+  {
+    return false;
+  }
+
+  TrigramReader reader;
+  QByteArray block (readBlockSize, Qt::Uninitialized);
+  auto isOk = true;
+  while (true)
+  {
+    const auto size = file.read (block.data (), readBlockSize);
+    if (size <= 0)
+    {
+      isOk = (size == 0);
+      break;
+    }
+    reader.add (block.constData (), int (size), [this](quint32 key) {
+      if (!seen_.testBit (int (key)))
+      {
+        seen_.setBit (int (key));
+        touched_.append (key);
+      }
+    });
+  }
+
+  for (const auto key: touched_)
+  {
+    if (isOk)
+    {
+      postings[key].append (id);
+    }
+    seen_.clearBit (int (key));
+  }
+  touched_.clear ();
+  return isOk;
+}
+}
+
+
+TrigramIndex::Filter::Filter () :
+  roots_ ()
+{
+}
+
+TrigramIndex::Filter::Filter (const Tables &tables, const QByteArray &text) :
+  roots_ ()
+{
+  QVector<quint32> keys;
+  TrigramReader reader;
+  reader.add (text.constData (), text.size (), [&keys](quint32 key) {
+    if (!keys.contains (key))
+    {
+      keys.append (key);
+    }
+  });
+  if (keys.isEmpty ())
+  {
+    return;
+  }
+
+  for (const auto &table: tables)
+  {
+    Root root {table, QBitArray (int (table->header->fileCount))};
+
+    QVector<const TrigramRecord *> lists;
+    for (const auto key: keys)
+    {
+      const auto *list = table->findTrigram (key);
+      if (!list)
+      {
+        lists.clear ();
+        break;
+      }
+      lists.append (list);
+    }
+
+    if (!lists.isEmpty ())
+    {
+      // shortest first, so intersections stay small
+      std::sort (lists.begin (), lists.end (),
+                 [](const TrigramRecord *l, const TrigramRecord *r) {return l->count < r->count;});
+      const auto *postings = table->postings;
+      QVector<quint32> ids;
+      ids.reserve (int (lists[0]->count));
+      std::copy (postings + lists[0]->first, postings + lists[0]->first + lists[0]->count,
+                 std::back_inserter (ids));
+      QVector<quint32> next;
+      for (auto i = 1, end = lists.size (); i < end && !ids.isEmpty (); ++i)
+      {
+        const auto *list = postings + lists[i]->first;
+        next.clear ();
+        std::set_intersection (ids.cbegin (), ids.cend (), list, list + lists[i]->count,
+                               std::back_inserter (next));
+        std::swap (ids, next);
+      }
+      for (const auto id: ids)
+      {
+        root.files.setBit (int (id));
+      }
+    }
+    roots_.append (root);
+  }
+}
+
+bool TrigramIndex::Filter::mayContain (const QFileInfo &file) const
+{
+  if (roots_.isEmpty ())
+  {
+    return true;
+  }
+
+  const auto path = file.absoluteFilePath ();
+  for (const auto &i: roots_)
+  {
+    const auto &table = *i.table;
+    if (!isUnder (path, table.root) || path.size () == table.root.size ())
+    {
+      continue;
+    }
+
+    const auto index = table.findFile (relativePath (path, table.root));
+    if (index == -1)
+    {
+      return true;
+    }
+    const auto &record = table.files[index];
+    if ((record.flags & IsUnindexed) || record.size != file.size () ||
+        record.modified != file.lastModified ().toMSecsSinceEpoch ())
+    {
+      return true;
+    }
+    return i.files.testBit (index);
+  }
+  return true;
+}
+
+
+void TrigramIndex::init ()
+{
+  instance_ = new TrigramIndex (contentDir ());
+  SettingsManager::subscribeForUpdates (instance_);
+  instance_->updateSettings ();
+}
+
+TrigramIndex &TrigramIndex::instance ()
+{
+  return *instance_;
+}
+
+TrigramIndex::TrigramIndex (const QString &dir, QObject *parent) :
+  QObject (parent),
+  dir_ (dir),
+  state_ (new TrigramIndexState),
+  pool_ (new QThreadPool), // not owned: workers may hang on dead mounts
+  updateTimer_ (new QTimer (this)),
+  changeTimer_ (new QTimer (this)),
+  roots_ (),
+  tables_ (),
+  updating_ (),
+  changed_ ()
+{
+  state_->owner = this;
+  pool_->setMaxThreadCount (1);
+
+  updateTimer_->setInterval (updateIntervalMs);
+  connect (updateTimer_, &QTimer::timeout,
+           this, [this] {
+             for (const auto &i: roots_)
+             {
+               update (i);
+             }
+           });
+
+  changeTimer_->setSingleShot (true);
+  changeTimer_->setInterval (changeDelayMs);
+  connect (changeTimer_, &QTimer::timeout,
+           this, &TrigramIndex::updateChanged);
+}
+
+TrigramIndex::~TrigramIndex ()
+{
+  QMutexLocker locker (&state_->mutex);
+  state_->owner = nullptr;
+}
+
+TrigramIndex::Tables TrigramIndex::tables () const
+{
+  Tables result;
+  result.reserve (tables_.size ());
+  for (const auto &i: tables_)
+  {
+    result.append (i);
+  }
+  return result;
+}
+
+bool TrigramIndex::isUpdating () const
+{
+  return !updating_.isEmpty ();
+}
+
+void TrigramIndex::refresh (const QString &path)
+{
+  for (const auto &i: roots_)
+  {
+    if (isUnder (path, i))
+    {
+      changed_.insert (i);
+      if (!changeTimer_->isActive ())
+      {
+        changeTimer_->start ();
+      }
+      return;
+    }
+  }
+}
+
+void TrigramIndex::updateSettings ()
+{
+  SettingsManager settings;
+  QStringList roots;
+  for (const auto &i: settings.get (SettingsManager::ContentIndexRoots).toString ().split (QLatin1Char (',')))
+  {
+    const auto root = QDir::cleanPath (QDir::fromNativeSeparators (i.trimmed ()));
+    if (!i.trimmed ().isEmpty () && !roots.contains (root))
+    {
+      roots << root;
+    }
+  }
+  setRoots (roots);
+}
+
+void TrigramIndex::setRoots (const QStringList &roots)
+{
+  if (roots == roots_)
+  {
+    return;
+  }
+  roots_ = roots;
+  {
+    QMutexLocker locker (&state_->mutex);
+    state_->roots = roots_;
+  }
+
+  QStringList names;
+  for (auto it = tables_.begin (); it != tables_.end ();)
+  {
+    it = (roots_.contains (it.key ()) ? std::next (it) : tables_.erase (it));
+  }
+  for (const auto &i: roots_)
+  {
+    names << tableName (i);
+    update (i);
+  }
+
+  QDir dir (dir_);
+  for (const auto &i: dir.entryList ({QLatin1String ("*.idx")}, QDir::Files))
+  {
+    if (!names.contains (i))
+    {
+      dir.remove (i);
+    }
+  }
+
+  if (roots_.isEmpty ())
+  {
+    updateTimer_->stop ();
+  }
+  else
+  {
+    updateTimer_->start ();
+  }
+}
+
+void TrigramIndex::takeTables ()
+{
+  QHash<QString, QSharedPointer<const Table> > tables;
+  QStringList finished;
+  {
+    QMutexLocker locker (&state_->mutex);
+    tables.swap (state_->tables);
+    finished.swap (state_->finished);
+  }
+
+  for (const auto &i: finished)
+  {
+    updating_.remove (i);
+  }
+  auto isChanged = false;
+  for (auto it = tables.cbegin (), end = tables.cend (); it != end; ++it)
+  {
+    if (roots_.contains (it.key ()))
+    {
+      tables_[it.key ()] = it.value ();
+      isChanged = true;
+    }
+  }
+  if (isChanged)
+  {
+    emit updated ();
+  }
+}
+
+void TrigramIndex::update (const QString &root)
+{
+  if (updating_.contains (root))
+  {
+    // the running update may miss changes, so repeat it after
+    changed_.insert (root);
+    if (!changeTimer_->isActive ())
+    {
+      changeTimer_->start ();
+    }
+    return;
+  }
+  updating_.insert (root);
+  pool_->start (new IndexTask (root, tablePath (dir_, root), tables_.value (root), state_));
+}
+
+void TrigramIndex::updateChanged ()
+{
+  const auto changed = changed_;
+  changed_.clear ();
+  for (const auto &i: changed)
+  {
+    update (i);
+  }
+}
+
+#include "moc_trigramindex.cpp"
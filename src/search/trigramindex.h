@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QBitArray>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QStringList>
+
+class QFileInfo;
+class QTimer;
+class QThreadPool;
+struct TrigramIndexState;
+
+// Three byte sequences of file contents under configured roots, with the
+// files containing each of them. A text can be only in files that contain all
+// of its sequences, so text search reads just them. Every root is kept in its
+// own memory mapped file and updated in background: only files with changed
+// modification time or size are read again.
+class TrigramIndex : public QObject
+{
+Q_OBJECT
+public:
+  class Table;
+  using Tables = QVector<QSharedPointer<const Table> >;
+
+  // Files of indexed roots that may contain a text. Thread safe.
+  class Filter
+  {
+  public:
+    Filter ();
+    //! Text is in encoding of files, it is matched case insensitively.
+    Filter (const Tables &tables, const QByteArray &text);
+
+    //! False only for indexed files that are not changed since indexing and
+    //! can not contain the text.
+    bool mayContain (const QFileInfo &file) const;
+
+  private:
+    struct Root
+    {
+      QSharedPointer<const Table> table;
+      QBitArray files;
+    };
+    QVector<Root> roots_;
+  };
+
+  //! Application index follows settings.
+  static void init ();
+  static TrigramIndex &instance ();
+
+  //! Tables are kept in dir.
+  explicit TrigramIndex (const QString &dir, QObject *parent = nullptr);
+  ~TrigramIndex ();
+
+  //! Cleaned absolute paths.
+  void setRoots (const QStringList &roots);
+
+  //! Current snapshots, they stay valid after the index is updated.
+  Tables tables () const;
+  bool isUpdating () const;
+
+  //! Updates root of path later.
+  void refresh (const QString &path);
+
+signals:
+  void updated ();
+
+public slots:
+  void updateSettings ();
+
+private slots:
+  void takeTables ();
+
+private:
+  void update (const QString &root);
+  void updateChanged ();
+
+  QString dir_;
+  QSharedPointer<TrigramIndexState> state_;
+  QThreadPool *pool_;
+  QTimer *updateTimer_;
+  QTimer *changeTimer_;
+  QStringList roots_;
+  QHash<QString, QSharedPointer<const Table> > tables_; // by root
+  QSet<QString> updating_;
+  QSet<QString> changed_;
+};
@@ -0,0 +1,318 @@
+#include "frecencystore.h"
+#include "namefilter.h"
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace
+{
+const quint32 magic = 0x4d44465a; // MDFZ
+const quint32 version = 1;
+const int maxEntries = 5000;
+const float maxTotalRank = 10000;
+const float agingFactor = 0.9f;
+const float minRank = 1;
+const float nameBonus = 4;
+const int saveDelayMs = 10000;
+
+FrecencyStore *instance_ = nullptr;
+
+QString storePath ()
+{
+  return QStandardPaths::writableLocation (QStandardPaths::AppDataLocation) +
+         QLatin1String ("/visits.dat");
+}
+
+qint64 now ()
+{
+  return QDateTime::currentMSecsSinceEpoch () / 1000;
+}
+
+//! Recent visits weigh more.
+float frecency (float rank, qint64 visitedAt, qint64 current)
+{
+  const auto age = current - visitedAt;
+  if (age < 60 * 60)
+  {
+    return rank * 4;
+  }
+  if (age < 24 * 60 * 60)
+  {
+    return rank * 2;
+  }
+  if (age < 7 * 24 * 60 * 60)
+  {
+    return rank / 2;
+  }
+  return rank / 4;
+}
+}
+
+
+void FrecencyStore::init ()
+{
+  instance_ = new FrecencyStore (storePath ());
+}
+
+FrecencyStore &FrecencyStore::instance ()
+{
+  return *instance_;
+}
+
+FrecencyStore::FrecencyStore (const QString &path, QObject *parent) :
+  QObject (parent),
+  path_ (path),
+  entries_ (),
+  indexes_ (),
+  lastPath_ (),
+  totalRank_ (0),
+  saveTimer_ (new QTimer (this))
+{
+  saveTimer_->setSingleShot (true);
+  saveTimer_->setInterval (saveDelayMs);
+  connect (saveTimer_, &QTimer::timeout,
+           this, &FrecencyStore::save);
+  connect (qApp, &QCoreApplication::aboutToQuit,
+           this, [this] {
+             if (saveTimer_->isActive ())
+             {
+               saveTimer_->stop ();
+               save ();
+             }
+           });
+
+  load ();
+}
+
+FrecencyStore::~FrecencyStore () = default;
+
+void FrecencyStore::addVisit (const QString &path)
+{
+  const auto cleaned = QDir::cleanPath (path);
+  if (cleaned.isEmpty () || cleaned == lastPath_)
+  {
+    return;
+  }
+  lastPath_ = cleaned;
+
+  const auto it = indexes_.constFind (cleaned);
+  if (it != indexes_.constEnd ())
+  {
+    auto &entry = entries_[it.value ()];
+    entry.rank += 1;
+    entry.visitedAt = now ();
+  }
+  else
+  {
+    indexes_.insert (cleaned, entries_.size ());
+    entries_.append ({cleaned, cleaned.toCaseFolded (), 1, now ()});
+  }
+  totalRank_ += 1;
+
+  if (totalRank_ > maxTotalRank || entries_.size () > maxEntries)
+  {
+    age ();
+  }
+
+  if (!saveTimer_->isActive ())
+  {
+    saveTimer_->start ();
+  }
+}
+
+void FrecencyStore::remove (const QString &path)
+{
+  const auto index = indexes_.value (QDir::cleanPath (path), -1);
+  if (index == -1)
+  {
+    return;
+  }
+  totalRank_ -= entries_[index].rank;
+  removeAt (index);
+
+  if (!saveTimer_->isActive ())
+  {
+    saveTimer_->start ();
+  }
+}
+
+QStringList FrecencyStore::find (const QString &query, int limit) const
+{
+  QStringList terms;
+  for (const auto &i: query.split (QLatin1Char (' '), QString::SkipEmptyParts))
+  {
+    terms << QDir::fromNativeSeparators (i).toCaseFolded ();
+  }
+  if (terms.isEmpty () || limit < 1)
+  {
+    return {};
+  }
+
+  const auto current = now ();
+  QVector<QPair<float, int> > scored; // by index
+  for (auto i = 0, end = entries_.size (); i < end; ++i)
+  {
+    const auto &entry = entries_[i];
+    auto from = 0;
+    for (const auto &term: terms)
+    {
+      const auto index = entry.folded.indexOf (term, from);
+      from = (index == -1 ? -1 : index + term.size ());
+      if (from == -1)
+      {
+        break;
+      }
+    }
+    if (from == -1)
+    {
+      continue;
+    }
+    const auto isInName = (from - terms.last ().size () >
+                           entry.folded.lastIndexOf (QLatin1Char ('/')));
+    scored.append ({frecency (entry.rank, entry.visitedAt, current) * (isInName ? nameBonus : 1),
+                    i});
+  }
+
+  if (scored.isEmpty ())
+  {
+    const NameFilter filter (terms.join (QString ()), NameFilter::Mode::Fuzzy);
+    for (auto i = 0, end = entries_.size (); i < end; ++i)
+    {
+      const auto &entry = entries_[i];
+      const auto score = filter.score (entry.path.mid (entry.path.lastIndexOf (QLatin1Char ('/')) + 1));
+      if (score >= 0)
+      {
+        scored.append ({frecency (entry.rank, entry.visitedAt, current) * (score + 1), i});
+      }
+    }
+  }
+
+  const auto count = std::min (limit, scored.size ());
+  std::partial_sort (scored.begin (), scored.begin () + count, scored.end (),
+                     [](const QPair<float, int> &l, const QPair<float, int> &r) {
+                       return l.first > r.first;
+                     });
+  QStringList result;
+  for (auto i = 0; i < count; ++i)
+  {
+    result << entries_[scored[i].second].path;
+  }
+  return result;
+}
+
+void FrecencyStore::load ()
+{
+  QFile file (path_);
+  if (!file.open (QFile::ReadOnly))
+  {
+    return;
+  }
+
+  QDataStream stream (&file);
+  stream.setVersion (QDataStream::Qt_5_6);
+  stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+  quint32 fileMagic = 0, fileVersion = 0, count = 0;
+  stream >> fileMagic >> fileVersion >> count;
+  if (fileMagic != magic || fileVersion != version || count > quint32 (maxEntries) * 2)
+  {
+    LWARNING () << "Unknown visits format" << LARG (file.fileName ());
+    return;
+  }
+
+  entries_.reserve (int (count));
+  for (quint32 i = 0; i < count && stream.status () == QDataStream::Ok; ++i)
+  {
+    QByteArray path;
+    Entry entry;
+    stream >> path >> entry.rank >> entry.visitedAt;
+    entry.path = QString::fromUtf8 (path);
+    if (entry.path.isEmpty () || indexes_.contains (entry.path))
+    {
+      continue;
+    }
+    entry.folded = entry.path.toCaseFolded ();
+    indexes_.insert (entry.path, entries_.size ());
+    entries_.append (entry);
+    totalRank_ += entry.rank;
+  }
+  LDEBUG () << "Loaded" << entries_.size () << "visited directories";
+}
+
+void FrecencyStore::save ()
+{
+  QDir ().mkpath (QFileInfo (path_).absolutePath ());
+  QSaveFile file (path_);
+  if (!file.open (QSaveFile::WriteOnly))
+  {
+    LWARNING () << "Failed to save visits" << LARG (path_) << file.errorString ();
+    return;
+  }
+
+  QDataStream stream (&file);
+  stream.setVersion (QDataStream::Qt_5_6);
+  stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+  stream << magic << version << quint32 (entries_.size ());
+  for (const auto &i: entries_)
+  {
+    stream << i.path.toUtf8 () << i.rank << i.visitedAt;
+  }
+  if (stream.status () != QDataStream::Ok || !file.commit ())
+  {
+    LWARNING () << "Failed to save visits" << LARG (path_) << file.errorString ();
+  }
+}
+
+void FrecencyStore::age ()
+{
+  const auto current = now ();
+  for (auto &i: entries_)
+  {
+    i.rank *= agingFactor;
+  }
+  entries_.erase (std::remove_if (entries_.begin (), entries_.end (),
+                                  [](const Entry &i) {return i.rank < minRank;}),
+                  entries_.end ());
+
+  // leave room so the next visits do not trigger aging again
+  const auto kept = maxEntries - maxEntries / 10;
+  if (entries_.size () > kept)
+  {
+    std::partial_sort (entries_.begin (), entries_.begin () + kept, entries_.end (),
+                       [current](const Entry &l, const Entry &r) {
+                         return frecency (l.rank, l.visitedAt, current) >
+                                frecency (r.rank, r.visitedAt, current);
+                       });
+    entries_.resize (kept);
+  }
+
+  indexes_.clear ();
+  totalRank_ = 0;
+  for (auto i = 0, end = entries_.size (); i < end; ++i)
+  {
+    indexes_.insert (entries_[i].path, i);
+    totalRank_ += entries_[i].rank;
+  }
+}
+
+void FrecencyStore::removeAt (int index)
+{
+  const auto last = entries_.size () - 1;
+  indexes_.remove (entries_[index].path);
+  if (index != last)
+  {
+    entries_[index] = entries_[last];
+    indexes_[entries_[index].path] = index;
+  }
+  entries_.removeLast ();
+}
+
+#include "moc_frecencystore.cpp"
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+
+class QTimer;
+
+// Visited directories of all views ranked by how often and how recently they
+// were opened. Ranks of all directories decay when their sum grows, so the
+// store stays small and old habits fade. Kept in a binary file.
+class FrecencyStore : public QObject
+{
+Q_OBJECT
+public:
+  static void init ();
+  static FrecencyStore &instance ();
+
+  //! Visits are kept in path.
+  explicit FrecencyStore (const QString &path, QObject *parent = nullptr);
+  ~FrecencyStore ();
+
+  void addVisit (const QString &path);
+  void remove (const QString &path);
+
+  //! Space separated parts of query must be contained in path in the same
+  //! order, paths with the last part in their name go first. If nothing
+  //! matches, names are matched fuzzily. Best first.
+  QStringList find (const QString &query, int limit) const;
+
+private:
+  struct Entry
+  {
+    QString path;
+    QString folded;
+    float rank;
+    qint64 visitedAt; // secs since epoch
+  };
+
+  void load ();
+  void save ();
+  void age ();
+  void removeAt (int index);
+
+  QString path_;
+  QVector<Entry> entries_;
+  QHash<QString, int> indexes_; // by path
+  QString lastPath_;
+  float totalRank_;
+  QTimer *saveTimer_;
+};
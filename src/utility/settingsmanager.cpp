@@ -42,6 +42,8 @@ QVector<Entry> entries = [] {
   SET (CheckUpdates) = {QS ("checkUpdates"), false};
   SET (StartInBackground) = {QS ("startBackground"), false};
   SET (CaseSensitiveSort) = {QS ("caseSensitiveSort"), true};
+  SET (FuzzyNameFilter) = {QS ("fuzzyNameFilter"), false};
+  SET (ShowDirSizes) = {QS ("showDirSizes"), false};
   SET (ImageCacheSize) = {QS ("imageCacheSize"), 10240};
   SET (GroupIds) = {QS ("groupIds"),
                     QS ("1234567890QWERTYUIOPASDFGHJKLZXCVBNM")};
@@ -56,6 +58,9 @@ QVector<Entry> entries = [] {
   SET (ShowSelectionInfo) = {QS ("statusShowSelection"), true};
 
   SET (Style) = {QS ("style"), QS ("")};
+
+  SET (IndexedRoots) = {QS ("indexedRoots"), QS ("")};
+  SET (ContentIndexRoots) = {QS ("contentIndexRoots"), QS ("")};
 #undef SET
 
   return result;
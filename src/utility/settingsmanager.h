@@ -8,10 +8,11 @@ public:
   enum Type
   {
     OpenConsoleCommand, RunInConsoleCommand, EditorCommand,
-    CheckUpdates, StartInBackground, CaseSensitiveSort, ImageCacheSize,
+    CheckUpdates, StartInBackground, CaseSensitiveSort, FuzzyNameFilter, ShowDirSizes, ImageCacheSize,
     GroupIds, TabIds, TabSwitchOrder, Translation,
     ShowFreeSpace, ShowFilesInfo, ShowSelectionInfo,
     Style,
+    IndexedRoots, ContentIndexRoots,
     TypeCount
   };
 
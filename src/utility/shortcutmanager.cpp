@@ -151,6 +151,8 @@ void ShortcutManager::setDefaults ()
                                      {}, c};
   shortcuts[SM::Search] = {{QS ("Ctrl+Shift+F")}, QObject::tr ("Search..."),
                            QIcon (":/search.png"), c};
+  shortcuts[SM::QuickJump] = {{QS ("Ctrl+P")}, QObject::tr ("Go to indexed..."),
+                              {}, c};
 
   c = SM::Item;
   shortcuts[SM::OpenItem] = {{}, QObject::tr ("Open"),
@@ -20,7 +20,7 @@ public:
     NextTab, OpenItem, MoveUp, Settings, Quit, Debug, About, CopyTo, MoveTo, LinkTo,
     FixMinSize, RunCommand, ShowProperties, ChangePermissions, View, HistoryForward, HistoryBackward,
     AdjustColumSizes, PreviousTab, EqulalizeTabs, CopyToPath, MoveToPath, LinkToPath,
-    Search,
+    Search, QuickJump,
     ShortcutCount
   };
 
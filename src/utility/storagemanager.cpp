@@ -1,52 +1,500 @@
 #include "storagemanager.h"
 #include "debug.h"
+#include "backport.h"
 
-#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSocketNotifier>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QStorageInfo>
+
+#ifdef Q_OS_UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/sysmacros.h>
+#endif
+
+struct StorageSpaceState
+{
+  QMutex mutex;
+  StorageManager *manager;
+  QSet<QString> wanted; // roots looked up since last refresh
+  QSet<QString> pending; // roots being refreshed
+};
 
 namespace
 {
-static QList<QStorageInfo> storages{};
-static QDateTime lastCheck{};
+const int refreshIntervalMs = 5000;
+const int mountsPollIntervalMs = 10000; // if system does not report changes
+const int maxRefreshThreads = 8;
+
+StorageManager *instance_ = nullptr;
+
+struct Mount
+{
+  StorageManager::Storage storage;
+  quint64 device; // 0 if unknown
+};
 
-void update ()
+struct TrieNode
 {
-  const auto now = QDateTime::currentDateTime ();
-  const auto minDelaySec = 10;
-  if (!lastCheck.isValid () || lastCheck.secsTo (now) > minDelaySec)
+  QHash<QString, int> children; // indexes in MountTable::nodes
+  int mount{-1};
+};
+
+struct MountTable
+{
+  QReadWriteLock lock;
+  bool isLoaded{false};
+  QVector<Mount> mounts;
+  QMultiHash<quint64, int> devices; // to indexes in mounts
+  QVector<TrieNode> nodes; // by path components, first is root
+};
+
+MountTable &table ()
+{
+  static MountTable instance;
+  return instance;
+}
+
+QStringList components (const QString &path)
+{
+  return QDir::cleanPath (QDir::fromNativeSeparators (path))
+         .split (QLatin1Char ('/'), QString::SkipEmptyParts);
+}
+
+//! Device of path or of its directory if path does not exist. 0 if unknown.
+quint64 deviceOf (const QString &path)
+{
+#ifdef Q_OS_UNIX
+  struct stat st;
+  if (::stat (QFile::encodeName (path).constData (), &st) == 0 ||
+      ::stat (QFile::encodeName (QFileInfo (path).absolutePath ()).constData (), &st) == 0)
   {
-    storages.clear ();
-    for (auto &i : QStorageInfo::mountedVolumes ())
+    return quint64 (st.st_dev);
+  }
+#else
+  Q_UNUSED (path);
+#endif
+  return 0;
+}
+
+QVector<Mount> systemMounts ()
+{
+  QVector<Mount> result;
+  for (const auto &i: QStorageInfo::mountedVolumes ())
+  {
+    if (!i.isValid ())
     {
-      if (i.isValid () && i.isReady ())
+      continue;
+    }
+    Mount mount;
+    mount.storage.root = i.rootPath ();
+    mount.storage.device = QString::fromUtf8 (i.device ());
+    mount.storage.type = QString::fromUtf8 (i.fileSystemType ());
+    mount.device = deviceOf (mount.storage.root);
+    result << mount;
+  }
+  return result;
+}
+
+#ifdef Q_OS_LINUX
+QByteArray readAll (int fd)
+{
+  QByteArray result;
+  if (::lseek (fd, 0, SEEK_SET) != 0)
+  {
+    return result;
+  }
+  char buffer[16384];
+  forever
+  {
+    const auto size = ::read (fd, buffer, sizeof (buffer));
+    if (size <= 0)
+    {
+      break;
+    }
+    result.append (buffer, int (size));
+  }
+  return result;
+}
+
+//! Mountinfo escapes spaces and other separators as \ooo.
+QString unescape (const QByteArray &field)
+{
+  QByteArray result;
+  result.reserve (field.size ());
+  for (auto i = 0, end = field.size (); i < end; ++i)
+  {
+    if (field[i] == '\\' && i + 3 < end)
+    {
+      auto ok = false;
+      const auto code = field.mid (i + 1, 3).toInt (&ok, 8);
+      if (ok)
       {
-        i.refresh ();
-        storages << i;
+        result.append (char (code));
+        i += 3;
+        continue;
       }
     }
-    lastCheck = now;
+    result.append (field[i]);
   }
+  return QFile::decodeName (result);
 }
+
+//! Format: id parent major:minor root mountpoint options [tags...] - type source options
+QVector<Mount> parseMountInfo (const QByteArray &data)
+{
+  QVector<Mount> result;
+  for (const auto &line: data.split ('\n'))
+  {
+    const auto fields = line.split (' ');
+    const auto separator = fields.indexOf ("-");
+    if (separator < 6 || separator + 2 >= fields.size ())
+    {
+      continue;
+    }
+    const auto numbers = fields[2].split (':');
+    if (numbers.size () != 2)
+    {
+      continue;
+    }
+
+    Mount mount;
+    mount.device = quint64 (makedev (numbers[0].toUInt (), numbers[1].toUInt ()));
+    mount.storage.root = unescape (fields[4]);
+    mount.storage.type = QString::fromUtf8 (fields[separator + 1]);
+    mount.storage.device = unescape (fields[separator + 2]);
+    result << mount;
+  }
+  return result;
+}
+#endif
+
+QVector<Mount> readMounts (int mountsFile)
+{
+#ifdef Q_OS_LINUX
+  if (mountsFile != -1)
+  {
+    return parseMountInfo (readAll (mountsFile));
+  }
+  const auto fd = ::open ("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+  if (fd != -1)
+  {
+    const auto result = parseMountInfo (readAll (fd));
+    ::close (fd);
+    return result;
+  }
+#else
+  Q_UNUSED (mountsFile);
+#endif
+  return systemMounts ();
 }
 
-const QStorageInfo * StorageManager::storage (const QFileInfo &path)
+//! Keeps known free space of remaining mounts.
+void fill (MountTable &table, const QVector<Mount> &mounts)
 {
-  update ();
+  QHash<QString, StorageManager::Storage> old;
+  for (const auto &i: table.mounts)
+  {
+    old.insert (i.storage.root, i.storage);
+  }
+
+  table.mounts = mounts;
+  table.devices.clear ();
+  table.nodes.clear ();
+  table.nodes.append (TrieNode ());
 
-  const QStorageInfo *result = nullptr;
-  auto bestCount = 0;
-  const auto absolute = path.absoluteFilePath ();
-  for (const auto &i: storages)
+  for (auto i = 0, end = table.mounts.size (); i < end; ++i)
   {
-    if (!i.isValid () || !absolute.startsWith (i.rootPath ()))
+    auto &mount = table.mounts[i];
+    const auto previous = old.find (mount.storage.root);
+    if (previous != old.end ())
     {
-      continue;
+      mount.storage.bytesTotal = previous->bytesTotal;
+      mount.storage.bytesAvailable = previous->bytesAvailable;
+    }
+
+    auto node = 0;
+    for (const auto &part: components (mount.storage.root))
+    {
+      auto child = table.nodes[node].children.value (part, -1);
+      if (child == -1)
+      {
+        child = table.nodes.size ();
+        table.nodes[node].children.insert (part, child);
+        table.nodes.append (TrieNode ());
+      }
+      node = child;
+    }
+
+    const auto shadowed = table.nodes[node].mount; // mounted over
+    if (shadowed != -1)
+    {
+      table.devices.remove (table.mounts[shadowed].device, shadowed);
+    }
+    table.nodes[node].mount = i;
+    if (mount.device != 0)
+    {
+      table.devices.insert (mount.device, i);
+    }
+  }
+  table.isLoaded = true;
+}
+
+void ensureLoaded (MountTable &table)
+{
+  {
+    QReadLocker locker (&table.lock);
+    if (table.isLoaded)
+    {
+      return;
+    }
+  }
+
+  const auto mounts = readMounts (-1);
+  QWriteLocker locker (&table.lock);
+  if (!table.isLoaded)
+  {
+    fill (table, mounts);
+  }
+}
+
+//! Index of mount by device if unambiguous, by longest mounted path prefix
+//! otherwise. Table must be locked.
+int findMount (const MountTable &table, const QString &path, quint64 device)
+{
+  if (device != 0 && table.devices.count (device) == 1)
+  {
+    return table.devices.value (device);
+  }
+
+  if (table.nodes.isEmpty ())
+  {
+    return -1;
+  }
+  auto result = table.nodes[0].mount;
+  auto node = 0;
+  for (const auto &part: components (path))
+  {
+    node = table.nodes[node].children.value (part, -1);
+    if (node == -1)
+    {
+      break;
     }
-    const auto current = i.rootPath ().size ();
-    if (current > bestCount)
+    if (table.nodes[node].mount != -1)
     {
-      bestCount = current;
-      result = &i;
+      result = table.nodes[node].mount;
     }
   }
   return result;
 }
+
+
+class SpaceTask : public QRunnable
+{
+public:
+  SpaceTask (const QString &root, const QSharedPointer<StorageSpaceState> &state) :
+    root_ (root),
+    state_ (state)
+  {
+  }
+
+  void run () override;
+
+private:
+  QString root_;
+  QSharedPointer<StorageSpaceState> state_;
+};
+
+void SpaceTask::run ()
+{
+  qint64 total = 0; // unavailable storage is not asked again until next refresh
+  qint64 available = 0;
+#ifdef Q_OS_UNIX
+  struct statvfs info;
+  if (::statvfs (QFile::encodeName (root_).constData (), &info) == 0)
+  {
+    total = qint64 (info.f_blocks) * qint64 (info.f_frsize);
+    available = qint64 (info.f_bavail) * qint64 (info.f_frsize);
+  }
+#else
+  const QStorageInfo info (root_);
+  if (info.isValid () && info.isReady ())
+  {
+    total = info.bytesTotal ();
+    available = info.bytesAvailable ();
+  }
+#endif
+
+  QMutexLocker locker (&state_->mutex);
+  if (state_->manager)
+  {
+    QMetaObject::invokeMethod (state_->manager, "updateSpace", Qt::QueuedConnection,
+                               Q_ARG (QString, root_), Q_ARG (qint64, total),
+                               Q_ARG (qint64, available));
+  }
+}
+}
+
+
+void StorageManager::init ()
+{
+  instance_ = new StorageManager;
+}
+
+StorageManager &StorageManager::instance ()
+{
+  return *instance_;
+}
+
+StorageManager::StorageManager (QObject *parent) :
+  QObject (parent),
+  state_ (new StorageSpaceState),
+  pool_ (new QThreadPool), // not owned: workers may hang on dead mounts
+  refreshTimer_ (new QTimer (this)),
+  mountsFile_ (-1),
+  mountsNotifier_ (nullptr)
+{
+  state_->manager = this;
+  pool_->setMaxThreadCount (maxRefreshThreads);
+
+#ifdef Q_OS_LINUX
+  // kernel marks the file with POLLPRI when mounts change
+  mountsFile_ = ::open ("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+  if (mountsFile_ != -1)
+  {
+    mountsNotifier_ = new QSocketNotifier (mountsFile_, QSocketNotifier::Exception, this);
+    connect (mountsNotifier_, &QSocketNotifier::activated,
+             this, &StorageManager::reloadMounts);
+  }
+#endif
+  if (!mountsNotifier_)
+  {
+    auto *timer = new QTimer (this);
+    connect (timer, &QTimer::timeout,
+             this, &StorageManager::reloadMounts);
+    timer->start (mountsPollIntervalMs);
+  }
+  reloadMounts ();
+
+  connect (refreshTimer_, &QTimer::timeout,
+           this, &StorageManager::refreshSpace);
+  refreshTimer_->start (refreshIntervalMs);
+}
+
+StorageManager::~StorageManager ()
+{
+  {
+    QMutexLocker locker (&state_->mutex);
+    state_->manager = nullptr;
+  }
+#ifdef Q_OS_UNIX
+  if (mountsFile_ != -1)
+  {
+    ::close (mountsFile_);
+  }
+#endif
+}
+
+StorageManager::Storage StorageManager::storage (const QFileInfo &path)
+{
+  auto &mounts = table ();
+  ensureLoaded (mounts);
+
+  Storage result;
+  {
+    QReadLocker locker (&mounts.lock);
+    // path may be on a hung mount so it is not touched here
+    const auto index = findMount (mounts, path.absoluteFilePath (), 0);
+    if (index == -1)
+    {
+      return result;
+    }
+    result = mounts.mounts[index].storage;
+  }
+
+  if (instance_)
+  {
+    auto &state = *instance_->state_;
+    QMutexLocker locker (&state.mutex);
+    state.wanted.insert (result.root);
+    if (result.bytesAvailable < 0 && !state.pending.contains (result.root))
+    {
+      QMetaObject::invokeMethod (instance_, "refreshSpace", Qt::QueuedConnection);
+    }
+  }
+  return result;
+}
+
+bool StorageManager::isSameStorage (const QString &left, const QString &right)
+{
+  auto &mounts = table ();
+  ensureLoaded (mounts);
+
+  const auto leftDevice = deviceOf (left);
+  const auto rightDevice = deviceOf (right);
+  QReadLocker locker (&mounts.lock);
+  return findMount (mounts, QFileInfo (left).absoluteFilePath (), leftDevice) ==
+         findMount (mounts, QFileInfo (right).absoluteFilePath (), rightDevice);
+}
+
+void StorageManager::reloadMounts ()
+{
+  const auto mounts = readMounts (mountsFile_);
+  auto &t = table ();
+  QWriteLocker locker (&t.lock);
+  fill (t, mounts);
+}
+
+void StorageManager::refreshSpace ()
+{
+  QMutexLocker locker (&state_->mutex);
+  for (const auto &root: nonstd::as_const (state_->wanted))
+  {
+    if (!state_->pending.contains (root))
+    {
+      state_->pending.insert (root);
+      pool_->start (new SpaceTask (root, state_));
+    }
+  }
+  state_->wanted.clear ();
+}
+
+void StorageManager::updateSpace (const QString &root, qint64 total, qint64 available)
+{
+  {
+    QMutexLocker locker (&state_->mutex);
+    state_->pending.remove (root);
+  }
+
+  {
+    auto &t = table ();
+    QWriteLocker locker (&t.lock);
+    for (auto &i: t.mounts)
+    {
+      if (i.storage.root == root)
+      {
+        i.storage.bytesTotal = total;
+        i.storage.bytesAvailable = available;
+      }
+    }
+  }
+
+  emit spaceChanged ();
+}
+
+#include "moc_storagemanager.cpp"
@@ -1,9 +1,56 @@
 #pragma once
 
-#include <QStorageInfo>
+#include <QObject>
+#include <QSharedPointer>
 
-class StorageManager
+class QFileInfo;
+class QTimer;
+class QThreadPool;
+class QSocketNotifier;
+struct StorageSpaceState;
+
+// Table of mounted filesystems. It is reread only when the system reports a
+// mount change. Free space of mounts that are looked up is refreshed in
+// background, one request per mount at a time, so a hung network mount
+// delays only itself.
+class StorageManager : public QObject
 {
+Q_OBJECT
 public:
-  static const QStorageInfo * storage (const QFileInfo &path);
+  struct Storage
+  {
+    QString root; // empty if unknown
+    QString device;
+    QString type;
+    qint64 bytesTotal{-1}; // 0 if unavailable
+    qint64 bytesAvailable{-1}; // -1 until refreshed
+  };
+
+  static void init ();
+  static StorageManager &instance ();
+
+  //! Mount holding the path. Thread safe.
+  static Storage storage (const QFileInfo &path);
+  //! Thread safe.
+  static bool isSameStorage (const QString &left, const QString &right);
+
+signals:
+  //! Free space of looked up storages was refreshed.
+  void spaceChanged ();
+
+private slots:
+  void refreshSpace ();
+  void updateSpace (const QString &root, qint64 total, qint64 available);
+
+private:
+  explicit StorageManager (QObject *parent = nullptr);
+  ~StorageManager ();
+
+  void reloadMounts ();
+
+  QSharedPointer<StorageSpaceState> state_;
+  QThreadPool *pool_;
+  QTimer *refreshTimer_;
+  int mountsFile_;
+  QSocketNotifier *mountsNotifier_;
 };
@@ -37,23 +37,6 @@ QString sizeString (qint64 bytes, int precision)
   return QString::number (bytes) + ' ' + QObject::tr ("bytes");
 }
 
-qint64 totalSize (const QFileInfo &info)
-{
-  qint64 result = 0;
-  if (info.isFile ())
-  {
-    result = info.size ();
-  }
-  else if (info.isDir ())
-  {
-    for (const auto &i: dirEntries (info))
-    {
-      result += totalSize (i);
-    }
-  }
-  return result;
-}
-
 Infos dirEntries (const QFileInfo &info)
 {
   QDir dir (info.absoluteFilePath ());
@@ -8,8 +8,6 @@ using Infos = QList<QFileInfo>;
 
 QString sizeString (qint64 bytes, int precision = 0);
 
-qint64 totalSize (const QFileInfo &info);
-
 Infos dirEntries (const QFileInfo &info);
 
 QString uniqueChars (const QString &source);
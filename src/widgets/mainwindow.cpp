@@ -13,6 +13,8 @@
 #include "dirwidgetfactory.h"
 #include "fileoperationmodel.h"
 #include "fileoperationdelegate.h"
+#include "pathindex.h"
+#include "trigramindex.h"
 
 #include <QSystemTrayIcon>
 #include <QBoxLayout>
@@ -56,8 +58,6 @@ MainWindow::MainWindow (QWidget *parent) :
   auto status = new QStatusBar (this);
   Notifier::setMain (status);
 
-  model_->setRootPath (QDir::rootPath ());
-  model_->setFilter (QDir::AllEntries | QDir::NoDot | QDir::AllDirs | QDir::Hidden);
   model_->setReadOnly (false);
 
 
@@ -65,6 +65,10 @@ MainWindow::MainWindow (QWidget *parent) :
            this, &MainWindow::nameFilterChanged);
   connect (groups_, &GroupsView::currentChanged,
            this, &MainWindow::updateWindowTitle);
+  connect (model_, &FileSystemModel::directoryChanged,
+           &PathIndex::instance (), &PathIndex::refresh);
+  connect (model_, &FileSystemModel::directoryChanged,
+           &TrigramIndex::instance (), &TrigramIndex::refresh);
 
 
   commandsView_->setModel (commandsModel_);
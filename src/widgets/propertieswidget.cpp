@@ -7,10 +7,17 @@
 #include <QDateTime>
 #include <QLabel>
 #include <QDialogButtonBox>
+#include <QDirIterator>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+
+#include <atomic>
 
 
 namespace
 {
+const int updateIntervalMs = 200;
 
 struct AggregateInfo
 {
@@ -30,65 +37,223 @@ struct AggregateInfo
     return *this;
   }
 };
+}
+
+struct PropertiesScan
+{
+  QMutex mutex;
+  QList<QFileInfo> roots; // taken by the first worker
+  QStringList queue; // directories to list
+  int workerCount{0};
+  AggregateInfo aggregate;
+  std::atomic_bool isAborted{false};
+};
 
-AggregateInfo getAggregate (const QFileInfo &info, bool isTopLevel)
+namespace
 {
-  AggregateInfo result;
-  if (info.isDir ())
+//! Never destroyed so a hung mount does not block closing the window.
+QThreadPool &scanPool ()
+{
+  static auto *pool = new QThreadPool;
+  return *pool;
+}
+
+//! Links are counted but not followed, directories are queued for listing.
+void account (const QFileInfo &info, AggregateInfo &aggregate, QStringList &dirs)
+{
+  if (info.isSymLink ())
   {
-    if (!isTopLevel)
+    ++aggregate.links;
+    if (info.isDir ())
     {
-      ++result.dirs;
+      return;
     }
+  }
+  else if (info.isDir ())
+  {
+    ++aggregate.dirs;
+    dirs << info.absoluteFilePath ();
+    return;
+  }
+
+  ++aggregate.files;
+  if (info.isHidden ())
+  {
+    ++aggregate.hidden;
+  }
+  aggregate.size += info.size ();
+}
+
+class ScanTask : public QRunnable
+{
+public:
+  explicit ScanTask (const QSharedPointer<PropertiesScan> &scan) :
+    scan_ (scan)
+  {
+  }
+
+  void run () override;
+
+private:
+  void merge (const AggregateInfo &found, const QStringList &dirs);
 
-    for (const auto &i: utils::dirEntries (info))
+  QSharedPointer<PropertiesScan> scan_;
+};
+
+void ScanTask::run ()
+{
+  QList<QFileInfo> roots;
+  {
+    QMutexLocker locker (&scan_->mutex);
+    roots.swap (scan_->roots);
+  }
+
+  if (!roots.isEmpty ())
+  {
+    AggregateInfo found;
+    QStringList dirs;
+    const auto &first = roots.first ();
+    if (roots.size () == 1 && first.isDir () && !first.isSymLink ())
     {
-      result += getAggregate (i, false);
+      dirs << first.absoluteFilePath (); // contents only
     }
+    else
+    {
+      for (const auto &i: roots)
+      {
+        account (i, found, dirs);
+      }
+    }
+    merge (found, dirs);
   }
-  else
+
+  forever
   {
-    ++result.files;
-    if (info.isHidden ())
+    QString path;
     {
-      ++result.hidden;
+      QMutexLocker locker (&scan_->mutex);
+      if (scan_->queue.isEmpty () || scan_->isAborted)
+      {
+        --scan_->workerCount;
+        return;
+      }
+      path = scan_->queue.takeLast ();
     }
-    if (info.isSymLink ())
+
+    AggregateInfo found;
+    QStringList dirs;
+    QDirIterator it (path, QDir::Files | QDir::Hidden | QDir::System | QDir::Dirs |
+                     QDir::NoDotAndDotDot);
+    while (it.hasNext () && !scan_->isAborted)
     {
-      ++result.links;
+      it.next ();
+      account (it.fileInfo (), found, dirs);
     }
-    result.size += info.size ();
+    merge (found, dirs);
+  }
+}
+
+void ScanTask::merge (const AggregateInfo &found, const QStringList &dirs)
+{
+  QMutexLocker locker (&scan_->mutex);
+  scan_->aggregate += found;
+  scan_->queue += dirs;
+
+  auto &pool = scanPool ();
+  while (scan_->workerCount < pool.maxThreadCount () &&
+         scan_->workerCount < scan_->queue.size ())
+  {
+    ++scan_->workerCount;
+    pool.start (new ScanTask (scan_));
   }
-  return result;
 }
 }
 
-PropertiesWidget::PropertiesWidget (const QFileInfo &info, QWidget *parent) :
-  QWidget (parent)
+
+PropertiesWidget::PropertiesWidget (const QList<QFileInfo> &infos, QWidget *parent) :
+  QWidget (parent),
+  scan_ (new PropertiesScan),
+  timerId_ (0),
+  files_ (new QLabel (this)),
+  hidden_ (new QLabel (this)),
+  links_ (new QLabel (this)),
+  dirs_ (new QLabel (this)),
+  size_ (new QLabel (this)),
+  status_ (new QLabel (tr ("Counting..."), this))
 {
   setWindowTitle (tr ("Properties"));
 
   auto layout = new QFormLayout (this);
 
-  layout->addRow (tr ("Name: "), new QLabel (info.fileName ()));
+  const auto info = infos.value (0);
+  const auto isSingle = (infos.size () == 1);
+  layout->addRow (tr ("Name: "), new QLabel (isSingle ? info.fileName ()
+                                                      : tr ("%1 items").arg (infos.size ())));
   layout->addRow (tr ("Path: "), new QLabel (info.absolutePath ()));
-  const auto aggregate = getAggregate (info, true);
-  layout->addRow (tr ("Files: "), new QLabel (QString::number (aggregate.files)));
-  layout->addRow (tr ("Hidden: "), new QLabel (QString::number (aggregate.hidden)));
-  layout->addRow (tr ("Links: "), new QLabel (QString::number (aggregate.links)));
-  layout->addRow (tr ("Directories: "), new QLabel (QString::number (aggregate.dirs)));
-  layout->addRow (tr ("Size: "), new QLabel (utils::sizeString (aggregate.size, 3)));
-  layout->addRow (tr ("Created: "), new QLabel (info.created ().toString ()));
-  layout->addRow (tr ("Last modified: "), new QLabel (info.lastModified ().toString ()));
-  layout->addRow (tr ("Owner: "), new QLabel (info.owner ()));
-  layout->addRow (tr ("Group: "), new QLabel (info.group ()));
-  layout->addRow (tr ("Access rights: "),
-                  new QLabel (FilePermissions::toFullString (info.permissions ())));
+  layout->addRow (tr ("Files: "), files_);
+  layout->addRow (tr ("Hidden: "), hidden_);
+  layout->addRow (tr ("Links: "), links_);
+  layout->addRow (tr ("Directories: "), dirs_);
+  layout->addRow (tr ("Size: "), size_);
+  if (isSingle)
+  {
+    layout->addRow (tr ("Created: "), new QLabel (info.created ().toString ()));
+    layout->addRow (tr ("Last modified: "), new QLabel (info.lastModified ().toString ()));
+    layout->addRow (tr ("Owner: "), new QLabel (info.owner ()));
+    layout->addRow (tr ("Group: "), new QLabel (info.group ()));
+    layout->addRow (tr ("Access rights: "),
+                    new QLabel (FilePermissions::toFullString (info.permissions ())));
+  }
+  layout->addRow (status_);
 
   auto buttons = new QDialogButtonBox (QDialogButtonBox::Ok, this);
   connect (buttons, &QDialogButtonBox::accepted,
            this, &QWidget::close);
   layout->addRow (buttons);
+
+  scan_->roots = infos;
+  scan_->workerCount = 1;
+  scanPool ().start (new ScanTask (scan_));
+
+  updateAggregate ();
+  timerId_ = startTimer (updateIntervalMs);
+}
+
+PropertiesWidget::~PropertiesWidget ()
+{
+  scan_->isAborted = true;
+  QMutexLocker locker (&scan_->mutex);
+  scan_->roots.clear ();
+  scan_->queue.clear ();
+}
+
+void PropertiesWidget::timerEvent (QTimerEvent */*event*/)
+{
+  updateAggregate ();
+}
+
+void PropertiesWidget::updateAggregate ()
+{
+  AggregateInfo aggregate;
+  bool isFinished = false;
+  {
+    QMutexLocker locker (&scan_->mutex);
+    aggregate = scan_->aggregate;
+    isFinished = (scan_->workerCount == 0);
+  }
+
+  files_->setText (QString::number (aggregate.files));
+  hidden_->setText (QString::number (aggregate.hidden));
+  links_->setText (QString::number (aggregate.links));
+  dirs_->setText (QString::number (aggregate.dirs));
+  size_->setText (utils::sizeString (aggregate.size, 3));
+
+  if (isFinished && timerId_ != 0)
+  {
+    killTimer (timerId_);
+    timerId_ = 0;
+    status_->hide ();
+  }
 }
 
 #include "moc_propertieswidget.cpp"
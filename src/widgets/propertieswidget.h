@@ -1,12 +1,31 @@
 #pragma once
 
 #include <QWidget>
+#include <QSharedPointer>
 
 class QFileInfo;
+class QLabel;
+struct PropertiesScan;
 
 class PropertiesWidget : public QWidget
 {
 Q_OBJECT
 public:
-  PropertiesWidget (const QFileInfo &info, QWidget *parent = nullptr);
+  PropertiesWidget (const QList<QFileInfo> &infos, QWidget *parent = nullptr);
+  ~PropertiesWidget ();
+
+protected:
+  void timerEvent (QTimerEvent *event) override;
+
+private:
+  void updateAggregate ();
+
+  QSharedPointer<PropertiesScan> scan_;
+  int timerId_;
+  QLabel *files_;
+  QLabel *hidden_;
+  QLabel *links_;
+  QLabel *dirs_;
+  QLabel *size_;
+  QLabel *status_;
 };
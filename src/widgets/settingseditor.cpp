@@ -66,9 +66,13 @@ SettingsEditor::SettingsEditor (QWidget *parent) :
   openConsole_ (new QLineEdit (this)),
   runInConsole_ (new QLineEdit (this)),
   editor_ (new QLineEdit (this)),
+  indexedRoots_ (new QLineEdit (this)),
+  contentIndexRoots_ (new QLineEdit (this)),
   checkUpdates_ (new QCheckBox (tr ("Check for updates"), this)),
   startInBackground_ (new QCheckBox (tr ("Start in background"), this)),
   caseSensitiveSort_ (new QCheckBox (tr ("Case sensitive sorting"), this)),
+  fuzzyNameFilter_ (new QCheckBox (tr ("Fuzzy name filter"), this)),
+  showDirSizes_ (new QCheckBox (tr ("Show folder sizes"), this)),
   imageCache_ (new QSpinBox (this)),
   languages_ (new QComboBox (this)),
   tabSwitchOrder_ (new QComboBox (this)),
@@ -106,6 +110,18 @@ SettingsEditor::SettingsEditor (QWidget *parent) :
     layout->addWidget (editor_, row, 1);
     editor_->setToolTip (tr ("%p will be replaced with opening path"));
 
+    ++row;
+    layout->addWidget (new QLabel (tr ("Indexed folders")), row, 0);
+    layout->addWidget (indexedRoots_, row, 1);
+    indexedRoots_->setToolTip (tr ("Comma separated folders whose files can be found by name "
+                                   "instantly. Empty to disable"));
+
+    ++row;
+    layout->addWidget (new QLabel (tr ("Content indexed folders")), row, 0);
+    layout->addWidget (contentIndexRoots_, row, 1);
+    contentIndexRoots_->setToolTip (tr ("Comma separated folders whose file contents are indexed "
+                                        "to speed up text search. Empty to disable"));
+
     ++row;
     layout->addWidget (new QLabel (tr ("Image cache size")), row, 0);
     layout->addWidget (imageCache_, row, 1);
@@ -118,6 +134,12 @@ SettingsEditor::SettingsEditor (QWidget *parent) :
 
     ++row;
     layout->addWidget (caseSensitiveSort_, row, 0);
+    layout->addWidget (fuzzyNameFilter_, row, 1);
+    fuzzyNameFilter_->setToolTip (tr ("Match names by subsequence, best matches first"));
+
+    ++row;
+    layout->addWidget (showDirSizes_, row, 0);
+    showDirSizes_->setToolTip (tr ("Compute sizes of folders with contents in background"));
 
     ++row;
     layout->addWidget (new QLabel (tr ("Language")), row, 0);
@@ -220,9 +242,13 @@ void SettingsEditor::init ()
   editorToSettings_[openConsole_] = S::OpenConsoleCommand;
   editorToSettings_[runInConsole_] = S::RunInConsoleCommand;
   editorToSettings_[editor_] = S::EditorCommand;
+  editorToSettings_[indexedRoots_] = S::IndexedRoots;
+  editorToSettings_[contentIndexRoots_] = S::ContentIndexRoots;
   editorToSettings_[checkUpdates_] = S::CheckUpdates;
   editorToSettings_[startInBackground_] = S::StartInBackground;
   editorToSettings_[caseSensitiveSort_] = S::CaseSensitiveSort;
+  editorToSettings_[fuzzyNameFilter_] = S::FuzzyNameFilter;
+  editorToSettings_[showDirSizes_] = S::ShowDirSizes;
   editorToSettings_[imageCache_] = S::ImageCacheSize;
 
   editorToSettings_[groupShortcuts_] = S::GroupIds;
@@ -44,9 +44,13 @@ private:
   QLineEdit *openConsole_;
   QLineEdit *runInConsole_;
   QLineEdit *editor_;
+  QLineEdit *indexedRoots_;
+  QLineEdit *contentIndexRoots_;
   QCheckBox *checkUpdates_;
   QCheckBox *startInBackground_;
   QCheckBox *caseSensitiveSort_;
+  QCheckBox *fuzzyNameFilter_;
+  QCheckBox *showDirSizes_;
   QSpinBox *imageCache_;
   QComboBox *languages_;
   QComboBox *tabSwitchOrder_;
@@ -0,0 +1,62 @@
+#include "catch.hpp"
+#include "decompressingdevice.h"
+
+#include <QBuffer>
+
+namespace
+{
+using Format = DecompressingDevice::Format;
+
+#ifdef WITH_ZLIB
+QByteArray decompress (const QByteArray &compressed)
+{
+  QBuffer source;
+  source.setData (compressed);
+  source.open (QIODevice::ReadOnly);
+  DecompressingDevice device (&source, Format::Gzip);
+  REQUIRE (device.open (QIODevice::ReadOnly));
+  QByteArray result;
+  while (!device.atEnd ())
+  {
+    result += device.readLine ();
+  }
+  return result;
+}
+#endif
+}
+
+TEST_CASE ("compression format detection", "[decompressing device]")
+{
+  REQUIRE (DecompressingDevice::format (QByteArray ("\x1f\x8b\x08", 3)) == Format::Gzip);
+  REQUIRE (DecompressingDevice::format (QByteArray ("\xfd" "7zXZ\0", 6)) == Format::Xz);
+  REQUIRE (DecompressingDevice::format (QByteArray ("\x28\xb5\x2f\xfd", 4)) == Format::Zstd);
+  REQUIRE (DecompressingDevice::format ("text") == Format::None);
+  REQUIRE (DecompressingDevice::format (QByteArray ("\x1f", 1)) == Format::None);
+  REQUIRE (!DecompressingDevice::isSupported (Format::None));
+}
+
+#ifdef WITH_ZLIB
+TEST_CASE ("gzip streaming", "[decompressing device]")
+{
+  // "first line\nsecond match\n"
+  const QByteArray first ("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\xff\x4b\xcb\x2c\x2a\x2e\x51"
+                          "\xc8\xc9\xcc\x4b\xe5\x2a\x4e\x4d\xce\xcf\x4b\x51\xc8\x4d\x2c\x49"
+                          "\xce\xe0\x02\x00\x22\x75\x9c\x97\x18\x00\x00\x00", 44);
+  // "third\n"
+  const QByteArray second ("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\xff\x2b\xc9\xc8\x2c\x4a\xe1"
+                           "\x02\x00\xf2\x91\x2c\x78\x06\x00\x00\x00", 26);
+
+  SECTION ("single stream")
+  {
+    REQUIRE (decompress (first) == "first line\nsecond match\n");
+  }
+  SECTION ("concatenated streams")
+  {
+    REQUIRE (decompress (first + second) == "first line\nsecond match\nthird\n");
+  }
+  SECTION ("truncated")
+  {
+    REQUIRE (QByteArray ("first line\nsecond match\n").startsWith (decompress (first.left (30))));
+  }
+}
+#endif
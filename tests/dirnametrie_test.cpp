@@ -0,0 +1,39 @@
+#include "catch.hpp"
+#include "dirnametrie.h"
+
+TEST_CASE ("directory name completion", "[dir name trie]")
+{
+  DirNameTrie trie;
+  trie.add ("/home/user", {"projects", "photos", "music", ".config"});
+
+  SECTION ("by prefix")
+  {
+    REQUIRE (trie.complete ("/home/user/", "p", 10) == QStringList ({"photos", "projects"}));
+    REQUIRE (trie.complete ("/home/user", "", 10) == QStringList ({"music", "photos", "projects"}));
+    REQUIRE (trie.complete ("/home/user", "x", 10).isEmpty ());
+    REQUIRE (trie.complete ("/home/other", "p", 10).isEmpty ());
+  }
+  SECTION ("hidden only by dot")
+  {
+    REQUIRE (trie.complete ("/home/user", ".", 10) == QStringList ({".config"}));
+  }
+  SECTION ("fuzzy after prefix")
+  {
+    REQUIRE (trie.complete ("/home/user", "pjs", 10) == QStringList ({"projects"}));
+  }
+  SECTION ("limited")
+  {
+    REQUIRE (trie.complete ("/home/user", "p", 1).size () == 1);
+  }
+  SECTION ("reset drops missing")
+  {
+    REQUIRE (trie.listedAt ("/home/user") == 0);
+    trie.reset ("/home/user", {"music"});
+    REQUIRE (trie.listedAt ("/home/user") > 0);
+    REQUIRE (trie.complete ("/home/user", "", 10) == QStringList ({"music"}));
+  }
+  SECTION ("parents are known")
+  {
+    REQUIRE (trie.complete ("/home", "u", 10) == QStringList ({"user"}));
+  }
+}
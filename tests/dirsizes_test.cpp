@@ -0,0 +1,60 @@
+#include "catch.hpp"
+#include "dirsizes.h"
+
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+namespace
+{
+void write (const QString &path, int size)
+{
+  QFile file (path);
+  REQUIRE (file.open (QFile::WriteOnly));
+  file.write (QByteArray (size, 'x'));
+}
+}
+
+
+TEST_CASE ("recursive directory size", "[dirsizes]")
+{
+  QTemporaryDir temp;
+  const auto root = temp.path ();
+  QDir (root).mkpath ("a/b");
+  QDir (root).mkpath ("c");
+  write (root + "/1", 10);
+  write (root + "/a/2", 20);
+  write (root + "/a/b/3", 30);
+
+  const std::atomic_bool isAborted (false);
+
+  SECTION ("sums files below")
+  {
+    REQUIRE (DirSizes::compute (root, isAborted) == 60);
+    REQUIRE (DirSizes::compute (root + "/c", isAborted) == 0);
+  }
+  SECTION ("caches subdirectories")
+  {
+    DirSizes::compute (root, isAborted);
+    REQUIRE (DirSizes::cached (root) == 60);
+    REQUIRE (DirSizes::cached (root + "/a") == 50);
+    REQUIRE (DirSizes::cached (root + "/a/b") == 30);
+  }
+  SECTION ("invalidates ancestors")
+  {
+    DirSizes::compute (root, isAborted);
+    write (root + "/a/b/4", 40);
+    DirSizes::invalidate (root + "/a/b");
+    REQUIRE (DirSizes::cached (root + "/a/b") == -1);
+    REQUIRE (DirSizes::cached (root + "/a") == -1);
+    REQUIRE (DirSizes::cached (root) == -1);
+    REQUIRE (DirSizes::cached (root + "/c") == 0);
+    REQUIRE (DirSizes::compute (root, isAborted) == 100);
+  }
+  SECTION ("aborted")
+  {
+    const std::atomic_bool isCancelled (true);
+    REQUIRE (DirSizes::compute (root, isCancelled) == -1);
+    REQUIRE (DirSizes::cached (root) == -1);
+  }
+}
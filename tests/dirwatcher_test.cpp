@@ -0,0 +1,100 @@
+#include "catch.hpp"
+#include "catch_ext.h"
+#include "testapplication.h"
+#include "dirwatcher.h"
+
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+namespace
+{
+void touch (const QString &path)
+{
+  QFile file (path);
+  REQUIRE (file.open (QFile::WriteOnly));
+}
+
+struct Reported
+{
+  QString path;
+  DirWatcher::Changes changes;
+};
+}
+
+
+TEST_CASE ("watched directory changes", "[dirwatcher]")
+{
+  ensureApplication ();
+  QTemporaryDir temp;
+  REQUIRE (temp.isValid ());
+  const auto dir = temp.path () + "/watched";
+  REQUIRE (QDir ().mkpath (dir));
+
+  DirWatcher watcher;
+  QVector<Reported> reported;
+  QObject::connect (&watcher, &DirWatcher::changed,
+                    [&reported](const QString &path, const DirWatcher::Changes &changes) {
+    reported.append ({path, changes});
+  });
+  watcher.watch (dir);
+  REQUIRE (watcher.isWatched (dir));
+
+  SECTION ("are coalesced into one delta")
+  {
+    touch (dir + "/a");
+    touch (dir + "/b");
+    touch (dir + "/c");
+    QFile::remove (dir + "/a");
+    REQUIRE (waitUntil ([&reported] {return !reported.isEmpty ();}));
+    waitUntil ([] {return false;}, 500);
+
+    REQUIRE (reported.size () == 1);
+    const auto &changes = reported.first ().changes;
+    REQUIRE (reported.first ().path == dir);
+    REQUIRE (!changes.isRescanNeeded);
+    auto added = changes.added;
+    added.sort ();
+    REQUIRE (added == (QStringList {"b", "c"}));
+    REQUIRE (changes.removed.isEmpty ());
+  }
+  SECTION ("of removed entry are reported as removal")
+  {
+    touch (dir + "/a");
+    REQUIRE (waitUntil ([&reported] {return !reported.isEmpty ();}));
+    reported.clear ();
+
+    QFile::remove (dir + "/a");
+    touch (dir + "/a");
+    QFile::remove (dir + "/a");
+    REQUIRE (waitUntil ([&reported] {return !reported.isEmpty ();}));
+    REQUIRE (reported.first ().changes.removed == QStringList {"a"});
+    REQUIRE (reported.first ().changes.added.isEmpty ());
+  }
+  SECTION ("are tracked in directory created in place of removed one")
+  {
+    REQUIRE (QDir (dir).removeRecursively ());
+    REQUIRE (waitUntil ([&reported] {
+      return !reported.isEmpty () && reported.last ().changes.isRescanNeeded;
+    }));
+    reported.clear ();
+    REQUIRE (QDir ().mkpath (dir));
+    REQUIRE (waitUntil ([&reported] {
+      return !reported.isEmpty () && reported.last ().changes.isRescanNeeded;
+    }));
+    reported.clear ();
+
+    // watched again, so entries are reported instead of polled revalidation
+    touch (dir + "/new");
+    REQUIRE (waitUntil ([&reported] {
+      return !reported.isEmpty () && reported.last ().changes.added == QStringList {"new"};
+    }));
+  }
+  SECTION ("are not reported after unwatch")
+  {
+    watcher.unwatch (dir);
+    REQUIRE (!watcher.isWatched (dir));
+    touch (dir + "/a");
+    REQUIRE (!waitUntil ([&reported] {return !reported.isEmpty ();}, 500));
+  }
+}
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+#include "catch_ext.h"
+#include "testapplication.h"
+#include "frecencystore.h"
+
+#include <QTemporaryDir>
+
+TEST_CASE ("visited directories", "[frecency]")
+{
+  ensureApplication ();
+  QTemporaryDir temp;
+  REQUIRE (temp.isValid ());
+  FrecencyStore store (temp.path () + "/visits.dat");
+
+  const QString alpha ("/data/projects/alpha");
+  const QString beta ("/data/projects/beta");
+  const QString old ("/data/archive/projects-old");
+  for (const auto &i: {alpha, beta, alpha, beta, alpha, old})
+  {
+    store.addVisit (i);
+  }
+
+  SECTION ("frequent and named ones first")
+  {
+    REQUIRE (store.find ("projects", 10) == (QStringList {old, alpha, beta}));
+    REQUIRE (store.find ("projects", 1) == QStringList {old});
+  }
+  SECTION ("parts in order")
+  {
+    REQUIRE (store.find ("data alpha", 10) == QStringList {alpha});
+    REQUIRE (store.find ("DATA/PROJECTS/", 10) == (QStringList {alpha, beta}));
+  }
+  SECTION ("fuzzy names")
+  {
+    REQUIRE (store.find ("bta", 10) == QStringList {beta});
+  }
+  SECTION ("repeated visit counts once")
+  {
+    store.addVisit (alpha);
+    store.addVisit (beta);
+    store.addVisit (beta + "/");
+    store.addVisit (beta);
+    REQUIRE (store.find ("projects/", 10) == (QStringList {alpha, beta}));
+  }
+  SECTION ("removed")
+  {
+    store.remove (alpha + "/");
+    REQUIRE (store.find ("projects/", 10) == QStringList {beta});
+  }
+  SECTION ("rarely visited ones decay")
+  {
+    const QString x ("/data/x");
+    const QString y ("/data/y");
+    for (auto i = 0; i < 15000; ++i)
+    {
+      store.addVisit (x);
+      store.addVisit (y);
+    }
+    REQUIRE (store.find ("projects", 10).isEmpty ());
+    auto found = store.find ("data/", 10);
+    found.sort ();
+    REQUIRE (found == (QStringList {x, y}));
+  }
+}
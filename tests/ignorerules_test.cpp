@@ -0,0 +1,122 @@
+#include "catch.hpp"
+#include "ignorerules.h"
+
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+namespace
+{
+void write (const QString &path, const QByteArray &contents)
+{
+  QFile file (path);
+  REQUIRE (file.open (QFile::WriteOnly));
+  file.write (contents);
+}
+}
+
+
+TEST_CASE ("ignore file syntax", "[ignore rules]")
+{
+  IgnoreRules rules;
+
+  SECTION ("names at any depth")
+  {
+    rules.add ("/repo", {"*.o", "# comment", "", "build"});
+    REQUIRE (rules.isIgnored ("/repo/a.o", false));
+    REQUIRE (rules.isIgnored ("/repo/src/deep/b.o", false));
+    REQUIRE (rules.isIgnored ("/repo/src/build", true));
+    REQUIRE (!rules.isIgnored ("/repo/a.cpp", false));
+    REQUIRE (!rules.isIgnored ("/other/a.o", false));
+  }
+  SECTION ("anchored paths")
+  {
+    rules.add ("/repo", {"/out", "doc/*.html"});
+    REQUIRE (rules.isIgnored ("/repo/out", true));
+    REQUIRE (!rules.isIgnored ("/repo/src/out", true));
+    REQUIRE (rules.isIgnored ("/repo/doc/index.html", false));
+    REQUIRE (!rules.isIgnored ("/repo/doc/api/index.html", false));
+  }
+  SECTION ("double asterisk")
+  {
+    rules.add ("/repo", {"**/cache", "logs/**", "a/**/z"});
+    REQUIRE (rules.isIgnored ("/repo/x/y/cache", true));
+    REQUIRE (rules.isIgnored ("/repo/logs/1.txt", false));
+    REQUIRE (rules.isIgnored ("/repo/a/z", true));
+    REQUIRE (rules.isIgnored ("/repo/a/b/c/z", true));
+    REQUIRE (!rules.isIgnored ("/repo/ab/z", true));
+  }
+  SECTION ("directories only")
+  {
+    rules.add ("/repo", {"tmp/"});
+    REQUIRE (rules.isIgnored ("/repo/tmp", true));
+    REQUIRE (!rules.isIgnored ("/repo/tmp", false));
+  }
+  SECTION ("later negation wins")
+  {
+    rules.add ("/repo", {"*.log", "!keep.log"});
+    REQUIRE (rules.isIgnored ("/repo/a.log", false));
+    REQUIRE (!rules.isIgnored ("/repo/keep.log", false));
+  }
+  SECTION ("character sets")
+  {
+    rules.add ("/repo", {"file[0-9].txt", "x[!a]"});
+    REQUIRE (rules.isIgnored ("/repo/file1.txt", false));
+    REQUIRE (!rules.isIgnored ("/repo/filea.txt", false));
+    REQUIRE (rules.isIgnored ("/repo/xb", false));
+    REQUIRE (!rules.isIgnored ("/repo/xa", false));
+  }
+  SECTION ("nested dirs")
+  {
+    rules.add ("/repo", {"*.tmp"});
+    rules.add ("/repo/sub", {"!b.tmp", "/gen"});
+    REQUIRE (rules.isIgnored ("/repo/sub/a.tmp", false));
+    REQUIRE (!rules.isIgnored ("/repo/sub/b.tmp", false));
+    REQUIRE (rules.isIgnored ("/repo/b.tmp", false));
+    REQUIRE (rules.isIgnored ("/repo/sub/gen", true));
+    REQUIRE (!rules.isIgnored ("/repo/gen", true));
+  }
+}
+
+TEST_CASE ("exclude globs", "[ignore rules]")
+{
+  IgnoreRules rules ("/repo", {"node_modules", " *.min.js "}, false);
+  REQUIRE (rules.isIgnored ("/repo/web/node_modules", true));
+  REQUIRE (rules.isIgnored ("/repo/web/app.min.js", false));
+  REQUIRE (!rules.isIgnored ("/repo/web/app.js", false));
+
+  SECTION ("win over ignore files")
+  {
+    rules.add ("/repo", {"!node_modules"});
+    REQUIRE (rules.isIgnored ("/repo/node_modules", true));
+  }
+}
+
+TEST_CASE ("ignore files of repository", "[ignore rules]")
+{
+  QTemporaryDir temp;
+  REQUIRE (temp.isValid ());
+  const auto outer = temp.path () + "/outer";
+  const auto inner = outer + "/inner";
+  REQUIRE (QDir ().mkpath (outer + "/.git/info"));
+  REQUIRE (QDir ().mkpath (outer + "/sub"));
+  REQUIRE (QDir ().mkpath (inner + "/.git/info"));
+  write (outer + "/.gitignore", "*.log\n");
+  write (outer + "/.git/info/exclude", "*.bak\n");
+  write (inner + "/.git/info/exclude", "*.tmp\n");
+
+  SECTION ("root is repository")
+  {
+    const auto rules = IgnoreRules (inner, {}, true).forDir (inner);
+    REQUIRE (rules.isIgnored (inner + "/a.tmp", false));
+    REQUIRE (!rules.isIgnored (inner + "/a.log", false));
+    REQUIRE (!rules.isIgnored (inner + "/a.bak", false));
+  }
+  SECTION ("root inside repository")
+  {
+    const auto rules = IgnoreRules (outer + "/sub", {}, true).forDir (outer + "/sub");
+    REQUIRE (rules.isIgnored (outer + "/sub/a.log", false));
+    REQUIRE (rules.isIgnored (outer + "/sub/a.bak", false));
+    REQUIRE (!rules.isIgnored (outer + "/sub/a.tmp", false));
+  }
+}
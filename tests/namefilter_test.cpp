@@ -0,0 +1,58 @@
+#include "catch.hpp"
+#include "namefilter.h"
+
+namespace
+{
+using Mode = NameFilter::Mode;
+}
+
+TEST_CASE ("wildcard matching", "[name filter]")
+{
+  SECTION ("substring")
+  {
+    NameFilter filter ("*abc*");
+    REQUIRE (filter.matches ("xAbCx"));
+    REQUIRE (!filter.matches ("ab"));
+  }
+  SECTION ("prefix and suffix")
+  {
+    REQUIRE (NameFilter ("abc*").matches ("abcd"));
+    REQUIRE (!NameFilter ("abc*").matches ("dabc"));
+    REQUIRE (NameFilter ("*.txt").matches ("a.TXT"));
+    REQUIRE (!NameFilter ("*.txt").matches ("a.txt.bak"));
+  }
+  SECTION ("complex")
+  {
+    NameFilter filter ("*a?c*d*");
+    REQUIRE (filter.matches ("xabcxd"));
+    REQUIRE (!filter.matches ("xacd"));
+  }
+  SECTION ("empty")
+  {
+    REQUIRE (NameFilter ("").isEmpty ());
+    REQUIRE (NameFilter ("**").isEmpty ());
+    REQUIRE (NameFilter ("**").matches ("any"));
+  }
+}
+
+TEST_CASE ("narrowing", "[name filter]")
+{
+  REQUIRE (NameFilter ("*abc*").narrows (NameFilter ("*ab*")));
+  REQUIRE (NameFilter ("abc*").narrows (NameFilter ("*bc*")));
+  REQUIRE (NameFilter ("abc*").narrows (NameFilter ("**")));
+  REQUIRE (!NameFilter ("*ab*").narrows (NameFilter ("*abc*")));
+  REQUIRE (!NameFilter ("*abc*").narrows (NameFilter ("ab*")));
+  REQUIRE (!NameFilter ("*a?c*").narrows (NameFilter ("*a*")));
+  REQUIRE (NameFilter ("*abc*", Mode::Fuzzy).narrows (NameFilter ("*ac*", Mode::Fuzzy)));
+  REQUIRE (!NameFilter ("*abc*", Mode::Fuzzy).narrows (NameFilter ("*ab*")));
+}
+
+TEST_CASE ("fuzzy scoring", "[name filter]")
+{
+  NameFilter filter ("fsm", Mode::Fuzzy);
+  REQUIRE (filter.score ("main.cpp") == -1);
+  REQUIRE (filter.score ("filesystemmodel.h") >= 0);
+  REQUIRE (filter.score ("FileSystemModel.h") > filter.score ("filesystemmodel.h"));
+  REQUIRE (NameFilter ("file", Mode::Fuzzy).score ("file.h") >
+           NameFilter ("file", Mode::Fuzzy).score ("f_i_l_e.h"));
+}
@@ -0,0 +1,92 @@
+#include "catch.hpp"
+#include "catch_ext.h"
+#include "testapplication.h"
+#include "pathindex.h"
+
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+namespace
+{
+void touch (const QString &path)
+{
+  QFile file (path);
+  REQUIRE (file.open (QFile::WriteOnly));
+}
+
+QStringList paths (const QVector<PathIndex::Match> &matches)
+{
+  QStringList result;
+  for (const auto &i: matches)
+  {
+    result << QDir::fromNativeSeparators (i.path);
+  }
+  return result;
+}
+}
+
+
+// limits keep fuzzy matches of temporary dir names out
+TEST_CASE ("path index lookups", "[path index]")
+{
+  ensureApplication ();
+  QTemporaryDir temp;
+  REQUIRE (temp.isValid ());
+  const auto root = temp.path () + "/root";
+  REQUIRE (QDir ().mkpath (root + "/projects/multidir/src"));
+  REQUIRE (QDir ().mkpath (root + "/photos"));
+  touch (root + "/projects/multidir/src/pathindex.cpp");
+  touch (root + "/projects/multidir/README.md");
+  touch (root + "/photos/beach.jpg");
+
+  const auto tablePath = temp.path () + "/paths.idx";
+  PathIndex index (tablePath);
+  index.setRoots ({root});
+  REQUIRE (waitUntil ([&index] {return index.isReady ();}));
+  REQUIRE (index.contains (root + "/photos"));
+  REQUIRE (!index.contains (temp.path () + "/other"));
+
+  SECTION ("names containing query")
+  {
+    REQUIRE (paths (index.find ("BEACH", 1)) == QStringList {root + "/photos/beach.jpg"});
+  }
+  SECTION ("wildcard")
+  {
+    REQUIRE (paths (index.find ("*.md", 10)) ==
+             QStringList {root + "/projects/multidir/README.md"});
+  }
+  SECTION ("directories only")
+  {
+    const auto found = index.find ("multidir/", 1);
+    REQUIRE (paths (found) == QStringList {root + "/projects/multidir"});
+    REQUIRE (found.first ().isDir);
+  }
+  SECTION ("part of path")
+  {
+    REQUIRE (paths (index.find ("src/path", 10)) ==
+             QStringList {root + "/projects/multidir/src/pathindex.cpp"});
+    REQUIRE (index.find ("photos/path", 10).isEmpty ());
+  }
+  SECTION ("fuzzy")
+  {
+    REQUIRE (paths (index.find ("pi.cp", 10)) ==
+             QStringList {root + "/projects/multidir/src/pathindex.cpp"});
+  }
+  SECTION ("relisted directory")
+  {
+    touch (root + "/photos/sunset.jpg");
+    QFile::remove (root + "/photos/beach.jpg");
+    index.refresh (root + "/photos");
+    REQUIRE (waitUntil ([&index] {return !index.find ("sunset", 10).isEmpty ();}));
+    REQUIRE (index.find ("beach.jpg", 10).isEmpty ());
+  }
+  SECTION ("written table")
+  {
+    REQUIRE (waitUntil ([&tablePath] {return QFile::exists (tablePath);}));
+    PathIndex loaded (tablePath);
+    loaded.setRoots ({root});
+    REQUIRE (waitUntil ([&loaded] {return loaded.isReady ();}));
+    REQUIRE (paths (loaded.find ("beach", 1)) == QStringList {root + "/photos/beach.jpg"});
+  }
+}
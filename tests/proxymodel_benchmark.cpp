@@ -0,0 +1,97 @@
+#include "catch.hpp"
+#include "filesystemmodel.h"
+#include "fileoperationmodel.h"
+#include "proxymodel.h"
+#include "testapplication.h"
+
+#include <QApplication>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+
+#include <memory>
+
+namespace
+{
+const auto busyDir = QString ("busy");
+const auto fileCount = 5000;
+
+bool waitFor (FileSystemModel &model, const QModelIndex &index, int rowCount)
+{
+  QElapsedTimer timer;
+  timer.start ();
+  while (timer.elapsed () < 60000)
+  {
+    if (model.canFetchMore (index))
+    {
+      model.fetchMore (index);
+    }
+    if (model.rowCount (index) >= rowCount)
+    {
+      return true;
+    }
+    QApplication::processEvents (QEventLoop::AllEvents, 10);
+  }
+  return false;
+}
+
+QModelIndex fetchIndex (FileSystemModel &model, const QString &path)
+{
+  model.fetchPath (path);
+  waitUntil ([&model, &path] {return model.index (path).isValid ();}, 60000);
+  return model.index (path);
+}
+
+// Time until a directory receiving many files is fully listed while the
+// given number of panes show other directories of the same model.
+qint64 measure (int paneCount)
+{
+  QTemporaryDir root;
+  QDir dir (root.path ());
+  dir.mkdir (busyDir);
+  for (auto i = 0; i < paneCount; ++i)
+  {
+    dir.mkdir (QString::number (i));
+  }
+
+  FileOperationModel operations;
+  FileSystemModel model (&operations);
+  std::vector<std::unique_ptr<ProxyModel>> panes;
+  for (auto i = 0; i < paneCount; ++i)
+  {
+    const auto index = fetchIndex (model, dir.absoluteFilePath (QString::number (i)));
+    waitFor (model, index, 1);
+    panes.emplace_back (new ProxyModel (&model));
+    panes.back ()->setSourceRoot (index);
+    panes.back ()->sort (FileSystemModel::Name);
+  }
+
+  const auto busy = fetchIndex (model, dir.absoluteFilePath (busyDir));
+  model.watch (dir.absoluteFilePath (busyDir));
+  waitFor (model, busy, 1);
+
+  QElapsedTimer timer;
+  timer.start ();
+  for (auto i = 0; i < fileCount; ++i)
+  {
+    QFile file (dir.absoluteFilePath (busyDir + QLatin1Char ('/') + QString::number (i)));
+    file.open (QFile::WriteOnly);
+  }
+  REQUIRE (waitFor (model, busy, fileCount));
+  const auto result = timer.elapsed ();
+
+  model.unwatch (dir.absoluteFilePath (busyDir));
+  return result;
+}
+}
+
+
+TEST_CASE ("Panes do not pay for unrelated directories", "[.benchmark][proxymodel]")
+{
+  ensureApplication ();
+  const auto single = measure (1);
+  const auto many = measure (20);
+  WARN ("1 pane: " << single << " ms, 20 panes: " << many << " ms for "
+                   << fileCount << " new files");
+}
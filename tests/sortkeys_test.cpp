@@ -0,0 +1,72 @@
+#include "catch.hpp"
+#include "sortkeys.h"
+#include "filesystemmodel.h"
+
+namespace
+{
+QStringList sorted (const SortKeys &keys)
+{
+  const auto ranks = keys.rank ();
+  QStringList result;
+  for (auto i = 0; i < ranks.size (); ++i)
+  {
+    result << QString ();
+  }
+  for (auto i = 0; i < ranks.size (); ++i)
+  {
+    result[ranks[i]] = keys.names[i];
+  }
+  return result;
+}
+
+SortKeys byName (const QStringList &names)
+{
+  SortKeys keys;
+  keys.column = FileSystemModel::Name;
+  for (const auto &i: names)
+  {
+    keys.names << i;
+    keys.flags << 0;
+  }
+  return keys;
+}
+}
+
+TEST_CASE ("ranking", "[sort keys]")
+{
+  SECTION ("natural numbers")
+  {
+    const auto keys = byName ({"file10", "file2", "file1"});
+    const QStringList expected {"file1", "file2", "file10"};
+    REQUIRE (sorted (keys) == expected);
+  }
+  SECTION ("dirs first")
+  {
+    auto keys = byName ({"a", "b", ".."});
+    keys.flags[1] = SortKeys::IsDir;
+    keys.flags[2] = SortKeys::IsDotDot | SortKeys::IsDir;
+    const QStringList expected {"..", "b", "a"};
+    REQUIRE (sorted (keys) == expected);
+  }
+  SECTION ("by size")
+  {
+    auto keys = byName ({"a", "b", "c"});
+    keys.column = FileSystemModel::Size;
+    keys.values = {30, 10, 20};
+    const QStringList expected {"b", "c", "a"};
+    REQUIRE (sorted (keys) == expected);
+  }
+  SECTION ("many chunks")
+  {
+    QStringList names;
+    for (auto i = 50000; i > 0; --i)
+    {
+      names << QString ("f%1").arg (i);
+    }
+    const auto result = sorted (byName (names));
+    REQUIRE (result.size () == names.size ());
+    REQUIRE (result.first () == "f1");
+    REQUIRE (result[9] == "f10");
+    REQUIRE (result.last () == "f50000");
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QApplication>
+#include <QElapsedTimer>
+
+#include <functional>
+
+// Application for tests of objects that deliver results by queued calls.
+inline void ensureApplication ()
+{
+  if (qApp)
+  {
+    return;
+  }
+  static auto argc = 1;
+  static char name[] = "tests";
+  static char *argv[] = {name, nullptr};
+  qputenv ("QT_QPA_PLATFORM", "offscreen");
+  new QApplication (argc, argv);
+}
+
+//! Processes events until condition holds. False on timeout.
+inline bool waitUntil (const std::function<bool()> &condition, int timeoutMs = 10000)
+{
+  QElapsedTimer timer;
+  timer.start ();
+  while (!condition ())
+  {
+    if (timer.elapsed () > timeoutMs)
+    {
+      return false;
+    }
+    QApplication::processEvents (QEventLoop::AllEvents, 10);
+  }
+  return true;
+}
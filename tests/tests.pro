@@ -1,10 +1,27 @@
 TARGET = tests
 TEMPLATE = app
 
-QT += widgets
+QT += widgets concurrent
 
 CONFIG += c++11
 
+# optional decompression of searched files
+unix{
+  CONFIG += link_pkgconfig
+  packagesExist(zlib){
+    PKGCONFIG += zlib
+    DEFINES += WITH_ZLIB
+  }
+  packagesExist(liblzma){
+    PKGCONFIG += liblzma
+    DEFINES += WITH_LZMA
+  }
+  packagesExist(libzstd){
+    PKGCONFIG += libzstd
+    DEFINES += WITH_ZSTD
+  }
+}
+
 OTHER_FILES += \
     $$PWD/../uncrustify.cfg
 
@@ -22,14 +39,68 @@ INCLUDEPATH += \
 VPATH += $$PWD/../src
 
 SOURCES += \
+    fileoperation/fileconflictresolver.cpp \
+    fileoperation/fileoperation.cpp \
+    fileoperation/fileoperationmodel.cpp \
+    filesystem/direntries.cpp \
+    filesystem/dirlister.cpp \
+    filesystem/dirnametrie.cpp \
+    filesystem/dirsizes.cpp \
+    filesystem/dirwatcher.cpp \
     filesystem/filepermissions.cpp \
+    filesystem/filesystemmodel.cpp \
+    filesystem/filetypes.cpp \
+    filesystem/namefilter.cpp \
+    filesystem/proxymodel.cpp \
+    filesystem/sortkeys.cpp \
+    filesystem/thumbnailcache.cpp \
+    filesystem/thumbnaildecoder.cpp \
+    filesystem/thumbnailloader.cpp \
+    search/decompressingdevice.cpp \
+    search/ignorerules.cpp \
+    search/pathindex.cpp \
+    search/trigramindex.cpp \
     shellcommand/shellcommand.cpp \
     utility/notifier.cpp \
     utility/debug.cpp \
+    utility/frecencystore.cpp \
+    utility/settingsmanager.cpp \
+    utility/storagemanager.cpp \
+    utility/styleoptionsproxy.cpp \
+    utility/trash.cpp \
+    utils.cpp \
     main.cpp \
+    dirnametrie_test.cpp \
+    dirsizes_test.cpp \
+    dirwatcher_test.cpp \
+    decompressingdevice_test.cpp \
     filepermissions_test.cpp \
-    shellcommand_test.cpp
+    frecencystore_test.cpp \
+    ignorerules_test.cpp \
+    namefilter_test.cpp \
+    pathindex_test.cpp \
+    proxymodel_benchmark.cpp \
+    shellcommand_test.cpp \
+    sortkeys_test.cpp \
+    thumbnaildecoder_test.cpp \
+    trigramindex_test.cpp
 
 HEADERS  += \
+    fileoperation/fileconflictresolver.h \
+    fileoperation/fileoperation.h \
+    fileoperation/fileoperationmodel.h \
+    filesystem/dirlister.h \
+    filesystem/dirsizes.h \
+    filesystem/dirwatcher.h \
+    filesystem/filesystemmodel.h \
+    filesystem/filetypes.h \
+    filesystem/proxymodel.h \
+    filesystem/thumbnailloader.h \
+    search/pathindex.h \
+    search/trigramindex.h \
+    utility/frecencystore.h \
+    utility/storagemanager.h \
+    utility/styleoptionsproxy.h \
     catch.hpp \
-    catch_ext.h
+    catch_ext.h \
+    testapplication.h
@@ -0,0 +1,166 @@
+#include "catch.hpp"
+#include "thumbnaildecoder.h"
+
+#include <QBuffer>
+#include <QImageWriter>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <QFile>
+
+namespace
+{
+void append16 (QByteArray &target, quint16 value)
+{
+  target.append (char (value & 0xff));
+  target.append (char (value >> 8));
+}
+
+void append32 (QByteArray &target, quint32 value)
+{
+  append16 (target, quint16 (value & 0xffff));
+  append16 (target, quint16 (value >> 16));
+}
+
+void appendEntry (QByteArray &target, quint16 tag, quint32 value)
+{
+  append16 (target, tag);
+  append16 (target, 4); // long
+  append32 (target, 1);
+  append32 (target, value);
+}
+
+//! JPEG stream with EXIF segment holding given thumbnail. Little endian.
+QByteArray withExif (const QByteArray &image, const QByteArray &thumbnail)
+{
+  QByteArray tiff ("II*\0", 4);
+  append32 (tiff, 8); // first IFD
+  append16 (tiff, 0);
+  append32 (tiff, 14); // second IFD
+  append16 (tiff, 2);
+  appendEntry (tiff, 0x0201, 44);
+  appendEntry (tiff, 0x0202, quint32 (thumbnail.size ()));
+  append32 (tiff, 0);
+  tiff += thumbnail;
+
+  const auto segment = QByteArray ("Exif\0\0", 6) + tiff;
+  QByteArray result ("\xff\xd8\xff\xe1", 4);
+  result.append (char ((segment.size () + 2) >> 8));
+  result.append (char ((segment.size () + 2) & 0xff));
+  return result + segment + image.mid (2);
+}
+
+QByteArray exifThumbnail (const QByteArray &data)
+{
+  auto copy = data;
+  QBuffer buffer (&copy);
+  buffer.open (QIODevice::ReadOnly);
+  return ThumbnailDecoder::exifThumbnail (buffer);
+}
+
+QImage testImage (int width, int height)
+{
+  QImage result (width, height, QImage::Format_RGB32);
+  for (auto y = 0; y < height; ++y)
+  {
+    auto *line = reinterpret_cast<QRgb *>(result.scanLine (y));
+    for (auto x = 0; x < width; ++x)
+    {
+      line[x] = qRgb (x % 256, y % 256, (x + y) % 256);
+    }
+  }
+  return result;
+}
+
+QByteArray encode (const QImage &image, const QByteArray &format)
+{
+  QByteArray result;
+  QBuffer buffer (&result);
+  buffer.open (QIODevice::WriteOnly);
+  image.save (&buffer, format.constData ());
+  return result;
+}
+}
+
+
+TEST_CASE ("exif thumbnail", "[thumbnail]")
+{
+  const QByteArray image ("\xff\xd8\xff\xdb\x00\x04\x00\x00\xff\xd9", 10);
+  const QByteArray thumbnail ("\xff\xd8thumbnail\xff\xd9", 13);
+
+  SECTION ("embedded")
+  {
+    REQUIRE (exifThumbnail (withExif (image, thumbnail)) == thumbnail);
+  }
+  SECTION ("after jfif segment")
+  {
+    const auto exif = withExif (image, thumbnail);
+    const QByteArray jfif ("\xff\xe0\x00\x06JFIF", 8);
+    REQUIRE (exifThumbnail (exif.left (2) + jfif + exif.mid (2)) == thumbnail);
+  }
+  SECTION ("missing")
+  {
+    REQUIRE (exifThumbnail (image).isEmpty ());
+  }
+  SECTION ("not jpeg")
+  {
+    REQUIRE (exifThumbnail ("\x89PNG\r\n\x1a\n").isEmpty ());
+  }
+  SECTION ("truncated")
+  {
+    const auto exif = withExif (image, thumbnail);
+    REQUIRE (exifThumbnail (exif.left (40)).isEmpty ());
+  }
+}
+
+TEST_CASE ("thumbnail decoding latency", "[.benchmark][thumbnail]")
+{
+  const auto size = 128;
+  const auto repeats = 5;
+  const auto image = testImage (4000, 3000);
+  QTemporaryDir dir;
+
+  auto formats = QList<QByteArray> () << "jpg" << "png" << "bmp";
+  for (const auto &i: QImageWriter::supportedImageFormats ())
+  {
+    if ((i == "tiff" || i == "webp") && !formats.contains (i))
+    {
+      formats << i;
+    }
+  }
+
+  auto files = QList<QPair<QString, QByteArray> > ();
+  for (const auto &format: formats)
+  {
+    files << qMakePair (QString::fromLatin1 (format), encode (image, format));
+  }
+  const auto jpeg = encode (image, "jpg");
+  files << qMakePair (QString ("jpg+exif"),
+                      withExif (jpeg, encode (image.scaled (160, 120), "jpg")));
+
+  for (const auto &file: files)
+  {
+    const auto path = dir.path () + "/image." + file.first;
+    QFile out (path);
+    REQUIRE (out.open (QFile::WriteOnly));
+    out.write (file.second);
+    out.close ();
+
+    QElapsedTimer timer;
+    timer.start ();
+    for (auto i = 0; i < repeats; ++i)
+    {
+      REQUIRE (!ThumbnailDecoder::decode (path, size).isNull ());
+    }
+    const auto fast = timer.elapsed () / repeats;
+
+    timer.restart ();
+    for (auto i = 0; i < repeats; ++i)
+    {
+      REQUIRE (!QImageReader (path).read ().scaled (size, size, Qt::KeepAspectRatio).isNull ());
+    }
+    const auto full = timer.elapsed () / repeats;
+
+    WARN (file.first.toStdString () << ": " << fast << " ms, full decode " << full << " ms");
+  }
+}
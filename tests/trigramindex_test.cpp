@@ -0,0 +1,83 @@
+#include "catch.hpp"
+#include "testapplication.h"
+#include "trigramindex.h"
+
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QFile>
+
+namespace
+{
+void write (const QString &path, const QByteArray &contents)
+{
+  QFile file (path);
+  REQUIRE (file.open (QFile::WriteOnly));
+  file.write (contents);
+}
+
+//! Index of roots in dir after its update ends.
+void index (TrigramIndex &target, const QString &root)
+{
+  target.setRoots ({root});
+  REQUIRE (waitUntil ([&target] {return !target.isUpdating ();}));
+  REQUIRE (target.tables ().size () == 1);
+}
+
+bool mayContain (const TrigramIndex &index, const QString &text, const QString &path)
+{
+  const TrigramIndex::Filter filter (index.tables (), text.toUtf8 ());
+  return filter.mayContain (QFileInfo (path));
+}
+}
+
+
+TEST_CASE ("content index", "[trigram index]")
+{
+  ensureApplication ();
+  QTemporaryDir temp;
+  REQUIRE (temp.isValid ());
+  const auto root = temp.path () + "/root";
+  const auto tables = temp.path () + "/tables";
+  REQUIRE (QDir ().mkpath (root + "/sub"));
+  const auto alpha = root + "/alpha.txt";
+  const auto bravo = root + "/sub/bravo.txt";
+  write (alpha, "alpha common\n");
+  write (bravo, "bravo common\n");
+
+  TrigramIndex first (tables);
+  index (first, root);
+
+  SECTION ("files without text are skipped")
+  {
+    REQUIRE (mayContain (first, "Alpha", alpha));
+    REQUIRE (!mayContain (first, "alpha", bravo));
+    REQUIRE (mayContain (first, "common", alpha));
+    REQUIRE (mayContain (first, "common", bravo));
+    REQUIRE (!mayContain (first, "charlie", alpha));
+  }
+  SECTION ("short and unindexed texts are not filtered")
+  {
+    REQUIRE (mayContain (first, "xy", alpha));
+    REQUIRE (mayContain (first, "anything", temp.path () + "/outside.txt"));
+  }
+  SECTION ("changed files are searched before update")
+  {
+    write (bravo, "bravo alpha and more\n");
+    REQUIRE (mayContain (first, "alpha", bravo));
+  }
+  SECTION ("update reads changed files only")
+  {
+    write (bravo, "bravo alpha and more\n");
+    write (root + "/delta.txt", "delta\n");
+
+    // second instance starts from the written table
+    TrigramIndex second (tables);
+    index (second, root);
+    REQUIRE (mayContain (second, "alpha", alpha));
+    REQUIRE (mayContain (second, "alpha", bravo));
+    REQUIRE (!mayContain (second, "bravo", alpha));
+    REQUIRE (mayContain (second, "delta", root + "/delta.txt"));
+    REQUIRE (!mayContain (second, "delta", bravo));
+    REQUIRE (!mayContain (second, "common", root + "/delta.txt"));
+  }
+}